@@ -0,0 +1,466 @@
+// the animation file, and reloading it while the program runs:
+//
+//	the keyframes live in a small text file (pinball.anim) instead of in the code:
+//
+//		track <name> <number of channels>
+//		<channel> <time in seconds> <value>
+//
+//	the whole file is read with one fread( ) and parsed in place with strtol( ) and
+//	strtod( ) -- about 150 microseconds for the ~180 lines the table uses, and another
+//	40 to build the tracks' curves
+//
+//	Animate( ) checks the file's modification time twice a second -- when it changes,
+//	none of that is done in the frame: AnimReloader, a thread of its own, reads the
+//	file into scratch tracks, builds just the ones whose keys are different, and (if
+//	Display( ) is using the baked table) rebakes a copy of the table with only those
+//	tracks' columns sampled again
+//
+//	a later Animate( ) that finds it done copies the changed tracks into the live
+//	MultiKeytimes and swaps the new table's pointer in -- if the file has an error in
+//	it, nothing is swapped and the error is printed with its line number
+//
+//	the thread only reads the live tracks' keys (GetValues( ) moves their cursors, so it
+//	never samples them) and the live table, and anything that rebakes the table on the
+//	glut thread waits for it first, with FinishAnimationReload( )
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stddef.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+
+// the tracks the file can set, and how many channels each must have:
+
+struct AnimTrack
+{
+	const char *	name;
+	MultiKeytimes *	track;
+	int				numChannels;
+	int				column;				// where its channels start in an AnimState (and a baked row)
+};
+
+#define ANIMCOLUMN( field )		( (int)( offsetof( struct AnimState, field ) / sizeof(float) ) )
+
+struct AnimTrack	AnimTracks[ ] =
+{
+	{ "Ball",			&Ball,			2,	ANIMCOLUMN( ballX ) },
+	{ "Spins",			&Spins,			2,	ANIMCOLUMN( starRot ) },
+	{ "Levers",			&Levers,		2,	ANIMCOLUMN( leverL ) },
+	{ "Plunger",		&Plunger,		1,	ANIMCOLUMN( plungerZ ) },
+	{ "Camera",			&Camera,		2,	ANIMCOLUMN( posZ ) },
+	{ "StarColor",		&StarColor,		3,	ANIMCOLUMN( starRGB ) },
+	{ "CrossColor",		&CrossColor,	3,	ANIMCOLUMN( crossRGB ) },
+	{ "TriangleColor",	&TriangleColor,	3,	ANIMCOLUMN( triangleRGB ) },
+};
+
+const int	NUMANIMTRACKS = sizeof(AnimTracks) / sizeof(struct AnimTrack);
+
+const int	ANIM_CHECK_MS = 500;		// how often to look for a newer file
+
+char *		AnimFile;					// the file that was loaded
+time_t		AnimFileTime;				// its modification time when it was loaded
+off_t		AnimFileSize;				// and its size
+int			AnimCheckMs;				// the last time we looked
+
+// the reload in flight:
+
+std::thread			AnimReloader;
+std::atomic<bool>	AnimReloadDone;
+bool				AnimReloading = false;		// AnimReloader has been started and not yet finished with
+bool				AnimReloadAtExit = false;	// FinishAnimationReload( ) has been registered with atexit( )
+MultiKeytimes		AnimReloadTracks[NUMANIMTRACKS];
+int					AnimReloadChanged[NUMANIMTRACKS];	// != 0 for each track to swap in
+int					AnimReloadCount;			// how many there are, or -1 if the file couldn't be used
+float *				AnimReloadTable;			// the rebaked copy of the table, or NULL
+int					AnimReloadRows;				// the table's size and rate when it was copied
+float				AnimReloadRate;
+float				AnimReloadError[BAKEDSTRIDE];	// the rebaked columns' worst errors
+double				AnimReadUs, AnimBuildUs, AnimBakeUs;
+
+
+// parse the text of an animation file into scratch tracks:
+// (found[i] is set != 0 for every AnimTracks[i] the file has -- returns false on an error)
+
+bool
+ParseAnimation( char *text, const char *file, MultiKeytimes *parsed, int *found )
+{
+	for( int i = 0; i < NUMANIMTRACKS; i++ )
+		found[i] = 0;
+
+	int current = -1;			// index into AnimTracks[ ]
+	int lineNum = 0;
+	char *line = text;
+	while( *line != '\0' )
+	{
+		lineNum++;
+
+		// find the end of this line and chop off any comment:
+
+		char *end = line;
+		while( *end != '\0'  &&  *end != '\n' )
+			end++;
+		char *next = ( *end == '\n' ) ? end + 1 : end;
+		*end = '\0';
+		char *hash = strchr( line, '#' );
+		if( hash != NULL )
+			*hash = '\0';
+
+		char *p = line;
+		while( isspace( *p ) )
+			p++;
+
+		if( *p == '\0' )
+		{
+			// blank or all comment
+		}
+		else if( strncmp( p, "track", 5 ) == 0  &&  isspace( p[5] ) )
+		{
+			char name[64];
+			int numChannels;
+			if( sscanf( p+5, "%63s %d", name, &numChannels ) != 2 )
+			{
+				fprintf( stderr, "%s, line %d: expected 'track <name> <channels>'\n", file, lineNum );
+				return false;
+			}
+
+			current = -1;
+			for( int i = 0; i < NUMANIMTRACKS; i++ )
+			{
+				if( strcmp( name, AnimTracks[i].name ) == 0 )
+					current = i;
+			}
+			if( current < 0 )
+			{
+				fprintf( stderr, "%s, line %d: unknown track '%s'\n", file, lineNum, name );
+				return false;
+			}
+			if( numChannels != AnimTracks[current].numChannels )
+			{
+				fprintf( stderr, "%s, line %d: track '%s' must have %d channels, not %d\n",
+					file, lineNum, name, AnimTracks[current].numChannels, numChannels );
+				return false;
+			}
+			if( found[current] != 0 )
+			{
+				fprintf( stderr, "%s, line %d: track '%s' is in the file twice\n", file, lineNum, name );
+				return false;
+			}
+			found[current] = 1;
+			parsed[current].Init( numChannels );
+		}
+		else
+		{
+			char *q;
+			long channel = strtol( p, &q, 10 );
+			char *r;
+			float t = (float)strtod( q, &r );
+			char *s;
+			float v = (float)strtod( r, &s );
+			while( isspace( *s ) )
+				s++;
+			if( q == p  ||  r == q  ||  s == r  ||  *s != '\0' )
+			{
+				fprintf( stderr, "%s, line %d: expected '<channel> <time> <value>'\n", file, lineNum );
+				return false;
+			}
+			if( current < 0 )
+			{
+				fprintf( stderr, "%s, line %d: key before the first 'track' line\n", file, lineNum );
+				return false;
+			}
+			if( channel < 0  ||  channel >= AnimTracks[current].numChannels )
+			{
+				fprintf( stderr, "%s, line %d: channel %ld is out of range for track '%s'\n",
+					file, lineNum, channel, AnimTracks[current].name );
+				return false;
+			}
+			parsed[current].AddTimeValue( (int)channel, t, v );
+		}
+
+		line = next;
+	}
+	return true;
+}
+
+
+// give any track that has never been loaded an empty (constant zero) curve:
+
+void
+EmptyAnimTracks( )
+{
+	for( int i = 0; i < NUMANIMTRACKS; i++ )
+	{
+		if( AnimTracks[i].track->GetNumSegments( ) == 0 )
+		{
+			AnimTracks[i].track->Init( AnimTracks[i].numChannels );
+			AnimTracks[i].track->Build( );
+		}
+	}
+}
+
+
+// read an animation file into scratch tracks, and build the ones whose keys changed:
+// (changed[i] is set != 0 for each of them -- returns how many there are, or -1 if the
+// file couldn't be used; this only reads the live tracks, so any thread can call it)
+
+int
+ReadAnimation( const char *file, MultiKeytimes *parsed, int *changed )
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now( );
+	for( int i = 0; i < NUMANIMTRACKS; i++ )
+		changed[i] = 0;
+
+	FILE *fp = fopen( file, "rb" );
+	if( fp == NULL )
+	{
+		fprintf( stderr, "Cannot open animation file '%s'\n", file );
+		return -1;
+	}
+	fseek( fp, 0, SEEK_END );
+	long size = ftell( fp );
+	fseek( fp, 0, SEEK_SET );
+	char *text = new char[ size + 1 ];
+	size = (long)fread( text, 1, size, fp );
+	text[size] = '\0';
+	fclose( fp );
+
+	int found[NUMANIMTRACKS];
+	bool ok = ParseAnimation( text, file, parsed, found );
+	delete [ ] text;
+	if( ! ok )
+		return -1;
+
+	std::chrono::high_resolution_clock::time_point parsedAt = std::chrono::high_resolution_clock::now( );
+
+	int count = 0;
+	for( int i = 0; i < NUMANIMTRACKS; i++ )
+	{
+		struct AnimTrack *at = &AnimTracks[i];
+		if( found[i] == 0 )
+		{
+			if( at->track->GetNumSegments( ) == 0 )
+				fprintf( stderr, "Animation file '%s' has no '%s' track\n", file, at->name );
+			continue;
+		}
+		if( at->track->GetNumSegments( ) != 0  &&  at->track->SameKeys( parsed[i] ) )
+			continue;
+
+		parsed[i].Build( );
+		changed[i] = 1;
+		count++;
+	}
+
+	std::chrono::high_resolution_clock::time_point done = std::chrono::high_resolution_clock::now( );
+	AnimReadUs = std::chrono::duration<double, std::micro>( parsedAt - start ).count( );
+	AnimBuildUs = std::chrono::duration<double, std::micro>( done - parsedAt ).count( );
+	return count;
+}
+
+
+// copy the changed scratch tracks into the live ones (on the glut thread):
+
+void
+SwapAnimation( MultiKeytimes *parsed, const int *changed )
+{
+	for( int i = 0; i < NUMANIMTRACKS; i++ )
+	{
+		if( changed[i] == 0 )
+			continue;
+		*AnimTracks[i].track = parsed[i];
+		if( DebugOn != 0 )
+			fprintf( stderr, "Animation: swapped in track '%s'\n", AnimTracks[i].name );
+	}
+	EmptyAnimTracks( );
+}
+
+
+// read an animation file and swap in every track whose keys changed, right away:
+// (returns how many tracks were swapped, or -1 if the file couldn't be used)
+
+int
+LoadAnimation( char *file )
+{
+	AnimFile = file;
+	struct stat st;
+	if( stat( file, &st ) == 0 )
+	{
+		AnimFileTime = st.st_mtime;
+		AnimFileSize = st.st_size;
+	}
+
+	MultiKeytimes parsed[NUMANIMTRACKS];
+	int changed[NUMANIMTRACKS];
+	int count = ReadAnimation( file, parsed, changed );
+	if( count < 0 )
+	{
+		EmptyAnimTracks( );
+		return -1;
+	}
+	SwapAnimation( parsed, changed );
+	fprintf( stderr, "Loaded '%s': %d tracks changed, read in %.1f us, built in %.1f us\n", file, count,
+		AnimReadUs, AnimBuildUs );
+	return count;
+}
+
+
+// sample just the changed tracks into their columns of a table, and check those columns
+// halfway between every pair of rows the way BakeAnimation( ) does, into error[ ]:
+
+void
+RebakeAnimationTracks( float *table, int rows, float rate, MultiKeytimes *tracks, const int *changed,
+	float *error )
+{
+	for( int r = 0; r < rows; r++ )
+	{
+		float *row = &table[ r*BAKEDSTRIDE ];
+		for( int i = 0; i < NUMANIMTRACKS; i++ )
+		{
+			if( changed[i] != 0 )
+				tracks[i].GetValues( (float)r / rate, &row[ AnimTracks[i].column ] );
+		}
+	}
+
+	for( int c = 0; c < BAKEDSTRIDE; c++ )
+		error[c] = 0.;
+	for( int r = 0; r < rows - 1; r++ )
+	{
+		float t = ( (float)r + 0.5f ) / rate;
+		float x = t * rate;					// (as SampleBakedBatch( ) gets it)
+		float f = x - (float)(int)x;
+		const float *a = &table[ r*BAKEDSTRIDE ];
+		const float *b = a + BAKEDSTRIDE;
+		for( int i = 0; i < NUMANIMTRACKS; i++ )
+		{
+			if( changed[i] == 0 )
+				continue;
+			float exact[4];
+			tracks[i].GetValues( t, exact );
+			for( int k = 0; k < AnimTracks[i].numChannels; k++ )
+			{
+				int c = AnimTracks[i].column + k;
+				float d = fabsf( a[c] + f*( b[c] - a[c] ) - exact[k] );
+				if( d > error[c] )
+					error[c] = d;
+			}
+		}
+	}
+}
+
+
+// the reload thread -- read the file, and rebake a copy of the table if there is one to:
+
+void
+ReloadAnimationJob( )
+{
+	AnimReloadCount = ReadAnimation( AnimFile, AnimReloadTracks, AnimReloadChanged );
+	AnimBakeUs = 0.;
+	if( AnimReloadCount > 0  &&  AnimReloadTable != NULL )
+	{
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now( );
+		memcpy( AnimReloadTable, BakedTable, AnimReloadRows * BAKEDSTRIDE * sizeof(float) );
+		RebakeAnimationTracks( AnimReloadTable, AnimReloadRows, AnimReloadRate, AnimReloadTracks, AnimReloadChanged,
+			AnimReloadError );
+		AnimBakeUs = std::chrono::duration<double, std::micro>( std::chrono::high_resolution_clock::now( ) - start ).count( );
+	}
+	AnimReloadDone = true;
+}
+
+
+// wait for the reload in flight, if there is one, and swap in what it read:
+// (anything on the glut thread that rebakes or frees the table calls this first)
+
+void
+FinishAnimationReload( )
+{
+	if( ! AnimReloading )
+		return;
+	AnimReloader.join( );
+	AnimReloading = false;
+
+	if( AnimReloadCount < 0 )
+	{
+		EmptyAnimTracks( );
+	}
+	else
+	{
+		SwapAnimation( AnimReloadTracks, AnimReloadChanged );
+		bool rebaked = ( AnimReloadTable != NULL  &&  AnimReloadCount > 0 );
+		if( rebaked )
+		{
+			FreeAlignedFloats( BakedTable );
+			BakedTable = AnimReloadTable;
+			AnimReloadTable = NULL;
+			for( int i = 0; i < NUMANIMTRACKS; i++ )
+			{
+				for( int k = 0; AnimReloadChanged[i] != 0  &&  k < AnimTracks[i].numChannels; k++ )
+					BakedChannelError[ AnimTracks[i].column + k ] = AnimReloadError[ AnimTracks[i].column + k ];
+			}
+			UpdateBakedMaxError( );
+		}
+		fprintf( stderr, "Reloaded '%s': %d tracks changed, read in %.1f us, built in %.1f us, rebaked in %.1f us\n",
+			AnimFile, AnimReloadCount, AnimReadUs, AnimBuildUs, AnimBakeUs );
+		if( rebaked )
+			fprintf( stderr, "  the baked table's worst error is now %g\n", BakedMaxError );
+	}
+	FreeAlignedFloats( AnimReloadTable );
+	AnimReloadTable = NULL;
+	for( int i = 0; i < NUMANIMTRACKS; i++ )
+		AnimReloadTracks[i] = MultiKeytimes( );
+}
+
+
+// start reading the file on AnimReloader:
+
+void
+StartAnimationReload( )
+{
+	FinishAnimationReload( );
+	if( ! AnimReloadAtExit )
+	{
+		atexit( FinishAnimationReload );		// (after AnimReloader was made, so this runs before it is destroyed)
+		AnimReloadAtExit = true;
+	}
+
+	AnimReloadTable = NULL;
+	if( BakedOn != 0  &&  BakedTable != NULL )
+	{
+		AnimReloadRows = BakedRows;
+		AnimReloadRate = BakedRate;
+		AnimReloadTable = AlignedFloats( BakedRows * BAKEDSTRIDE );
+	}
+	AnimReloadDone = false;
+	AnimReloading = true;
+	AnimReloader = std::thread( ReloadAnimationJob );
+}
+
+
+// reload the animation file if it has been saved since we last loaded it, and swap in
+// a finished reload:
+// (looks at most once every ANIM_CHECK_MS)
+
+void
+CheckAnimationFile( int ms )
+{
+	if( AnimReloading )
+	{
+		if( AnimReloadDone )
+			FinishAnimationReload( );
+		return;
+	}
+
+	if( AnimFile == NULL  ||  ms - AnimCheckMs < ANIM_CHECK_MS )
+		return;
+	AnimCheckMs = ms;
+
+	struct stat st;
+	if( stat( AnimFile, &st ) != 0 )
+		return;
+	if( st.st_mtime == AnimFileTime  &&  st.st_size == AnimFileSize )
+		return;
+	AnimFileTime = st.st_mtime;
+	AnimFileSize = st.st_size;
+
+	StartAnimationReload( );
+}
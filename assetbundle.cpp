@@ -0,0 +1,361 @@
+// the asset bundle -- every mesh and texture in one file that is mapped, not parsed:
+//
+//	"finalproj -bake" reads the obj files and bmp files listed in BundleAssets[ ] the slow
+//	way (text parsing, bmp decoding) and writes them all into pinball.bundle:
+//
+//		BundleHeader
+//		BundleEntry[ numEntries ]		one per asset, with its offset and size
+//		the data, each piece starting on a BUNDLEALIGN boundary
+//
+//	a mesh is stored as the GL_T2F_N3F_V3F vertex array and GLuint index list that
+//	ReadObjFile( ) and OptimizeObjMesh( ) make, and a texture as the bottom-to-top RGB
+//	rows that LoadBmp( ) returns -- so at run time both go to opengl straight out
+//	of the mapped file with no copying, converting, or optimizing
+//
+//	each entry remembers its source file's modification time and size -- if the source
+//	has been changed since the bake, that one asset is loaded the slow way instead (and
+//	a note says to re-bake), so a stale bundle never shows old data
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <chrono>
+
+
+const char	BUNDLEMAGIC[8] = { 'P', 'N', 'B', 'A', 'L', 'L', 'B', 'N' };
+const int	BUNDLEVERSION  = 2;
+const int	BUNDLEALIGN    = 64;
+
+char *		BundleFile = (char *)"pinball.bundle";
+
+enum BundleTypes
+{
+	BUNDLE_MESH,
+	BUNDLE_TEXTURE
+};
+
+struct BundleHeader
+{
+	char		magic[8];
+	int			version;
+	int			numEntries;
+};
+
+struct BundleEntry
+{
+	char		name[32];			// the source file name
+	int			type;				// BUNDLE_MESH or BUNDLE_TEXTURE
+	int			flags;				// mesh: != 0 if it has texture coordinates
+	int			width;				// mesh: number of vertices, texture: width
+	int			height;				// mesh: number of indices, texture: height
+	long long	offset;				// from the start of the file
+	long long	size;				// in bytes
+	long long	sourceTime;			// the source file's modification time and size when baked
+	long long	sourceSize;
+};
+
+// everything the program loads:
+
+struct BundleAsset
+{
+	const char *	name;
+	int				type;
+};
+
+struct BundleAsset	BundleAssets[ ] =
+{
+	{ "Top.obj",		BUNDLE_MESH },
+	{ "Starter.obj",	BUNDLE_MESH },
+	{ "Lever.obj",		BUNDLE_MESH },
+	{ "Sparkle.obj",	BUNDLE_MESH },
+	{ "Circle.obj",		BUNDLE_MESH },
+	{ "Star.obj",		BUNDLE_MESH },
+	{ "Triangle.obj",	BUNDLE_MESH },
+	{ "space.bmp",		BUNDLE_TEXTURE },
+};
+
+const int	NUMBUNDLEASSETS = sizeof(BundleAssets) / sizeof(struct BundleAsset);
+
+// the mapped bundle:
+
+struct MappedFile			BundleMap;
+const unsigned char *		BundleData;
+size_t						BundleSize;
+const struct BundleEntry *	BundleEntries;
+int							BundleNumEntries;
+
+
+// a file's modification time and size (returns false if it isn't there):
+
+bool
+SourceStamp( const char *file, long long *mtime, long long *size )
+{
+	struct stat st;
+	if( stat( file, &st ) != 0 )
+		return false;
+	*mtime = (long long)st.st_mtime;
+	*size = (long long)st.st_size;
+	return true;
+}
+
+
+// read every asset the slow way and write the bundle:
+// (returns 0 if it worked, so main( ) can exit with it)
+
+int
+BakeBundle( char *bundleFile )
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now( );
+
+	struct BundleEntry entries[NUMBUNDLEASSETS];
+	std::vector<struct ObjMesh> meshes( NUMBUNDLEASSETS );
+	std::vector<unsigned char *> pixels( NUMBUNDLEASSETS, (unsigned char *)NULL );
+
+	long long offset = sizeof(struct BundleHeader) + sizeof(entries);
+	for( int i = 0; i < NUMBUNDLEASSETS; i++ )
+	{
+		struct BundleEntry *e = &entries[i];
+		memset( e, 0, sizeof(struct BundleEntry) );
+		strncpy( e->name, BundleAssets[i].name, sizeof(e->name)-1 );
+		e->type = BundleAssets[i].type;
+		if( ! SourceStamp( e->name, &e->sourceTime, &e->sourceSize ) )
+		{
+			fprintf( stderr, "Cannot bake '%s': it isn't there\n", e->name );
+			return 1;
+		}
+
+		if( e->type == BUNDLE_MESH )
+		{
+			if( ! ReadObjFile( e->name, &meshes[i] ) )
+				return 1;
+			OptimizeObjMesh( e->name, &meshes[i] );
+			e->flags = meshes[i].hasTexCoords;
+			e->width = meshes[i].numVertices;
+			e->height = meshes[i].numIndices;
+			e->size = (long long)meshes[i].numVertices * OBJVERTEXFLOATS * sizeof(float)
+					+ (long long)meshes[i].numIndices * sizeof(GLuint);
+		}
+		else
+		{
+			pixels[i] = LoadBmp( e->name, &e->width, &e->height );
+			if( pixels[i] == NULL )
+			{
+				fprintf( stderr, "Cannot bake '%s': it can't be read\n", e->name );
+				return 1;
+			}
+			e->size = 3LL * e->width * e->height;
+		}
+
+		offset = ( offset + BUNDLEALIGN - 1 ) / BUNDLEALIGN * BUNDLEALIGN;
+		e->offset = offset;
+		offset += e->size;
+	}
+
+	FILE *fp = fopen( bundleFile, "wb" );
+	if( fp == NULL )
+	{
+		fprintf( stderr, "Cannot write bundle '%s'\n", bundleFile );
+		return 1;
+	}
+
+	struct BundleHeader header;
+	memcpy( header.magic, BUNDLEMAGIC, sizeof(header.magic) );
+	header.version = BUNDLEVERSION;
+	header.numEntries = NUMBUNDLEASSETS;
+	fwrite( &header, sizeof(header), 1, fp );
+	fwrite( entries, sizeof(entries), 1, fp );
+
+	static const char zeros[BUNDLEALIGN] = { 0 };
+	for( int i = 0; i < NUMBUNDLEASSETS; i++ )
+	{
+		long long here = (long long)ftell( fp );
+		fwrite( zeros, 1, (size_t)( entries[i].offset - here ), fp );
+		if( entries[i].type == BUNDLE_MESH )
+		{
+			fwrite( meshes[i].vertices, sizeof(float), meshes[i].numVertices * OBJVERTEXFLOATS, fp );
+			fwrite( meshes[i].indices, sizeof(GLuint), meshes[i].numIndices, fp );
+			FreeObjMesh( &meshes[i] );
+		}
+		else
+		{
+			fwrite( pixels[i], 1, (size_t)entries[i].size, fp );
+			delete [ ] pixels[i];
+		}
+	}
+	bool ok = ( ferror( fp ) == 0 );
+	fclose( fp );
+	if( ! ok )
+	{
+		fprintf( stderr, "Error writing bundle '%s'\n", bundleFile );
+		return 1;
+	}
+
+	std::chrono::high_resolution_clock::time_point done = std::chrono::high_resolution_clock::now( );
+	fprintf( stderr, "Baked %d assets into '%s' (%lld KB) in %.1f ms\n", NUMBUNDLEASSETS, bundleFile, offset / 1024,
+		std::chrono::duration<double, std::milli>( done - start ).count( ) );
+	return 0;
+}
+
+
+void
+CloseBundle( )
+{
+	if( BundleData == NULL )
+		return;
+	UnmapFile( &BundleMap );
+	BundleData = NULL;
+	BundleEntries = NULL;
+	BundleNumEntries = 0;
+}
+
+
+// how many bytes an entry's data should be, from its type and dimensions:
+// (-1 if those can't be right)
+
+long long
+BundleEntrySize( const struct BundleEntry *e )
+{
+	if( e->type == BUNDLE_MESH  &&  e->width >= 0  &&  e->height >= 0 )
+		return (long long)e->width * OBJVERTEXFLOATS * (long long)sizeof(float) + (long long)e->height * (long long)sizeof(GLuint);
+	if( e->type == BUNDLE_TEXTURE  &&  e->width > 0  &&  e->height > 0 )
+		return 3LL * e->width * e->height;
+	return -1;
+}
+
+
+// does a mesh entry's index list only name vertices that are there?
+
+bool
+BundleIndicesValid( const struct BundleEntry *e )
+{
+	const GLuint *indices = (const GLuint *)( BundleData + e->offset + (long long)e->width * OBJVERTEXFLOATS * sizeof(float) );
+	for( int i = 0; i < e->height; i++ )
+	{
+		if( indices[i] >= (GLuint)e->width )
+			return false;
+	}
+	return true;
+}
+
+
+// map the bundle into memory and check its header and index:
+// (every entry's data has to be all there, be the size its dimensions say, and start on a
+//  BUNDLEALIGN boundary, and every mesh index has to name one of its vertices -- so a
+//  truncated or corrupt bundle can't send a mesh or a texture read past the end of the map)
+// (returns false if there is no usable bundle -- then everything is loaded the slow way)
+
+bool
+OpenBundle( char *bundleFile )
+{
+	CloseBundle( );
+
+	if( ! MapFile( bundleFile, &BundleMap ) )
+		return false;
+	BundleData = BundleMap.data;
+	BundleSize = BundleMap.size;
+
+	const struct BundleHeader *header = (const struct BundleHeader *)BundleData;
+	if( BundleSize < sizeof(struct BundleHeader)  ||  memcmp( header->magic, BUNDLEMAGIC, sizeof(BUNDLEMAGIC) ) != 0
+		||  header->version != BUNDLEVERSION
+		||  sizeof(struct BundleHeader) + header->numEntries * sizeof(struct BundleEntry) > BundleSize )
+	{
+		fprintf( stderr, "'%s' is not a version %d asset bundle -- run with -bake to rebuild it\n", bundleFile, BUNDLEVERSION );
+		CloseBundle( );
+		return false;
+	}
+
+	BundleEntries = (const struct BundleEntry *)( BundleData + sizeof(struct BundleHeader) );
+	BundleNumEntries = header->numEntries;
+	for( int i = 0; i < BundleNumEntries; i++ )
+	{
+		const struct BundleEntry *e = &BundleEntries[i];
+		long long size = BundleEntrySize( e );
+		if( size < 0  ||  e->size != size  ||  e->offset < 0  ||  (unsigned long long)e->offset > BundleSize
+		 || (unsigned long long)e->size > BundleSize - (unsigned long long)e->offset )
+		{
+			fprintf( stderr, "'%s' is truncated -- run with -bake to rebuild it\n", bundleFile );
+			CloseBundle( );
+			return false;
+		}
+		if( e->offset % BUNDLEALIGN != 0  ||  ( e->type == BUNDLE_MESH  &&  ! BundleIndicesValid( e ) ) )
+		{
+			fprintf( stderr, "'%s' is corrupt -- run with -bake to rebuild it\n", bundleFile );
+			CloseBundle( );
+			return false;
+		}
+	}
+
+	if( DebugOn != 0 )
+		fprintf( stderr, "Mapped bundle '%s': %d assets, %d KB\n", bundleFile, BundleNumEntries, (int)( BundleSize / 1024 ) );
+	return true;
+}
+
+
+// the bundle's entry for a source file, if it is there and still up-to-date:
+
+const struct BundleEntry *
+FindBundleEntry( const char *name, int type )
+{
+	for( int i = 0; i < BundleNumEntries; i++ )
+	{
+		const struct BundleEntry *e = &BundleEntries[i];
+		if( e->type != type  ||  strncmp( e->name, name, sizeof(e->name) ) != 0 )
+			continue;
+
+		long long mtime, size;
+		if( SourceStamp( name, &mtime, &size )  &&  ( mtime != e->sourceTime  ||  size != e->sourceSize ) )
+		{
+			fprintf( stderr, "'%s' has changed since '%s' was baked -- reading it instead (run with -bake to update)\n",
+				name, BundleFile );
+			return NULL;
+		}
+		return e;
+	}
+	return NULL;
+}
+
+
+// get an optimized mesh, from the bundle if possible:
+// (a mapped mesh points into the bundle, so draw it before calling CloseBundle( ) --
+//  mesh->owned is NULL if it is mapped)
+
+bool
+LoadMeshAsset( char *file, struct ObjMesh *mesh )
+{
+	const struct BundleEntry *e = FindBundleEntry( file, BUNDLE_MESH );
+	if( e == NULL )
+	{
+		if( ! ReadObjFile( file, mesh ) )
+			return false;
+		OptimizeObjMesh( file, mesh );
+		return true;
+	}
+
+	mesh->numVertices = e->width;
+	mesh->hasTexCoords = e->flags;
+	mesh->vertices = (const float *)( BundleData + e->offset );
+	mesh->owned = NULL;
+	mesh->numIndices = e->height;
+	mesh->indices = (const GLuint *)( mesh->vertices + e->width * OBJVERTEXFLOATS );
+	mesh->ownedIndices = NULL;
+	return true;
+}
+
+
+// get a texture's RGB rows, from the bundle if possible:
+// (*owned is set to what must be delete'd when done -- NULL if the pixels are mapped)
+
+const unsigned char *
+LoadTextureAsset( char *file, int *width, int *height, unsigned char **owned )
+{
+	const struct BundleEntry *e = FindBundleEntry( file, BUNDLE_TEXTURE );
+	if( e == NULL )
+	{
+		*owned = LoadBmp( file, width, height );
+		return *owned;
+	}
+
+	*width = e->width;
+	*height = e->height;
+	*owned = NULL;
+	return BundleData + e->offset;
+}
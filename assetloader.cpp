@@ -0,0 +1,138 @@
+// loading every asset at once on a pool of worker threads:
+//
+//	StartAssetLoads( ) maps the bundle and gives each asset in BundleAssets[ ] its own
+//	job -- the workers parse the obj files and decode the bmp files (or just point into
+//	the bundle) into memory, then put the asset's index on the finished queue
+//
+//	a texture is read as its whole mip chain, out of its texture cache if it has one
+//	(see texcache.cpp), else decoded, filtered, and compressed by the worker
+//
+//	the thread that owns the opengl context calls NextLoadedAsset( ) to take assets off
+//	that queue in whatever order they finish, and builds each one's display list or
+//	texture right away -- so the slow files are parsed side-by-side instead of one
+//	after another, and the uploads overlap with the parsing that is still going on
+//
+//	FinishAssetLoads( ) stops the workers and unmaps the bundle once everything has
+//	been handed out
+
+#include <chrono>
+
+
+struct LoadedAsset
+{
+	bool					ok;
+	struct ObjMesh			mesh;				// if it is a BUNDLE_MESH
+	struct MipChain			mips;				// if it is a BUNDLE_TEXTURE
+	double					ms;					// how long the worker took
+};
+
+struct LoadedAsset	LoadedAssets[NUMBUNDLEASSETS];
+
+ThreadPool				AssetWorkers;
+std::mutex				AssetLock;
+std::condition_variable	AssetFinished;
+std::deque<int>			AssetsFinished;			// indices into BundleAssets[ ], in the order they finished
+int						AssetsDelivered;		// how many NextLoadedAsset( ) has handed out
+
+std::chrono::high_resolution_clock::time_point	AssetLoadStart;
+double		AssetWorkMs;			// the workers' time, added up
+int			AssetsFromBundle;		// how many came out of the bundle (or the texture cache)
+int			AssetsParsed;			// and how many had to be read the slow way
+
+
+// one worker job -- read one asset into memory:
+
+void
+LoadAssetJob( int i )
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now( );
+
+	struct LoadedAsset *a = &LoadedAssets[i];
+	char *file = (char *)BundleAssets[i].name;
+	if( BundleAssets[i].type == BUNDLE_MESH )
+	{
+		a->ok = LoadMeshAsset( file, &a->mesh );
+	}
+	else
+	{
+		a->ok = LoadMipChain( file, &a->mips );
+	}
+	a->ms = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now( ) - start ).count( );
+
+	{
+		std::lock_guard<std::mutex> guard( AssetLock );
+		AssetsFinished.push_back( i );
+	}
+	AssetFinished.notify_one( );
+}
+
+
+// start reading every asset:
+
+void
+StartAssetLoads( )
+{
+	AssetLoadStart = std::chrono::high_resolution_clock::now( );
+	OpenBundle( BundleFile );
+
+	AssetsFinished.clear( );
+	AssetsDelivered = 0;
+	AssetWorkMs = 0.;
+	AssetsFromBundle = AssetsParsed = 0;
+
+	int numThreads = NumCores( );
+	if( numThreads > NUMBUNDLEASSETS )
+		numThreads = NUMBUNDLEASSETS;
+	AssetWorkers.Start( numThreads );
+	for( int i = 0; i < NUMBUNDLEASSETS; i++ )
+		AssetWorkers.Submit( std::bind( LoadAssetJob, i ) );
+}
+
+
+// wait for the next asset to finish:
+// (returns its index into BundleAssets[ ] and LoadedAssets[ ], or -1 when they have all been handed out)
+
+int
+NextLoadedAsset( )
+{
+	if( AssetsDelivered >= NUMBUNDLEASSETS )
+		return -1;
+
+	int i;
+	{
+		std::unique_lock<std::mutex> guard( AssetLock );
+		while( AssetsFinished.empty( ) )
+			AssetFinished.wait( guard );
+		i = AssetsFinished.front( );
+		AssetsFinished.pop_front( );
+	}
+	AssetsDelivered++;
+
+	struct LoadedAsset *a = &LoadedAssets[i];
+	AssetWorkMs += a->ms;
+	bool mapped = ( BundleAssets[i].type == BUNDLE_MESH ) ? ( a->mesh.owned == NULL ) : a->mips.fromCache;
+	if( a->ok  &&  mapped )
+		AssetsFromBundle++;
+	else
+		AssetsParsed++;
+
+	if( DebugOn != 0 )
+		fprintf( stderr, "Asset '%s' ready after %.1f ms\n", BundleAssets[i].name,
+			std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now( ) - AssetLoadStart ).count( ) );
+	return i;
+}
+
+
+// everything has been uploaded -- stop the workers and let go of the bundle:
+
+void
+FinishAssetLoads( )
+{
+	AssetWorkers.Stop( );
+	CloseBundle( );
+
+	double wallMs = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now( ) - AssetLoadStart ).count( );
+	fprintf( stderr, "Loaded %d assets from '%s' or the texture cache and parsed %d on %d threads: %.1f ms of work in %.1f ms\n",
+		AssetsFromBundle, BundleFile, AssetsParsed, NumCores( ) < NUMBUNDLEASSETS ? NumCores( ) : NUMBUNDLEASSETS,
+		AssetWorkMs, wallMs );
+}
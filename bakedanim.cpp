@@ -0,0 +1,193 @@
+// baked animation: every track sampled at a fixed rate into one interleaved table:
+//
+//	all of the motion in the MS_PER_CYCLE loop is fixed once InitGraphics( ) has built
+//	the tracks, so it can be sampled ahead of time -- each row of the table is one
+//	AnimState (every animated value at one instant), padded out to BAKEDSTRIDE floats
+//
+//	evaluating the table is then a lerp between two neighboring rows, done for every
+//	channel at once with SSE (or AVX, if this was compiled with AVX turned on)
+//
+//	the same kernel takes a whole batch of times, so motion-blur sub-frames,
+//	trajectory previews, and headless replays can get many samples in one call
+//	without touching the keyframes at all
+
+
+#include <string.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 1 )
+#include <xmmintrin.h>
+#define BAKED_SSE
+#endif
+
+// the animated values in one AnimState, and the padded row size:
+// (24 floats is a whole number of both 4-wide and 8-wide registers)
+
+const int	ANIMCHANNELS = sizeof(struct AnimState) / sizeof(float);
+const int	BAKEDSTRIDE  = 24;
+
+int			BakedOn = 0;			// != 0 means Display( ) samples the table, not the tracks
+float		BakedRate = 240.f;		// table rows per second
+int			BakedRows;
+float *		BakedTable;				// BakedRows x BAKEDSTRIDE floats, 32-byte aligned
+float		BakedMaxError;			// worst difference from the keyframes, halfway between rows
+float		BakedChannelError[BAKEDSTRIDE];	// and the worst in each channel
+
+// one row, for a caller to sample into (each thread that samples has its own):
+
+struct BakedRow
+{
+	alignas(32) float	v[BAKEDSTRIDE];
+};
+
+
+// 32-byte aligned memory for the table and for scratch rows:
+
+float *
+AlignedFloats( int n )
+{
+	char *raw = new char[ n*sizeof(float) + 32 + sizeof(char *) ];
+	char *p = raw + sizeof(char *);
+	p += ( 32 - ( (size_t)p & 31 ) ) & 31;
+	( (char **)p )[-1] = raw;
+	return (float *)p;
+}
+
+
+void
+FreeAlignedFloats( float *p )
+{
+	if( p != NULL )
+		delete [ ] ( (char **)p )[-1];
+}
+
+
+// the kernel: row = a + f*(b-a), for all BAKEDSTRIDE channels:
+
+inline void
+LerpBakedRow( const float *a, const float *b, float f, float *row )
+{
+#if defined(__AVX__)
+	__m256 vf = _mm256_set1_ps( f );
+	for( int i = 0; i < BAKEDSTRIDE; i += 8 )
+	{
+		__m256 va = _mm256_load_ps( a + i );
+		__m256 vb = _mm256_load_ps( b + i );
+		_mm256_store_ps( row + i, _mm256_add_ps( va, _mm256_mul_ps( vf, _mm256_sub_ps( vb, va ) ) ) );
+	}
+#elif defined(BAKED_SSE)
+	__m128 vf = _mm_set1_ps( f );
+	for( int i = 0; i < BAKEDSTRIDE; i += 4 )
+	{
+		__m128 va = _mm_load_ps( a + i );
+		__m128 vb = _mm_load_ps( b + i );
+		_mm_store_ps( row + i, _mm_add_ps( va, _mm_mul_ps( vf, _mm_sub_ps( vb, va ) ) ) );
+	}
+#else
+	for( int i = 0; i < BAKEDSTRIDE; i++ )
+		row[i] = a[i] + f*( b[i] - a[i] );
+#endif
+}
+
+
+// sample the table at n times (in seconds), writing n rows of BAKEDSTRIDE floats:
+// (rows must be 32-byte aligned -- each row starts with an AnimState)
+
+void
+SampleBakedBatch( const float *times, int n, float *rows )
+{
+	float cycle = (float)MS_PER_CYCLE / 1000.f;
+	for( int k = 0; k < n; k++ )
+	{
+		float t = times[k];
+		if( t < 0. )		t = 0.;
+		if( t > cycle )		t = cycle;
+
+		float x = t * BakedRate;
+		int i = (int)x;
+		if( i > BakedRows - 2 )
+			i = BakedRows - 2;
+		float f = x - (float)i;
+
+		LerpBakedRow( &BakedTable[ i*BAKEDSTRIDE ], &BakedTable[ (i+1)*BAKEDSTRIDE ], f, &rows[ k*BAKEDSTRIDE ] );
+	}
+}
+
+
+// sample the table at one time, through the caller's row:
+
+void
+SampleBaked( float t, struct BakedRow *row, struct AnimState *a )
+{
+	SampleBakedBatch( &t, 1, row->v );
+	memcpy( a, row->v, sizeof(struct AnimState) );
+}
+
+
+// the worst of the channels' errors:
+
+void
+UpdateBakedMaxError( )
+{
+	BakedMaxError = 0.;
+	for( int c = 0; c < ANIMCHANNELS; c++ )
+	{
+		if( BakedChannelError[c] > BakedMaxError )
+			BakedMaxError = BakedChannelError[c];
+	}
+}
+
+
+// (re)bake the table at a given rate from the keyframe tracks:
+
+void
+BakeAnimation( float rate )
+{
+	if( rate < 1. )
+		rate = 1.;
+	BakedRate = rate;
+
+	float cycle = (float)MS_PER_CYCLE / 1000.f;
+	BakedRows = (int)ceilf( cycle * rate ) + 1;
+
+	FreeAlignedFloats( BakedTable );
+	BakedTable = AlignedFloats( BakedRows * BAKEDSTRIDE );
+	for( int i = 0; i < BakedRows; i++ )
+	{
+		float *row = &BakedTable[ i*BAKEDSTRIDE ];
+		for( int c = 0; c < BAKEDSTRIDE; c++ )
+			row[c] = 0.;
+		SampleAnimation( (float)i / rate, (struct AnimState *)row );
+	}
+
+	// check the table halfway between every pair of rows, in one batch:
+
+	int n = BakedRows - 1;
+	float *times = new float[ n ];
+	for( int i = 0; i < n; i++ )
+		times[i] = ( (float)i + 0.5f ) / rate;
+	float *rows = AlignedFloats( n * BAKEDSTRIDE );
+	SampleBakedBatch( times, n, rows );
+
+	for( int c = 0; c < BAKEDSTRIDE; c++ )
+		BakedChannelError[c] = 0.;
+	for( int i = 0; i < n; i++ )
+	{
+		struct AnimState exact;
+		SampleAnimation( times[i], &exact );
+		float *e = (float *)&exact;
+		for( int c = 0; c < ANIMCHANNELS; c++ )
+		{
+			float d = fabsf( rows[ i*BAKEDSTRIDE + c ] - e[c] );
+			if( d > BakedChannelError[c] )
+				BakedChannelError[c] = d;
+		}
+	}
+	UpdateBakedMaxError( );
+	FreeAlignedFloats( rows );
+	delete [ ] times;
+
+	fprintf( stderr, "Baked animation: %d rows at %g Hz (%d KB), worst error %g\n",
+		BakedRows, BakedRate, (int)( BakedRows*BAKEDSTRIDE*sizeof(float) / 1024 ), BakedMaxError );
+}
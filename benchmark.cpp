@@ -0,0 +1,233 @@
+// the frame timing benchmark -- replaying the animation cycle the same way every time:
+//
+//	"finalproj -benchmark [file.json] [-frames n] [-fps f] [-size w h]"
+//
+//	runs headless (see headless.cpp) and draws the MS_PER_CYCLE animation at a fixed
+//	timestep (60 fps, one whole cycle, by default) once for each LightSwitch mode with
+//	each projection -- every run draws exactly the same frames, so two benchmarks of
+//	the same build on the same machine can be compared frame for frame
+//
+//	each frame's cpu and gpu time comes from frametiming.cpp, split into the Display( )
+//	segments, and the file (benchmark.json by default) gets the mean, p50, p95, p99, and
+//	max of each, for every run and for all of them together
+//
+//	each run starts with BENCHWARMUPFRAMES frames that are drawn but not counted, and the
+//	gpu is waited on after every frame so that the times can be read right away
+
+#include <algorithm>
+#include <vector>
+
+
+const int	BENCHWARMUPFRAMES = 10;
+const int	BENCHLIGHTMODES = 5;			// the LightSwitch values the 'l' key cycles through
+
+char *		BenchmarkFile = NULL;			// != NULL means -benchmark was given
+
+struct BenchmarkRun
+{
+	int							lightSwitch;
+	int							projection;
+	std::vector<struct FrameTiming>	frames;
+};
+
+
+// pick the benchmark option out of the command line:
+// (it means headless, too)
+
+void
+ParseBenchmarkArgs( int argc, char *argv[ ] )
+{
+	for( int i = 1; i < argc; i++ )
+	{
+		if( strcmp( argv[i], "-benchmark" ) == 0 )
+		{
+			BenchmarkFile = (char *)"benchmark.json";
+			if( i+1 < argc  &&  argv[i+1][0] != '-' )
+				BenchmarkFile = argv[++i];
+			HeadlessOn = 1;
+		}
+	}
+}
+
+
+// write the mean and percentiles of a list of times as a json object:
+// (the percentiles are nearest-rank)
+
+void
+WriteTimingStats( FILE *fp, std::vector<double> ms )
+{
+	if( ms.empty( )  ||  ms[0] < 0. )
+	{
+		fprintf( fp, "null" );
+		return;
+	}
+	std::sort( ms.begin( ), ms.end( ) );
+	double sum = 0.;
+	for( size_t i = 0; i < ms.size( ); i++ )
+		sum += ms[i];
+
+	size_t n = ms.size( );
+	double p[3];
+	const double percents[3] = { 50., 95., 99. };
+	for( int k = 0; k < 3; k++ )
+	{
+		size_t rank = (size_t)ceil( percents[k] / 100. * (double)n );
+		p[k] = ms[ rank > 0 ? rank - 1 : 0 ];
+	}
+	fprintf( fp, "{ \"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f }",
+		sum / (double)n, p[0], p[1], p[2], ms[n-1] );
+}
+
+
+// the cpu or gpu times of one segment (or the totals, with -1) out of a list of frames:
+
+std::vector<double>
+SegmentTimes( const std::vector<struct FrameTiming> &frames, int segment, bool gpu )
+{
+	std::vector<double> ms;
+	for( size_t i = 0; i < frames.size( ); i++ )
+	{
+		const struct FrameTiming *ft = &frames[i];
+		if( segment < 0 )
+			ms.push_back( gpu ? ft->gpuTotalMs : ft->cpuTotalMs );
+		else
+			ms.push_back( gpu ? ft->gpuMs[segment] : ft->cpuMs[segment] );
+	}
+	return ms;
+}
+
+
+// the "frame" and "segments" members of a run (or of all of them):
+
+void
+WriteFrameTimings( FILE *fp, const std::vector<struct FrameTiming> &frames, const char *indent )
+{
+	fprintf( fp, "%s\"frames\": %d,\n", indent, (int)frames.size( ) );
+	fprintf( fp, "%s\"cpu_ms\": ", indent );
+	WriteTimingStats( fp, SegmentTimes( frames, -1, false ) );
+	fprintf( fp, ",\n%s\"gpu_ms\": ", indent );
+	WriteTimingStats( fp, SegmentTimes( frames, -1, true ) );
+	fprintf( fp, ",\n%s\"segments\": {\n", indent );
+	for( int s = 0; s < NUMSEGMENTS; s++ )
+	{
+		fprintf( fp, "%s\t\"%s\": {\n%s\t\t\"cpu_ms\": ", indent, SegmentNames[s], indent );
+		WriteTimingStats( fp, SegmentTimes( frames, s, false ) );
+		fprintf( fp, ",\n%s\t\t\"gpu_ms\": ", indent );
+		WriteTimingStats( fp, SegmentTimes( frames, s, true ) );
+		fprintf( fp, "\n%s\t}%s\n", indent, s < NUMSEGMENTS-1 ? "," : "" );
+	}
+	fprintf( fp, "%s}\n", indent );
+}
+
+
+// the median of one run's totals, for the summary on stderr:
+
+double
+MedianMs( const std::vector<struct FrameTiming> &frames, bool gpu )
+{
+	std::vector<double> ms = SegmentTimes( frames, -1, gpu );
+	if( ms.empty( ) )
+		return 0.;
+	std::sort( ms.begin( ), ms.end( ) );
+	return ms[ ms.size( ) / 2 ];
+}
+
+
+// run the benchmark and write the file:
+// (returns 0 if it all worked, so main( ) can exit with it)
+
+int
+RunBenchmark( )
+{
+	int frames = HeadlessFrames;
+	if( frames <= 0 )
+		frames = (int)ceilf( (float)MS_PER_CYCLE * HeadlessFps / 1000.f );
+	double stepMs = 1000. / (double)HeadlessFps;
+
+	int saveLightSwitch = LightSwitch;
+	int saveProjection = NowProjection;
+	FrameTimingOn = 1;
+
+	std::vector<struct BenchmarkRun> runs;
+	const int projections[2] = { PERSP, ORTHO };
+	for( int p = 0; p < 2; p++ )
+	{
+		for( int light = 0; light < BENCHLIGHTMODES; light++ )
+		{
+			struct BenchmarkRun run;
+			run.lightSwitch = light;
+			run.projection = projections[p];
+			LightSwitch = light;
+			NowProjection = projections[p];
+
+			for( int i = -BENCHWARMUPFRAMES; i < frames; i++ )
+			{
+				SceneTimeMs = (double)( i >= 0 ? i : 0 ) * stepMs;
+				Display( );
+				FlushFrameTiming( );
+				if( i >= 0 )
+					run.frames.push_back( *LastFrameTiming( ) );
+			}
+			runs.push_back( run );
+
+			fprintf( stderr, "Benchmark: light %d, %-12s  median %7.3f ms cpu, %7.3f ms gpu\n", light,
+				run.projection == ORTHO ? "orthographic" : "perspective", MedianMs( run.frames, false ),
+				GpuTimersOk ? MedianMs( run.frames, true ) : 0. );
+		}
+	}
+
+	FrameTimingOn = 0;
+	LightSwitch = saveLightSwitch;
+	NowProjection = saveProjection;
+
+	int status = 0;
+	GLenum err = glGetError( );
+	if( err != GL_NO_ERROR )
+	{
+		fprintf( stderr, "Benchmark: GL error 0x%x\n", err );
+		status = 1;
+	}
+
+	FILE *fp = fopen( BenchmarkFile, "w" );
+	if( fp == NULL )
+	{
+		fprintf( stderr, "Cannot write benchmark file '%s'\n", BenchmarkFile );
+		return 1;
+	}
+
+	fprintf( fp, "{\n" );
+	fprintf( fp, "\t\"renderer\": \"%s\",\n", (const char *)glGetString( GL_RENDERER ) );
+	fprintf( fp, "\t\"gl_version\": \"%s\",\n", (const char *)glGetString( GL_VERSION ) );
+	fprintf( fp, "\t\"width\": %d,\n\t\"height\": %d,\n", HeadlessWidth, HeadlessHeight );
+	fprintf( fp, "\t\"fps\": %g,\n\t\"cycle_ms\": %d,\n", HeadlessFps, MS_PER_CYCLE );
+	fprintf( fp, "\t\"warmup_frames\": %d,\n", BENCHWARMUPFRAMES );
+	fprintf( fp, "\t\"grid_res\": %d,\n\t\"buffers\": %d,\n\t\"quantized\": %d,\n\t\"baked\": %d,\n\t\"culling\": %d,\n",
+		GridRes, BuffersOn, QuantizedOn, BakedOn, CullingOn );
+	fprintf( fp, "\t\"gpu_timers\": %s,\n", GpuTimersOk ? "true" : "false" );
+
+	fprintf( fp, "\t\"runs\": [\n" );
+	std::vector<struct FrameTiming> all;
+	for( size_t r = 0; r < runs.size( ); r++ )
+	{
+		fprintf( fp, "\t\t{\n" );
+		fprintf( fp, "\t\t\t\"light_switch\": %d,\n", runs[r].lightSwitch );
+		fprintf( fp, "\t\t\t\"projection\": \"%s\",\n", runs[r].projection == ORTHO ? "orthographic" : "perspective" );
+		WriteFrameTimings( fp, runs[r].frames, "\t\t\t" );
+		fprintf( fp, "\t\t}%s\n", r < runs.size( )-1 ? "," : "" );
+		all.insert( all.end( ), runs[r].frames.begin( ), runs[r].frames.end( ) );
+	}
+	fprintf( fp, "\t],\n" );
+
+	fprintf( fp, "\t\"overall\": {\n" );
+	WriteFrameTimings( fp, all, "\t\t" );
+	fprintf( fp, "\t}\n" );
+	fprintf( fp, "}\n" );
+
+	if( ferror( fp ) != 0 )
+		status = 1;
+	fclose( fp );
+
+	fprintf( stderr, "Benchmark: %d runs of %d frames at %.3f ms steps, written to '%s'\n",
+		(int)runs.size( ), frames, stepMs, BenchmarkFile );
+	return status;
+}
@@ -0,0 +1,291 @@
+// a bmp loader that maps the file and converts whole rows at a time:
+//
+//	BmpToTexture( ) reads a bmp a byte at a time with fgetc( ) -- this one maps the file
+//	(see mappedfile.cpp), checks the headers, and turns each row of BGR or BGRA texels
+//	into the bottom-to-top RGB rows opengl wants, with no copy of the file in between --
+//	LoadBmp( ) returns them in a new'd array, like BmpToTexture( ) does
+//
+//	it takes uncompressed 24-bit and 32-bit files (32-bit BI_BITFIELDS too, as long as
+//	the masks are the usual BGRA ones), with the rows padded out to 4 bytes, stored
+//	either bottom-up (the usual way) or top-down (a negative height), which just
+//	means reading the rows in the other order
+//
+//	the BGR -> RGB swizzle is one SSSE3 byte shuffle per 5 texels (24-bit) or 4 texels
+//	(32-bit) -- the shuffle is compiled in on x86 and only used if the cpu has it
+//
+//	"finalproj -bench-bmp file.bmp" times this against BmpToTexture( ), checks that they
+//	make the same texels, and quits
+
+#include <chrono>
+#include <algorithm>
+#include <vector>
+
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+#include <tmmintrin.h>
+#define BMP_SSSE3
+#define BMP_SSSE3_TARGET	__attribute__(( target( "ssse3" ) ))
+#elif defined(_M_X64)
+#include <tmmintrin.h>
+#include <intrin.h>
+#define BMP_SSSE3
+#define BMP_SSSE3_TARGET
+#endif
+
+
+struct BmpImage
+{
+	struct MappedFile	file;
+	int					width, height;
+	int					bitsPerPixel;		// 24 or 32
+	int					rowBytes;			// with the padding
+	bool				topDown;			// != 0 if the first row in the file is the top one
+	const unsigned char *	texels;			// the first row in the file
+};
+
+
+// little-endian fields out of the headers:
+
+int
+BmpInt( const unsigned char *p )
+{
+	return (int)( p[0] | ( p[1] << 8 ) | ( p[2] << 16 ) | ( (unsigned int)p[3] << 24 ) );
+}
+
+
+int
+BmpShort( const unsigned char *p )
+{
+	return p[0] | ( p[1] << 8 );
+}
+
+
+void
+CloseBmp( struct BmpImage *bmp )
+{
+	UnmapFile( &bmp->file );
+}
+
+
+// map a bmp file and check that it is one this loader can read:
+
+bool
+OpenBmp( const char *filename, struct BmpImage *bmp )
+{
+	if( ! MapFile( filename, &bmp->file ) )
+	{
+		fprintf( stderr, "Cannot open Bmp file '%s'\n", filename );
+		return false;
+	}
+
+	const unsigned char *d = bmp->file.data;
+	size_t size = bmp->file.size;
+	if( size < 54  ||  d[0] != 'B'  ||  d[1] != 'M' )
+	{
+		fprintf( stderr, "'%s' is not a Bmp file\n", filename );
+		CloseBmp( bmp );
+		return false;
+	}
+
+	int offset      = BmpInt( &d[10] );
+	int headerSize  = BmpInt( &d[14] );
+	bmp->width      = BmpInt( &d[18] );
+	int height      = BmpInt( &d[22] );
+	bmp->bitsPerPixel = BmpShort( &d[28] );
+	int compression = BmpInt( &d[30] );
+	bmp->topDown    = ( height < 0 );
+	bmp->height     = bmp->topDown ? -height : height;
+
+	// a 32-bit bitfields file is fine if its masks put the bytes in BGRA order:
+	// (the masks follow a 40-byte header, or are inside a bigger one)
+
+	bool bitfieldsOk = false;
+	if( compression == 3  &&  bmp->bitsPerPixel == 32  &&  size >= 14 + 40 + 12 )
+	{
+		bitfieldsOk = BmpInt( &d[54] ) == 0x00ff0000  &&  BmpInt( &d[58] ) == 0x0000ff00  &&  BmpInt( &d[62] ) == 0x000000ff;
+	}
+
+	if( ( bmp->bitsPerPixel != 24  &&  bmp->bitsPerPixel != 32 )  ||  ( compression != 0  &&  ! bitfieldsOk )
+		||  headerSize < 40  ||  bmp->width <= 0  ||  bmp->height <= 0 )
+	{
+		fprintf( stderr, "'%s' is a %d-bit Bmp file with compression %d -- only uncompressed 24 and 32 bits are handled\n",
+			filename, bmp->bitsPerPixel, compression );
+		CloseBmp( bmp );
+		return false;
+	}
+
+	bmp->rowBytes = ( ( bmp->width * bmp->bitsPerPixel + 31 ) / 32 ) * 4;
+	if( offset < 54  ||  (long long)offset + (long long)bmp->rowBytes * bmp->height > (long long)size )
+	{
+		fprintf( stderr, "'%s' is truncated\n", filename );
+		CloseBmp( bmp );
+		return false;
+	}
+	bmp->texels = d + offset;
+	return true;
+}
+
+
+// the plain c versions of the row kernels:
+
+void
+SwizzleBGRRow( const unsigned char *src, unsigned char *dst, int n )
+{
+	for( int i = 0; i < n; i++, src += 3, dst += 3 )
+	{
+		dst[0] = src[2];
+		dst[1] = src[1];
+		dst[2] = src[0];
+	}
+}
+
+
+void
+SwizzleBGRARow( const unsigned char *src, unsigned char *dst, int n )
+{
+	for( int i = 0; i < n; i++, src += 4, dst += 3 )
+	{
+		dst[0] = src[2];
+		dst[1] = src[1];
+		dst[2] = src[0];
+	}
+}
+
+
+#ifdef BMP_SSSE3
+
+// each shuffle stores 16 bytes but only keeps 15 (or 12) of them -- the extra bytes are
+// overwritten by the next shuffle, so the loop stops while there are still at least 16
+// bytes of the row left to write and the tail is done by the c version:
+
+BMP_SSSE3_TARGET void
+SwizzleBGRRowSSSE3( const unsigned char *src, unsigned char *dst, int n )
+{
+	const __m128i shuffle = _mm_setr_epi8( 2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15 );
+	int i = 0;
+	for( ; i + 6 <= n; i += 5 )
+	{
+		__m128i bgr = _mm_loadu_si128( (const __m128i *)( src + 3*i ) );
+		_mm_storeu_si128( (__m128i *)( dst + 3*i ), _mm_shuffle_epi8( bgr, shuffle ) );
+	}
+	SwizzleBGRRow( src + 3*i, dst + 3*i, n - i );
+}
+
+
+BMP_SSSE3_TARGET void
+SwizzleBGRARowSSSE3( const unsigned char *src, unsigned char *dst, int n )
+{
+	const __m128i shuffle = _mm_setr_epi8( 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1 );
+	int i = 0;
+	for( ; i + 6 <= n; i += 4 )
+	{
+		__m128i bgra = _mm_loadu_si128( (const __m128i *)( src + 4*i ) );
+		_mm_storeu_si128( (__m128i *)( dst + 3*i ), _mm_shuffle_epi8( bgra, shuffle ) );
+	}
+	SwizzleBGRARow( src + 4*i, dst + 3*i, n - i );
+}
+
+
+bool
+BmpHasSSSE3( )
+{
+#ifdef _M_X64
+	int info[4];
+	__cpuid( info, 1 );
+	return ( info[2] & ( 1 << 9 ) ) != 0;
+#else
+	return __builtin_cpu_supports( "ssse3" );
+#endif
+}
+
+#endif
+
+
+// write the texels as bottom-to-top RGB rows into dst (3 * width * height bytes):
+
+void
+DecodeBmp( const struct BmpImage *bmp, unsigned char *dst )
+{
+	void (*swizzle)( const unsigned char *, unsigned char *, int ) =
+		( bmp->bitsPerPixel == 32 ) ? SwizzleBGRARow : SwizzleBGRRow;
+#ifdef BMP_SSSE3
+	static const bool ssse3 = BmpHasSSSE3( );
+	if( ssse3 )
+		swizzle = ( bmp->bitsPerPixel == 32 ) ? SwizzleBGRARowSSSE3 : SwizzleBGRRowSSSE3;
+#endif
+
+	int dstRowBytes = 3 * bmp->width;
+	for( int t = 0; t < bmp->height; t++ )
+	{
+		int fileRow = bmp->topDown ? ( bmp->height - 1 - t ) : t;
+		swizzle( bmp->texels + (size_t)fileRow * bmp->rowBytes, dst + (size_t)t * dstRowBytes, bmp->width );
+	}
+}
+
+
+// the drop-in replacement for BmpToTexture( ):
+
+unsigned char *
+LoadBmp( const char *filename, int *width, int *height )
+{
+	struct BmpImage bmp;
+	if( ! OpenBmp( filename, &bmp ) )
+		return NULL;
+	*width = bmp.width;
+	*height = bmp.height;
+	unsigned char *texture = new unsigned char[ 3 * bmp.width * bmp.height ];
+	DecodeBmp( &bmp, texture );
+	CloseBmp( &bmp );
+	return texture;
+}
+
+
+// time LoadBmp( ) against BmpToTexture( ) on one file:
+// (returns 0 if they made the same texels, so main( ) can exit with it)
+
+int
+BenchmarkBmp( char *filename, int iterations )
+{
+	if( iterations < 1 )
+		iterations = 1;
+
+	std::vector<double> oldMs, newMs;
+	unsigned char *oldTexels = NULL, *newTexels = NULL;
+	int w0 = 0, h0 = 0, w1 = 0, h1 = 0;
+	for( int i = 0; i < iterations; i++ )
+	{
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now( );
+		unsigned char *a = BmpToTexture( filename, &w0, &h0 );
+		std::chrono::high_resolution_clock::time_point middle = std::chrono::high_resolution_clock::now( );
+		unsigned char *b = LoadBmp( filename, &w1, &h1 );
+		std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now( );
+		if( a == NULL  ||  b == NULL )
+		{
+			fprintf( stderr, "Cannot benchmark '%s': it can't be read\n", filename );
+			delete [ ] a;
+			delete [ ] b;
+			return 1;
+		}
+		oldMs.push_back( std::chrono::duration<double, std::milli>( middle - start ).count( ) );
+		newMs.push_back( std::chrono::duration<double, std::milli>( end - middle ).count( ) );
+		delete [ ] oldTexels;
+		delete [ ] newTexels;
+		oldTexels = a;
+		newTexels = b;
+	}
+	std::sort( oldMs.begin( ), oldMs.end( ) );
+	std::sort( newMs.begin( ), newMs.end( ) );
+
+	bool same = ( w0 == w1  &&  h0 == h1  &&  memcmp( oldTexels, newTexels, 3 * w0 * h0 ) == 0 );
+	double mb = 3. * w0 * h0 / ( 1024. * 1024. );
+	double oldMedian = oldMs[ oldMs.size( ) / 2 ];
+	double newMedian = newMs[ newMs.size( ) / 2 ];
+	fprintf( stderr, "'%s': %d x %d, %d runs each\n", filename, w0, h0, iterations );
+	fprintf( stderr, "  BmpToTexture: min %.3f ms, median %.3f ms (%.0f MB/s)\n", oldMs[0], oldMedian, mb / ( oldMedian / 1000. ) );
+	fprintf( stderr, "  LoadBmp:      min %.3f ms, median %.3f ms (%.0f MB/s), %.1fx faster\n", newMs[0], newMedian,
+		mb / ( newMedian / 1000. ), oldMedian / newMedian );
+	fprintf( stderr, "  texels %s\n", same ? "match" : "DO NOT MATCH" );
+
+	delete [ ] oldTexels;
+	delete [ ] newTexels;
+	return same ? 0 : 1;
+}
@@ -0,0 +1,189 @@
+// bounding boxes and view-frustum culling:
+//
+//	every drawable gets an axis-aligned box in its own (object) coordinates when its
+//	display list or buffer is built -- at draw time, the box is tested against the
+//	view frustum using the modelview the draw queue placed the object with, so the
+//	test follows the same translate/rotate calls that place the object
+//
+//	the frustum planes come straight out of projection*modelview (the rows of the
+//	combined matrix added and subtracted), so the box never has to be moved into
+//	world or eye coordinates
+
+
+struct BoundingBox
+{
+	float	xmin, ymin, zmin;
+	float	xmax, ymax, zmax;
+};
+
+// how many drawables were tested, thrown away, and drawn this frame:
+
+struct CullStats
+{
+	int		tested;
+	int		frustumCulled;
+	int		conditional;			// left to an occlusion query on the gpu -- which may or may not have skipped them
+	int		drawn;
+};
+
+int				CullingOn = 1;			// != 0 means to skip things that can't be seen
+struct CullStats	CullCounts;			// this frame's counts
+GLfloat			CullProjection[16];		// this frame's projection matrix
+
+
+// start with an "empty" box that the first point will snap to:
+
+void
+InitBox( struct BoundingBox *box )
+{
+	box->xmin = box->ymin = box->zmin =  1.e30f;
+	box->xmax = box->ymax = box->zmax = -1.e30f;
+}
+
+
+void
+ExpandBox( struct BoundingBox *box, float x, float y, float z )
+{
+	if( x < box->xmin )	box->xmin = x;
+	if( y < box->ymin )	box->ymin = y;
+	if( z < box->zmin )	box->zmin = z;
+	if( x > box->xmax )	box->xmax = x;
+	if( y > box->ymax )	box->ymax = y;
+	if( z > box->zmax )	box->zmax = z;
+}
+
+
+// opengl-order (column-major) 4x4 matrix multiply, out = a * b:
+// (out must not be a or b)
+
+void
+MulMatrix( const GLfloat a[16], const GLfloat b[16], GLfloat out[16] )
+{
+	for( int c = 0; c < 4; c++ )
+	{
+		for( int r = 0; r < 4; r++ )
+		{
+			out[4*c+r] = a[0*4+r]*b[4*c+0] + a[1*4+r]*b[4*c+1] + a[2*4+r]*b[4*c+2] + a[3*4+r]*b[4*c+3];
+		}
+	}
+}
+
+
+// transform a box by a matrix and re-box the 8 transformed corners:
+
+void
+TransformBox( const struct BoundingBox *in, const GLfloat m[16], struct BoundingBox *out )
+{
+	struct BoundingBox box;
+	InitBox( &box );
+	for( int i = 0; i < 8; i++ )
+	{
+		float x = ( i & 1 ) ? in->xmax : in->xmin;
+		float y = ( i & 2 ) ? in->ymax : in->ymin;
+		float z = ( i & 4 ) ? in->zmax : in->zmin;
+		ExpandBox( &box,	m[0]*x + m[4]*y + m[8]*z  + m[12],
+							m[1]*x + m[5]*y + m[9]*z  + m[13],
+							m[2]*x + m[6]*y + m[10]*z + m[14] );
+	}
+	*out = box;
+}
+
+
+// the box of a mesh's vertices, after the rotate-then-scale that its display list applies:
+// (angle == 0. means no rotation)
+
+void
+MeshBox( const struct ObjMesh *mesh, float angle, float ax, float ay, float az, float scale, struct BoundingBox *box )
+{
+	InitBox( box );
+	if( mesh->numVertices == 0 )
+	{
+		box->xmin = box->ymin = box->zmin = box->xmax = box->ymax = box->zmax = 0.;
+		return;
+	}
+
+	struct BoundingBox raw;
+	InitBox( &raw );
+	for( int i = 0; i < mesh->numVertices; i++ )
+	{
+		const float *pos = &mesh->vertices[ i*OBJVERTEXFLOATS + 5 ];
+		ExpandBox( &raw, pos[0], pos[1], pos[2] );
+	}
+
+	GLfloat m[16];
+	glMatrixMode( GL_MODELVIEW );
+	glPushMatrix( );
+		glLoadIdentity( );
+		if( angle != 0. )
+			glRotatef( angle, ax, ay, az );
+		glScalef( scale, scale, scale );
+		glGetFloatv( GL_MODELVIEW_MATRIX, m );
+	glPopMatrix( );
+
+	TransformBox( &raw, m, box );
+}
+
+
+// remember this frame's projection matrix and zero the counts:
+// (call this right after the projection has been set)
+
+void
+BeginCulling( )
+{
+	glGetFloatv( GL_PROJECTION_MATRIX, CullProjection );
+	CullCounts.tested = CullCounts.frustumCulled = CullCounts.conditional = CullCounts.drawn = 0;
+}
+
+
+// is any part of an object-space box inside the frustum, for a given modelview?
+
+bool
+BoxInFrustum( const struct BoundingBox *box, const GLfloat modelview[16] )
+{
+	GLfloat m[16];
+	MulMatrix( CullProjection, modelview, m );
+
+	// each plane is row 3 plus or minus row 0, 1, or 2 of the clip matrix:
+
+	for( int p = 0; p < 6; p++ )
+	{
+		int row = p / 2;
+		float sign = ( p & 1 ) ? -1.f : 1.f;
+		float a = m[3]  + sign*m[row];
+		float b = m[7]  + sign*m[4+row];
+		float c = m[11] + sign*m[8+row];
+		float d = m[15] + sign*m[12+row];
+
+		// test the corner that is farthest along the plane normal:
+
+		float x = ( a >= 0. ) ? box->xmax : box->xmin;
+		float y = ( b >= 0. ) ? box->ymax : box->ymin;
+		float z = ( c >= 0. ) ? box->zmax : box->zmin;
+		if( a*x + b*y + c*z + d < 0. )
+			return false;
+	}
+	return true;
+}
+
+
+// should we draw something with this object-space box at a modelview?
+// (this also keeps the culled / drawn counts)
+
+bool
+BoxVisible( const struct BoundingBox *box, const GLfloat modelview[16] )
+{
+	CullCounts.tested++;
+	if( CullingOn == 0 )
+	{
+		CullCounts.drawn++;
+		return true;
+	}
+
+	if( ! BoxInFrustum( box, modelview ) )
+	{
+		CullCounts.frustumCulled++;
+		return false;
+	}
+	CullCounts.drawn++;
+	return true;
+}
@@ -0,0 +1,628 @@
+// the distance field -- how far any point near a mesh is from it, baked once and kept on disk:
+//
+//	the ball is a sphere, so all it needs to know about a mesh is how far its center is
+//	from it, and which way is out -- each obj mesh's collision triangles (see physics.cpp)
+//	are sampled every FIELDCELL units on a grid around the mesh, and a lookup is the 8
+//	samples around a point, blended trilinearly (their differences give the gradient,
+//	which is the way out)
+//
+//	only the grid near the surface is kept -- it is cut into bricks of FIELDBRICK^3 cells,
+//	and a brick that no triangle comes within FIELDBAND of isn't stored at all (everything
+//	in it is "FIELDBAND or farther"); a stored brick has all (FIELDBRICK+1)^3 of its own
+//	samples, so a lookup never reaches into the next brick, as shorts FIELDQUANTUM apart
+//	-- so the field is only right nearer than FIELDBAND, which is farther than the ball
+//	ever looks
+//
+//	a lookup is about 30 ns, where the triangles' own distance is 300 to 1800 (and the
+//	table's big field, which doesn't fit in the cache, about 55)
+//
+//	the distances aren't signed -- an obj mesh is just triangles (parts can run into each
+//	other, or not be closed) with no inside to speak of, and the ball is always outside
+//	them anyway: how far into a piece it is is BALLRADIUS less its distance
+//
+//	baking is every sample against every triangle near its brick, on all the cores -- and
+//	then it is written next to the obj file, as "<file>.sdf":
+//
+//		FieldHeader
+//		int		brickIndex[ dims[0]*dims[1]*dims[2] ]		-1 for a brick that isn't stored
+//		unsigned short	samples[ numBricks ][ FIELDSAMPLES^3 ]
+//
+//	the header remembers a hash of the triangles it was baked from (after the rotation and
+//	ScaleFactor its display list has), so changing the mesh bakes it again
+//
+//	baked or read, each field is checked against its triangles: at FIELDCHECKS points near
+//	the surface, the field's distance and the one from all of the triangles -- a field off
+//	by more than FIELDTOLERANCE somewhere isn't used, and the ball goes on hitting the
+//	triangles
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+
+const char	FIELDMAGIC[8] = { 'P', 'N', 'B', 'A', 'L', 'L', 'D', 'F' };
+const int	FIELDVERSION = 2;
+
+const float	FIELDCELL = 0.05f;					// units between samples -- the ball's radius is 7 of them
+const int	FIELDBRICKSHIFT = 3;
+const int	FIELDBRICK = 1 << FIELDBRICKSHIFT;	// cells along a brick's side
+const int	FIELDSAMPLES = FIELDBRICK + 1;		// samples along a brick's side
+const int	FIELDBRICKSAMPLES = FIELDSAMPLES * FIELDSAMPLES * FIELDSAMPLES;
+const float	FIELDBAND = 0.5f;					// farther than any contact the ball can have
+const float	FIELDQUANTUM = FIELDBAND / 65535.f;
+const int	FIELDCHECKS = 4096;
+const int	FIELDTIMINGPASSES = 4;
+const float	FIELDTOLERANCE = FIELDCELL;			// as far off as blending across a crease can be
+
+// one of a mesh's triangles, the way its display list draws it:
+
+struct CollisionTriangle
+{
+	float		v[3][3];
+	float		min[3], max[3];
+};
+
+struct DistanceField
+{
+	float		origin[3];				// where sample 0, 0, 0 of brick 0, 0, 0 is
+	int			dims[3];				// in bricks
+	int			numBricks;				// stored
+	int *		brickIndex;				// NULL if the mesh has no field
+	unsigned short *	samples;
+};
+
+struct FieldHeader
+{
+	char				magic[8];
+	int					version;
+	unsigned long long	hash;			// of the triangles
+	float				cell;
+	float				band;
+	float				origin[3];
+	int					dims[3];
+	int					numBricks;
+};
+
+int		FieldOn = 1;					// != 0 means the ball uses the meshes' fields, where they have one
+
+
+// the closest point to p on a triangle:
+// (from the voronoi regions of its corners, edges, and face)
+
+void
+ClosestOnTriangle( const float p[3], const float a[3], const float b[3], const float c[3], float out[3] )
+{
+	float ab[3], ac[3], ap[3];
+	for( int j = 0; j < 3; j++ )
+	{
+		ab[j] = b[j] - a[j];
+		ac[j] = c[j] - a[j];
+		ap[j] = p[j] - a[j];
+	}
+	float d1 = Dot( ab, ap );
+	float d2 = Dot( ac, ap );
+	if( d1 <= 0.f  &&  d2 <= 0.f )
+	{
+		memcpy( out, a, 3*sizeof(float) );
+		return;
+	}
+
+	float bp[3];
+	for( int j = 0; j < 3; j++ )
+		bp[j] = p[j] - b[j];
+	float d3 = Dot( ab, bp );
+	float d4 = Dot( ac, bp );
+	if( d3 >= 0.f  &&  d4 <= d3 )
+	{
+		memcpy( out, b, 3*sizeof(float) );
+		return;
+	}
+
+	float vc = d1*d4 - d3*d2;
+	if( vc <= 0.f  &&  d1 >= 0.f  &&  d3 <= 0.f )
+	{
+		float v = d1 / ( d1 - d3 );
+		for( int j = 0; j < 3; j++ )
+			out[j] = a[j] + v*ab[j];
+		return;
+	}
+
+	float cp[3];
+	for( int j = 0; j < 3; j++ )
+		cp[j] = p[j] - c[j];
+	float d5 = Dot( ab, cp );
+	float d6 = Dot( ac, cp );
+	if( d6 >= 0.f  &&  d5 <= d6 )
+	{
+		memcpy( out, c, 3*sizeof(float) );
+		return;
+	}
+
+	float vb = d5*d2 - d1*d6;
+	if( vb <= 0.f  &&  d2 >= 0.f  &&  d6 <= 0.f )
+	{
+		float w = d2 / ( d2 - d6 );
+		for( int j = 0; j < 3; j++ )
+			out[j] = a[j] + w*ac[j];
+		return;
+	}
+
+	float va = d3*d6 - d5*d4;
+	if( va <= 0.f  &&  ( d4 - d3 ) >= 0.f  &&  ( d5 - d6 ) >= 0.f )
+	{
+		float w = ( d4 - d3 ) / ( ( d4 - d3 ) + ( d5 - d6 ) );
+		for( int j = 0; j < 3; j++ )
+			out[j] = b[j] + w*( c[j] - b[j] );
+		return;
+	}
+
+	float denom = 1.f / ( va + vb + vc );
+	float v = vb * denom;
+	float w = vc * denom;
+	for( int j = 0; j < 3; j++ )
+		out[j] = a[j] + v*ab[j] + w*ac[j];
+}
+
+
+// the distance from p to the nearest of some triangles, or FIELDBAND if none is that near:
+// (list is which of them to look at, or NULL for all of them -- and if away isn't NULL, it
+// gets p less the nearest point)
+
+float
+TriangleDistance( const float p[3], const struct CollisionTriangle *triangles, const int *list, int n,
+	float away[3] = NULL )
+{
+	float best2 = FIELDBAND * FIELDBAND;
+	for( int i = 0; i < n; i++ )
+	{
+		const struct CollisionTriangle *tri = &triangles[ ( list != NULL ) ? list[i] : i ];
+
+		// (nothing in the triangle's box can be nearer than the box is)
+		float box2 = 0.f;
+		for( int j = 0; j < 3; j++ )
+		{
+			float out = fmaxf( tri->min[j] - p[j], p[j] - tri->max[j] );
+			if( out > 0.f )
+				box2 += out*out;
+		}
+		if( box2 >= best2 )
+			continue;
+
+		float q[3];
+		ClosestOnTriangle( p, tri->v[0], tri->v[1], tri->v[2], q );
+		float d[3] = { p[0] - q[0], p[1] - q[1], p[2] - q[2] };
+		float d2 = Dot( d, d );
+		if( d2 < best2 )
+		{
+			best2 = d2;
+			if( away != NULL )
+				memcpy( away, d, sizeof(d) );
+		}
+	}
+	return sqrtf( best2 );
+}
+
+
+// room for a field's samples:
+// (and one more, so that an 8-wide lookup can read 32 bits at the last one -- see multiball.cpp)
+
+unsigned short *
+NewFieldSamples( size_t n )
+{
+	unsigned short *samples = new unsigned short[ n + 1 ];
+	samples[n] = 0;
+	return samples;
+}
+
+
+void
+FreeDistanceField( struct DistanceField *f )
+{
+	delete [ ] f->brickIndex;
+	delete [ ] f->samples;
+	memset( f, 0, sizeof(*f) );
+}
+
+
+// the distance from p to the mesh, and its gradient (which isn't quite unit length):
+// (outside the stored bricks it is FIELDBAND with no gradient)
+
+inline float
+FieldDistance( const struct DistanceField *f, const float p[3], float gradient[3] )
+{
+	float gx = ( p[0] - f->origin[0] ) * ( 1.f / FIELDCELL );
+	float gy = ( p[1] - f->origin[1] ) * ( 1.f / FIELDCELL );
+	float gz = ( p[2] - f->origin[2] ) * ( 1.f / FIELDCELL );
+	int cx = (int)gx;
+	int cy = (int)gy;
+	int cz = (int)gz;
+
+	// (the bricks are cells shifted down, not divided; a g just under 0 still rounds to cell 0,
+	// so the near side is g that's checked, and the far side is the brick)
+	unsigned int bx = (unsigned int)cx >> FIELDBRICKSHIFT;
+	unsigned int by = (unsigned int)cy >> FIELDBRICKSHIFT;
+	unsigned int bz = (unsigned int)cz >> FIELDBRICKSHIFT;
+	int b;
+	if( gx < 0.f  ||  gy < 0.f  ||  gz < 0.f
+	  ||  bx >= (unsigned int)f->dims[0]  ||  by >= (unsigned int)f->dims[1]  ||  bz >= (unsigned int)f->dims[2]
+	  ||  ( b = f->brickIndex[ ( bz*f->dims[1] + by )*f->dims[0] + bx ] ) < 0 )
+	{
+		gradient[0] = gradient[1] = gradient[2] = 0.f;
+		return FIELDBAND;
+	}
+
+	float tx = gx - (float)cx;
+	float ty = gy - (float)cy;
+	float tz = gz - (float)cz;
+	const int m = FIELDBRICK - 1;
+	const unsigned short *s = &f->samples[ (size_t)b*FIELDBRICKSAMPLES
+		+ ( ( cz & m )*FIELDSAMPLES + ( cy & m ) )*FIELDSAMPLES + ( cx & m ) ];
+	const int dy = FIELDSAMPLES;
+	const int dz = FIELDSAMPLES * FIELDSAMPLES;
+	float s000 = s[0],     s100 = s[1],       s010 = s[dy],      s110 = s[dy+1];
+	float s001 = s[dz],    s101 = s[dz+1],    s011 = s[dz+dy],   s111 = s[dz+dy+1];
+
+	// along x first, then y, then z:
+	float x00 = s000 + tx*( s100 - s000 );
+	float x10 = s010 + tx*( s110 - s010 );
+	float x01 = s001 + tx*( s101 - s001 );
+	float x11 = s011 + tx*( s111 - s011 );
+	float y0 = x00 + ty*( x10 - x00 );
+	float y1 = x01 + ty*( x11 - x01 );
+
+	const float scale = FIELDQUANTUM / FIELDCELL;
+	float dx0 = ( s100 - s000 ) + ty*( ( s110 - s010 ) - ( s100 - s000 ) );
+	float dx1 = ( s101 - s001 ) + ty*( ( s111 - s011 ) - ( s101 - s001 ) );
+	gradient[0] = scale * ( dx0 + tz*( dx1 - dx0 ) );
+	gradient[1] = scale * ( ( x10 - x00 ) + tz*( ( x11 - x01 ) - ( x10 - x00 ) ) );
+	gradient[2] = scale * ( y1 - y0 );
+	return FIELDQUANTUM * ( y0 + tz*( y1 - y0 ) );
+}
+
+
+// a hash of some triangles, to tell whether a cached field is still theirs:
+// (64-bit fnv-1a)
+
+unsigned long long
+HashTriangles( const struct CollisionTriangle *triangles, int numTriangles )
+{
+	unsigned long long h = 14695981039346656037ULL;
+	for( int i = 0; i < numTriangles; i++ )
+	{
+		const unsigned char *bytes = (const unsigned char *)triangles[i].v;
+		for( size_t k = 0; k < sizeof(triangles[i].v); k++ )
+		{
+			h ^= bytes[k];
+			h *= 1099511628211ULL;
+		}
+	}
+	return h;
+}
+
+
+// bake the field for some triangles:
+
+void
+BakeDistanceField( const struct CollisionTriangle *triangles, int numTriangles, struct DistanceField *f )
+{
+	float min[3], max[3];
+	for( int j = 0; j < 3; j++ )
+	{
+		min[j] = triangles[0].min[j];
+		max[j] = triangles[0].max[j];
+	}
+	for( int i = 1; i < numTriangles; i++ )
+	{
+		for( int j = 0; j < 3; j++ )
+		{
+			min[j] = fminf( min[j], triangles[i].min[j] );
+			max[j] = fmaxf( max[j], triangles[i].max[j] );
+		}
+	}
+
+	const float brickSize = FIELDCELL * (float)FIELDBRICK;
+	for( int j = 0; j < 3; j++ )
+	{
+		f->origin[j] = min[j] - FIELDBAND;
+		f->dims[j] = (int)ceilf( ( max[j] - min[j] + 2.f*FIELDBAND ) / brickSize );
+		if( f->dims[j] < 1 )
+			f->dims[j] = 1;
+	}
+	int gridBricks = f->dims[0] * f->dims[1] * f->dims[2];
+
+	// each brick gets the triangles whose boxes come within FIELDBAND of it -- that's every one
+	// that can be the nearest to a sample in it, if any is nearer than FIELDBAND:
+
+	std::vector< std::vector<int> > near( gridBricks );
+	for( int i = 0; i < numTriangles; i++ )
+	{
+		int lo[3], hi[3];
+		for( int j = 0; j < 3; j++ )
+		{
+			lo[j] = (int)floorf( ( triangles[i].min[j] - FIELDBAND - f->origin[j] ) / brickSize );
+			hi[j] = (int)floorf( ( triangles[i].max[j] + FIELDBAND - f->origin[j] ) / brickSize );
+			lo[j] = ( lo[j] < 0 ) ? 0 : lo[j];
+			hi[j] = ( hi[j] >= f->dims[j] ) ? f->dims[j] - 1 : hi[j];
+		}
+		for( int bz = lo[2]; bz <= hi[2]; bz++ )
+			for( int by = lo[1]; by <= hi[1]; by++ )
+				for( int bx = lo[0]; bx <= hi[0]; bx++ )
+					near[ ( bz*f->dims[1] + by )*f->dims[0] + bx ].push_back( i );
+	}
+
+	f->brickIndex = new int[ gridBricks ];
+	std::vector<int> stored;
+	for( int b = 0; b < gridBricks; b++ )
+	{
+		f->brickIndex[b] = near[b].empty( ) ? -1 : (int)stored.size( );
+		if( ! near[b].empty( ) )
+			stored.push_back( b );
+	}
+	f->numBricks = (int)stored.size( );
+	f->samples = NewFieldSamples( (size_t)f->numBricks * FIELDBRICKSAMPLES );
+
+	// the bricks are shared out among the cores as they finish:
+
+	std::atomic<int> next( 0 );
+	auto work = [ & ]( )
+	{
+		int k;
+		while( ( k = next++ ) < f->numBricks )
+		{
+			int b = stored[k];
+			int bx = b % f->dims[0];
+			int by = ( b / f->dims[0] ) % f->dims[1];
+			int bz = b / ( f->dims[0] * f->dims[1] );
+			const std::vector<int> &list = near[b];
+			unsigned short *s = &f->samples[ (size_t)k * FIELDBRICKSAMPLES ];
+			for( int z = 0; z < FIELDSAMPLES; z++ )
+				for( int y = 0; y < FIELDSAMPLES; y++ )
+					for( int x = 0; x < FIELDSAMPLES; x++ )
+					{
+						float p[3] =
+						{
+							f->origin[0] + FIELDCELL * (float)( bx*FIELDBRICK + x ),
+							f->origin[1] + FIELDCELL * (float)( by*FIELDBRICK + y ),
+							f->origin[2] + FIELDCELL * (float)( bz*FIELDBRICK + z )
+						};
+						float d = TriangleDistance( p, triangles, &list[0], (int)list.size( ) );
+						*s++ = (unsigned short)lrintf( d / FIELDQUANTUM );
+					}
+		}
+	};
+	std::vector<std::thread> workers;
+	for( int i = 1; i < NumCores( ); i++ )
+		workers.push_back( std::thread( work ) );
+	work( );
+	for( size_t i = 0; i < workers.size( ); i++ )
+		workers[i].join( );
+
+	// a triangle's box can come near a brick that the triangle itself doesn't (a long slanted
+	// one's box is mostly empty) -- a brick whose samples all came out at FIELDBAND reads the
+	// same as one that isn't there, so only the others are kept:
+
+	std::vector<int> kept;
+	for( int k = 0; k < f->numBricks; k++ )
+	{
+		const unsigned short *s = &f->samples[ (size_t)k * FIELDBRICKSAMPLES ];
+		bool empty = true;
+		for( int i = 0; empty  &&  i < FIELDBRICKSAMPLES; i++ )
+			empty = ( s[i] == 65535 );
+		f->brickIndex[ stored[k] ] = empty ? -1 : (int)kept.size( );
+		if( ! empty )
+			kept.push_back( k );
+	}
+	unsigned short *samples = NewFieldSamples( kept.size( ) * FIELDBRICKSAMPLES );
+	for( size_t i = 0; i < kept.size( ); i++ )
+		memcpy( &samples[ i * FIELDBRICKSAMPLES ], &f->samples[ (size_t)kept[i] * FIELDBRICKSAMPLES ],
+			FIELDBRICKSAMPLES * sizeof(unsigned short) );
+	delete [ ] f->samples;
+	f->samples = samples;
+	f->numBricks = (int)kept.size( );
+}
+
+
+// the cache file that goes with a mesh file:
+
+std::string
+FieldCacheFile( const char *file )
+{
+	return std::string( file ) + ".sdf";
+}
+
+
+// read a mesh's field from its cache, if it is there and was baked from these triangles:
+
+bool
+ReadFieldCache( const char *file, unsigned long long hash, struct DistanceField *f )
+{
+	FILE *fp = fopen( FieldCacheFile( file ).c_str( ), "rb" );
+	if( fp == NULL )
+		return false;
+
+	struct FieldHeader header;
+	bool ok = ( fread( &header, sizeof(header), 1, fp ) == 1 )
+		&&  memcmp( header.magic, FIELDMAGIC, sizeof(header.magic) ) == 0
+		&&  header.version == FIELDVERSION
+		&&  header.hash == hash
+		&&  header.cell == FIELDCELL  &&  header.band == FIELDBAND
+		&&  header.dims[0] > 0  &&  header.dims[1] > 0  &&  header.dims[2] > 0
+		&&  header.numBricks >= 0  &&  header.numBricks <= header.dims[0]*header.dims[1]*header.dims[2];
+
+	if( ok )
+	{
+		int gridBricks = header.dims[0] * header.dims[1] * header.dims[2];
+		size_t numSamples = (size_t)header.numBricks * FIELDBRICKSAMPLES;
+		f->brickIndex = new int[ gridBricks ];
+		f->samples = NewFieldSamples( numSamples );
+		ok = fread( f->brickIndex, sizeof(int), gridBricks, fp ) == (size_t)gridBricks
+		  &&  fread( f->samples, sizeof(unsigned short), numSamples, fp ) == numSamples;
+		for( int b = 0; ok  &&  b < gridBricks; b++ )
+			ok = ( f->brickIndex[b] >= -1  &&  f->brickIndex[b] < header.numBricks );
+	}
+	fclose( fp );
+	if( ! ok )
+	{
+		FreeDistanceField( f );
+		return false;
+	}
+
+	memcpy( f->origin, header.origin, sizeof(f->origin) );
+	memcpy( f->dims, header.dims, sizeof(f->dims) );
+	f->numBricks = header.numBricks;
+	return true;
+}
+
+
+// write a mesh's field cache:
+// (it is written to a temporary file and renamed, so a half-written cache is never read)
+
+void
+WriteFieldCache( const char *file, unsigned long long hash, const struct DistanceField *f )
+{
+	struct FieldHeader header;
+	memset( &header, 0, sizeof(header) );
+	memcpy( header.magic, FIELDMAGIC, sizeof(header.magic) );
+	header.version = FIELDVERSION;
+	header.hash = hash;
+	header.cell = FIELDCELL;
+	header.band = FIELDBAND;
+	memcpy( header.origin, f->origin, sizeof(header.origin) );
+	memcpy( header.dims, f->dims, sizeof(header.dims) );
+	header.numBricks = f->numBricks;
+
+	std::string cacheFile = FieldCacheFile( file );
+	std::string tempFile = cacheFile + ".tmp";
+	FILE *fp = fopen( tempFile.c_str( ), "wb" );
+	if( fp == NULL )
+	{
+		fprintf( stderr, "Cannot write distance field cache '%s'\n", cacheFile.c_str( ) );
+		return;
+	}
+	fwrite( &header, sizeof(header), 1, fp );
+	fwrite( f->brickIndex, sizeof(int), f->dims[0]*f->dims[1]*f->dims[2], fp );
+	fwrite( f->samples, sizeof(unsigned short), (size_t)f->numBricks * FIELDBRICKSAMPLES, fp );
+	bool ok = ( ferror( fp ) == 0 );
+	fclose( fp );
+	if( ! ok  ||  rename( tempFile.c_str( ), cacheFile.c_str( ) ) != 0 )
+	{
+		fprintf( stderr, "Error writing distance field cache '%s'\n", cacheFile.c_str( ) );
+		remove( tempFile.c_str( ) );
+	}
+}
+
+
+// compare a field with its triangles at FIELDCHECKS points near them -- returns the biggest
+// difference in distance, and the average angle between the gradient and the way to the
+// nearest triangle, and how long a lookup took each way:
+// (the points are the same every time: a random spot on a random triangle, moved up to
+// FIELDBAND away from it in each direction)
+
+float
+CheckDistanceField( const struct CollisionTriangle *triangles, int numTriangles, const struct DistanceField *f,
+	float *degrees, double *fieldNs, double *triangleNs )
+{
+	std::vector<float> points( 3*FIELDCHECKS );
+	unsigned int seed = 12345;
+	auto random = [ &seed ]( ) { seed = seed*1664525u + 1013904223u; return (float)( seed >> 8 ) / 16777216.f; };
+	for( int i = 0; i < FIELDCHECKS; i++ )
+	{
+		const struct CollisionTriangle *tri = &triangles[ (int)( random( ) * (float)numTriangles ) % numTriangles ];
+		float u = random( );
+		float v = random( );
+		if( u + v > 1.f )
+		{
+			u = 1.f - u;
+			v = 1.f - v;
+		}
+		for( int j = 0; j < 3; j++ )
+			points[3*i+j] = tri->v[0][j] + u*( tri->v[1][j] - tri->v[0][j] ) + v*( tri->v[2][j] - tri->v[0][j] )
+				+ FIELDBAND * ( 2.f*random( ) - 1.f );
+	}
+
+	std::vector<float> exact( FIELDCHECKS ), away( 3*FIELDCHECKS ), field( FIELDCHECKS ), gradients( 3*FIELDCHECKS );
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now( );
+	for( int i = 0; i < FIELDCHECKS; i++ )
+		exact[i] = TriangleDistance( &points[3*i], triangles, NULL, numTriangles, &away[3*i] );
+	std::chrono::high_resolution_clock::time_point middle = std::chrono::high_resolution_clock::now( );
+	*triangleNs = std::chrono::duration<double, std::nano>( middle - start ).count( ) / (double)FIELDCHECKS;
+
+	// (the fastest of a few passes -- the first one mostly pulls the field into the cache, and
+	// the ball, looking up near where it just looked, mostly finds it there)
+	*fieldNs = 1.e30;
+	for( int pass = 0; pass < FIELDTIMINGPASSES; pass++ )
+	{
+		std::chrono::high_resolution_clock::time_point before = std::chrono::high_resolution_clock::now( );
+		for( int i = 0; i < FIELDCHECKS; i++ )
+			field[i] = FieldDistance( f, &points[3*i], &gradients[3*i] );
+		double ns = std::chrono::duration<double, std::nano>( std::chrono::high_resolution_clock::now( ) - before ).count( );
+		*fieldNs = std::min( *fieldNs, ns / (double)FIELDCHECKS );
+	}
+
+	// (only where the 8 samples around a point are all nearer than FIELDBAND, and not right
+	// at the surface, where the distance has a crease that blending rounds off -- the ball's
+	// contacts are well inside that)
+	const float nearest = 1.75f*FIELDCELL;
+	const float farthest = FIELDBAND - 1.75f*FIELDCELL;
+	float worst = 0.f;
+	double angles = 0.;
+	int counted = 0;
+	for( int i = 0; i < FIELDCHECKS; i++ )
+	{
+		if( exact[i] < nearest  ||  exact[i] >= farthest )
+			continue;
+		float e = fabsf( field[i] - exact[i] );
+		if( e > worst )
+			worst = e;
+		float length = sqrtf( Dot( &gradients[3*i], &gradients[3*i] ) );
+		float cosine = ( length > 0.f ) ? Dot( &gradients[3*i], &away[3*i] ) / ( length * exact[i] ) : -1.f;
+		angles += acosf( fmaxf( -1.f, fminf( 1.f, cosine ) ) ) * 180.f / F_PI;
+		counted++;
+	}
+	*degrees = ( counted > 0 ) ? (float)( angles / (double)counted ) : 0.f;
+	return worst;
+}
+
+
+// get a mesh's field -- out of its cache, or baked and cached -- and check it:
+// (if it doesn't match its triangles well enough, the mesh is left with no field)
+
+void
+BuildDistanceField( const char *file, const struct CollisionTriangle *triangles, int numTriangles,
+	struct DistanceField *f )
+{
+	FreeDistanceField( f );
+	if( numTriangles == 0 )
+		return;
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now( );
+	unsigned long long hash = HashTriangles( triangles, numTriangles );
+	bool cached = ReadFieldCache( file, hash, f );
+	if( ! cached )
+	{
+		BakeDistanceField( triangles, numTriangles, f );
+		WriteFieldCache( file, hash, f );
+	}
+	double ms = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now( ) - start ).count( );
+
+	float degrees;
+	double fieldNs, triangleNs;
+	float worst = CheckDistanceField( triangles, numTriangles, f, &degrees, &fieldNs, &triangleNs );
+	if( DebugOn != 0 )
+	{
+		fprintf( stderr, "Distance field for '%s': %d of %d bricks, %d KB, %s in %.1f ms\n", file,
+			f->numBricks, f->dims[0]*f->dims[1]*f->dims[2],
+			(int)( ( (size_t)f->numBricks * FIELDBRICKSAMPLES * sizeof(unsigned short) ) / 1024 ),
+			cached ? "read" : "baked", ms );
+		fprintf( stderr, "  off by at most %.4f, normals by %.1f degrees on average; %.1f ns a lookup (%.1f ns from the %d triangles)\n",
+			worst, degrees, fieldNs, triangleNs, numTriangles );
+	}
+	if( worst > FIELDTOLERANCE )
+	{
+		fprintf( stderr, "Distance field for '%s' is off by %.4f, more than %.3f, so the ball hits its triangles instead\n",
+			file, worst, FIELDTOLERANCE );
+		FreeDistanceField( f );
+	}
+}
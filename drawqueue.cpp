@@ -0,0 +1,474 @@
+// the draw queue -- the objects on the table, drawn sorted instead of in scene order:
+//
+//	Display( ) used to set each object's material and draw it right away, in the order the
+//	scene was written in -- so the gold circles, levers, and plunger were each given the
+//	same material again with other materials in between, and the quantized program was
+//	switched on and off around every mesh
+//
+//	now QueueMesh( ) and QueueBuffer( ) record what to draw, with its modelview, material, and
+//	texture, and SubmitDrawQueue( ) sorts everything by a 64-bit key:
+//
+//		bits 60-63		the program (the fixed-function pipeline, then the quantized program)
+//		bits 48-59		the material
+//		bits 32-47		the texture
+//		bits  0-31		the eye-space depth, nearest first (a positive float's bits sort
+//						the same way the float does)
+//
+//	and draws it, changing the program, the material, and the texture only where the key does
+//
+//	the materials are collected into DrawMaterials[ ] as they are queued (the same r, g, b,
+//	and shininess get the same index) and copied once a frame into the uniform buffer that
+//	the quantized program's Materials block reads -- so a quantized mesh just has its index
+//	set, and only the fixed-function draws call glMaterial (without
+//	GL_ARB_uniform_buffer_object, the quantized meshes do too)
+//
+//	a mesh with its own material in MeshLists[ ] always gets that one, the same as its display
+//	list does
+//
+//	the modelviews are kept on the cpu instead of being read back out of opengl for every
+//	object: BeginDrawQueue( ) reads the view once a frame, and each object starts from it with
+//	QueueLoadView( ) and is placed with QueueTranslate( ), QueueRotate( ), and QueueScale( )
+//	(which multiply the way glTranslatef( ), glRotatef( ), and glScalef( ) do)
+//
+//	each material keeps the specular and emission SetMaterial( ) gives the front faces along
+//	with its color and shininess, and both glMaterial and the Materials block get them from it
+//
+//	DrawSortOn (the Draw Order menu) submits in the order things were queued, to compare
+
+#include <algorithm>
+
+
+const int	MAXDRAWITEMS = 64;
+const GLuint	MATERIALBINDING = 0;			// the uniform buffer binding point of the Materials block
+
+enum DrawProgram
+{
+	DRAWFIXED,
+	DRAWQUANTIZED
+};
+
+struct DrawItem
+{
+	unsigned long long			key;
+	GLfloat						modelview[16];
+	const struct MeshList *		mesh;			// NULL for something that isn't an obj mesh
+	const struct VertexBuffer *	buffer;
+	GLuint						list;			// the display list that draws the same thing
+	int							program;		// DRAWFIXED or DRAWQUANTIZED
+	int							material;		// index into DrawMaterials[ ], -1 to leave it alone
+	GLuint						texture;		// 0 means untextured
+};
+
+// one material, the way the Materials block has it (std140):
+// (the front material SetMaterial( ) sets)
+
+struct MaterialBlockEntry
+{
+	GLfloat		ambient[4];
+	GLfloat		diffuse[4];
+	GLfloat		specular[4];
+	GLfloat		emission[4];
+	GLfloat		shininess[4];
+};
+
+int						DrawSortOn = 1;			// != 0 means the queue is sorted before it is drawn
+
+struct DrawItem			DrawItems[MAXDRAWITEMS];
+int						NumDrawItems;
+struct MaterialBlockEntry	DrawMaterials[MATERIALBLOCKSIZE];
+int						NumDrawMaterials;
+
+GLfloat					QueueView[16];			// the modelview the objects are placed from
+GLfloat					QueueMatrix[16];		// the modelview the next queued object gets
+
+GLuint					MaterialBuffer;
+bool					MaterialBufferMade;
+bool					MaterialBlockOk;		// the quantized program's Materials block can be used
+
+// what the last submit changed, for DebugOn:
+
+struct DrawQueueStats
+{
+	int		draws;
+	int		programChanges;
+	int		materialChanges;
+	int		textureChanges;
+} DrawQueueCounts;
+
+
+void	SubmitDrawQueue( );
+
+
+// remember the view the objects are placed from -- call this once a frame, after gluLookAt( ):
+
+void
+BeginDrawQueue( )
+{
+	glGetFloatv( GL_MODELVIEW_MATRIX, QueueView );
+	memcpy( QueueMatrix, QueueView, sizeof(QueueMatrix) );
+}
+
+
+// start placing another object:
+
+void
+QueueLoadView( )
+{
+	memcpy( QueueMatrix, QueueView, sizeof(QueueMatrix) );
+}
+
+
+// QueueMatrix = QueueMatrix * a translation, rotation (in degrees), or scale:
+
+void
+QueueTranslate( float x, float y, float z )
+{
+	for( int r = 0; r < 4; r++ )
+		QueueMatrix[12+r] += QueueMatrix[r]*x + QueueMatrix[4+r]*y + QueueMatrix[8+r]*z;
+}
+
+
+void
+QueueRotate( float angle, float x, float y, float z )
+{
+	float len = sqrtf( x*x + y*y + z*z );
+	if( len == 0. )
+		return;
+	x /= len;
+	y /= len;
+	z /= len;
+	float radians = angle * F_PI / 180.f;
+	float c = cosf( radians );
+	float s = sinf( radians );
+	float k = 1.f - c;
+
+	GLfloat rot[16] =
+	{
+		x*x*k + c,		y*x*k + z*s,	x*z*k - y*s,	0.f,
+		x*y*k - z*s,	y*y*k + c,		y*z*k + x*s,	0.f,
+		x*z*k + y*s,	y*z*k - x*s,	z*z*k + c,		0.f,
+		0.f,			0.f,			0.f,			1.f
+	};
+	GLfloat m[16];
+	MulMatrix( QueueMatrix, rot, m );
+	memcpy( QueueMatrix, m, sizeof(QueueMatrix) );
+}
+
+
+void
+QueueScale( float s )
+{
+	for( int i = 0; i < 12; i++ )
+		QueueMatrix[i] *= s;
+}
+
+
+// the front material SetMaterial( ) makes from a color and shininess:
+
+void
+FrontMaterial( float r, float g, float b, float shininess, struct MaterialBlockEntry *e )
+{
+	const GLfloat rgb[3] = { r, g, b };
+	for( int k = 0; k < 3; k++ )
+	{
+		e->ambient[k] = e->diffuse[k] = rgb[k];
+		e->specular[k] = .8f;
+		e->emission[k] = 0.f;
+	}
+	e->ambient[3] = e->diffuse[3] = e->specular[3] = e->emission[3] = 1.f;
+	e->shininess[0] = e->shininess[1] = e->shininess[2] = e->shininess[3] = shininess;
+}
+
+
+// the index of a material in this frame's DrawMaterials[ ], adding it if it's new:
+
+int
+DrawMaterialIndex( float r, float g, float b, float shininess )
+{
+	struct MaterialBlockEntry e;
+	FrontMaterial( r, g, b, shininess, &e );
+	for( int i = 0; i < NumDrawMaterials; i++ )
+	{
+		if( memcmp( &DrawMaterials[i], &e, sizeof(e) ) == 0 )
+			return i;
+	}
+
+	// (a full table is drawn now, so that it can start over)
+	if( NumDrawMaterials == MATERIALBLOCKSIZE )
+		SubmitDrawQueue( );
+
+	DrawMaterials[NumDrawMaterials] = e;
+	return NumDrawMaterials++;
+}
+
+
+// give opengl's front faces one of the queued materials:
+// (the back faces keep what SetMaterial( ) gave them)
+
+void
+ApplyDrawMaterial( const struct MaterialBlockEntry *e )
+{
+	glMaterialfv( GL_FRONT, GL_EMISSION, e->emission );
+	glMaterialfv( GL_FRONT, GL_AMBIENT, e->ambient );
+	glMaterialfv( GL_FRONT, GL_DIFFUSE, e->diffuse );
+	glMaterialfv( GL_FRONT, GL_SPECULAR, e->specular );
+	glMaterialf ( GL_FRONT, GL_SHININESS, e->shininess[0] );
+}
+
+
+// make the material uniform buffer and hook it up to the quantized program:
+
+void
+MakeMaterialBuffer( )
+{
+	MaterialBufferMade = true;
+	if( ! GLEW_ARB_uniform_buffer_object  ||  QuantizedProgram == 0 )
+		return;
+
+	GLuint block = glGetUniformBlockIndex( QuantizedProgram, "Materials" );
+	if( block == GL_INVALID_INDEX )
+	{
+		fprintf( stderr, "The quantized program has no Materials block -- its meshes will use glMaterial\n" );
+		return;
+	}
+	glUniformBlockBinding( QuantizedProgram, block, MATERIALBINDING );
+
+	glGenBuffers( 1, &MaterialBuffer );
+	glBindBuffer( GL_UNIFORM_BUFFER, MaterialBuffer );
+	glBufferData( GL_UNIFORM_BUFFER, MATERIALBLOCKSIZE * sizeof(struct MaterialBlockEntry), NULL, GL_DYNAMIC_DRAW );
+	glBindBuffer( GL_UNIFORM_BUFFER, 0 );
+	glBindBufferBase( GL_UNIFORM_BUFFER, MATERIALBINDING, MaterialBuffer );
+	MaterialBlockOk = true;
+}
+
+
+// copy the queued materials into the uniform buffer:
+
+void
+UploadDrawMaterials( )
+{
+	glBindBuffer( GL_UNIFORM_BUFFER, MaterialBuffer );
+	glBufferSubData( GL_UNIFORM_BUFFER, 0, NumDrawMaterials * sizeof(struct MaterialBlockEntry), DrawMaterials );
+	glBindBuffer( GL_UNIFORM_BUFFER, 0 );
+}
+
+
+// queue one draw with QueueMatrix, a material (r, g, b, shininess -- NULL means leave the
+// material alone), and a texture (0 means untextured):
+
+void
+QueueDraw( const struct MeshList *mesh, const struct VertexBuffer *buffer, GLuint list, const float *material, GLuint texture )
+{
+	// (a full queue is drawn now, so that it can start over)
+	if( NumDrawItems == MAXDRAWITEMS )
+		SubmitDrawQueue( );
+
+	int m = -1;
+	if( material != NULL )
+		m = DrawMaterialIndex( material[0], material[1], material[2], material[3] );
+
+	struct DrawItem *item = &DrawItems[NumDrawItems++];
+	memcpy( item->modelview, QueueMatrix, sizeof(item->modelview) );
+	item->mesh = mesh;
+	item->buffer = buffer;
+	item->list = list;
+	item->material = m;
+	item->texture = texture;
+
+	item->program = DRAWFIXED;
+	if( mesh != NULL  &&  BuffersOn != 0  &&  buffer->ok  &&  QuantizedOn != 0  &&  mesh->quantized.ok )
+		item->program = DRAWQUANTIZED;
+
+	float depth = -item->modelview[14];
+	if( depth < 0.f )
+		depth = 0.f;
+	unsigned int depthBits;
+	memcpy( &depthBits, &depth, sizeof(depthBits) );
+
+	item->key = ( (unsigned long long)item->program << 60 )
+		| ( (unsigned long long)( m & 0xfff ) << 48 )
+		| ( (unsigned long long)( item->texture & 0xffff ) << 32 )
+		| (unsigned long long)depthBits;
+}
+
+
+// the MeshLists[ ] entry of an obj display list:
+
+struct MeshList *
+FindMeshList( GLuint list )
+{
+	for( int i = 0; i < NUMMESHLISTS; i++ )
+	{
+		if( *MeshLists[i].list == list )
+			return &MeshLists[i];
+	}
+	fprintf( stderr, "Display list %u is not an obj mesh\n", list );
+	return NULL;
+}
+
+
+// queue an obj mesh with a material, or (without one) with its own:
+
+void
+QueueMesh( GLuint list, float r, float g, float b, float shininess )
+{
+	struct MeshList *ml = FindMeshList( list );
+	if( ml == NULL )
+		return;
+	float material[4] = { r, g, b, shininess };
+	QueueDraw( ml, &ml->buffer, list, ml->material != NULL ? ml->material : material, 0 );
+}
+
+
+void
+QueueMesh( GLuint list )
+{
+	struct MeshList *ml = FindMeshList( list );
+	if( ml != NULL )
+		QueueDraw( ml, &ml->buffer, list, ml->material, 0 );
+}
+
+
+// queue a vertex buffer (or the display list that draws the same thing) with a material
+// and a texture:
+
+void
+QueueBuffer( const struct VertexBuffer *buffer, GLuint list, GLuint texture, float r, float g, float b, float shininess )
+{
+	float material[4] = { r, g, b, shininess };
+	QueueDraw( NULL, buffer, list, material, texture );
+}
+
+
+bool
+DrawItemLess( const struct DrawItem &a, const struct DrawItem &b )
+{
+	return a.key < b.key;
+}
+
+
+// draw one item -- the program, material, and texture have been set:
+
+void
+DrawQueuedItem( const struct DrawItem *item )
+{
+	glLoadMatrixf( item->modelview );
+	if( BuffersOn == 0  ||  ! item->buffer->ok )
+	{
+		// (the display list draws what the buffer would have)
+		CountDraw( item->buffer->numIndices );
+		glCallList( item->list );
+		return;
+	}
+
+	const struct MeshList *ml = item->mesh;
+	if( ml != NULL )
+	{
+		if( ml->angle != 0. )
+			glRotatef( ml->angle, ml->ax, ml->ay, ml->az );
+		glScalef( ScaleFactor, ScaleFactor, ScaleFactor );
+	}
+	if( item->program == DRAWQUANTIZED )
+		DrawQuantizedMesh( &ml->quantized );
+	else
+		DrawVertexBuffer( item->buffer );
+}
+
+
+// sort and draw everything that has been queued, and empty the queue:
+// (call this with texturing off)
+
+void
+SubmitDrawQueue( )
+{
+	memset( &DrawQueueCounts, 0, sizeof(DrawQueueCounts) );
+	if( NumDrawItems == 0 )
+	{
+		NumDrawMaterials = 0;
+		return;
+	}
+
+	if( ! MaterialBufferMade )
+		MakeMaterialBuffer( );
+	if( MaterialBlockOk )
+		UploadDrawMaterials( );
+
+	// the last item in scene order leaves the current normal and texture coordinate, the
+	// way it would have if nothing had been sorted:
+	const struct VertexBuffer *last = DrawItems[NumDrawItems-1].buffer;
+
+	if( DrawSortOn != 0 )
+		std::stable_sort( &DrawItems[0], &DrawItems[NumDrawItems], DrawItemLess );
+
+	int program = DRAWFIXED;
+	int fixedMaterial = -1;				// what SetMaterial( ) was last given
+	int blockMaterial = -1;				// what the quantized program was last given
+	GLuint texture = 0;
+	glPushMatrix( );
+	for( int i = 0; i < NumDrawItems; i++ )
+	{
+		const struct DrawItem *item = &DrawItems[i];
+		if( item->program != program )
+		{
+			if( program == DRAWQUANTIZED )
+				EndQuantizedDraws( );
+			if( item->program == DRAWQUANTIZED )
+			{
+				BeginQuantizedDraws( );
+				blockMaterial = -1;
+			}
+			program = item->program;
+			DrawQueueCounts.programChanges++;
+		}
+
+		if( item->texture != texture )
+		{
+			if( item->texture == 0 )
+				glDisable( GL_TEXTURE_2D );
+			else
+			{
+				if( texture == 0 )
+					glEnable( GL_TEXTURE_2D );
+				glBindTexture( GL_TEXTURE_2D, item->texture );
+			}
+			texture = item->texture;
+			DrawQueueCounts.textureChanges++;
+		}
+
+		int material = item->material;
+		if( material >= 0 )
+		{
+			if( program == DRAWQUANTIZED  &&  MaterialBlockOk )
+			{
+				if( material != blockMaterial )
+				{
+					SetQuantizedMaterial( material );
+					blockMaterial = material;
+					DrawQueueCounts.materialChanges++;
+				}
+			}
+			else if( material != fixedMaterial )
+			{
+				ApplyDrawMaterial( &DrawMaterials[material] );
+				fixedMaterial = material;
+				DrawQueueCounts.materialChanges++;
+			}
+		}
+
+		DrawQueuedItem( item );
+		DrawQueueCounts.draws++;
+	}
+	if( program == DRAWQUANTIZED )
+		EndQuantizedDraws( );
+	if( texture != 0 )
+		glDisable( GL_TEXTURE_2D );
+	glPopMatrix( );
+
+	if( last->hasTexCoords )
+		glTexCoord2fv( last->lastTexCoord );
+	if( last->hasNormals )
+		glNormal3fv( last->lastNormal );
+
+	NumDrawItems = 0;
+	NumDrawMaterials = 0;
+}
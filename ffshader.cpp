@@ -0,0 +1,152 @@
+// the pieces of glsl that reproduce the fixed-function pipeline this program uses:
+//
+//	anything drawn with a shader (the instanced grid walls, the quantized meshes) still
+//	has to match everything drawn with the fixed-function pipeline right next to it, so
+//	those shaders all start with FixedFunctionVertexLib, which has:
+//
+//		FixedLighting( eye, n )		per-vertex lighting with up to 3 point or spot
+//									lights, local viewer off, single-sided, using the
+//									gl_LightSource[ ] and gl_FrontMaterial state
+//
+//		FixedLighting( eye, n, m )	the same, with a FixedMaterial instead of
+//									gl_FrontMaterial (the quantized meshes get theirs
+//									out of a uniform buffer -- see drawqueue.cpp)
+//
+//	and they all end with FixedFunctionFragmentShader, which applies linear fog
+//
+//	the shaders read the same built-in state the fixed-function pipeline does, so
+//	SetMaterial( ), SetPointLight( ), SetSpotLight( ), and glFog*( ) just work -- the
+//	only thing glsl 1.20 can't see is which lights are enabled, or whether fog is,
+//	and SetFixedFunctionUniforms( ) copies that in before drawing
+
+
+const char *FixedFunctionVertexLib =
+	"#version 120\n"
+	"#extension GL_ARB_uniform_buffer_object : enable\n"
+	"struct FixedMaterial\n"
+	"{\n"
+	"	vec4 ambient;\n"
+	"	vec4 diffuse;\n"
+	"	vec4 specular;\n"
+	"	vec4 emission;\n"
+	"	vec4 shininess;		// in x (a vec4 keeps the std140 layout simple)\n"
+	"};\n"
+	"uniform bool uLightOn[3];\n"
+	"varying float vFogCoord;\n"
+	"vec4 FixedLighting( vec3 eye, vec3 n, FixedMaterial m )\n"
+	"{\n"
+	"	vec4 color = m.emission + gl_LightModel.ambient * m.ambient;\n"
+	"	for( int i = 0; i < 3; i++ )\n"
+	"	{\n"
+	"		if( ! uLightOn[i] )\n"
+	"			continue;\n"
+	"		vec3 l;\n"
+	"		float atten = 1.;\n"
+	"		if( gl_LightSource[i].position.w == 0. )\n"
+	"		{\n"
+	"			l = normalize( gl_LightSource[i].position.xyz );\n"
+	"		}\n"
+	"		else\n"
+	"		{\n"
+	"			vec3 d = gl_LightSource[i].position.xyz - eye;\n"
+	"			float dist = length( d );\n"
+	"			l = d / dist;\n"
+	"			atten = 1. / ( gl_LightSource[i].constantAttenuation + dist*gl_LightSource[i].linearAttenuation\n"
+	"				+ dist*dist*gl_LightSource[i].quadraticAttenuation );\n"
+	"		}\n"
+	"		if( gl_LightSource[i].spotCutoff != 180. )\n"
+	"		{\n"
+	"			float s = dot( -l, normalize( gl_LightSource[i].spotDirection ) );\n"
+	"			atten *= ( s < gl_LightSource[i].spotCosCutoff ) ? 0. : pow( s, gl_LightSource[i].spotExponent );\n"
+	"		}\n"
+	"		float nl = max( dot( n, l ), 0. );\n"
+	"		vec4 c = gl_LightSource[i].ambient * m.ambient + nl * gl_LightSource[i].diffuse * m.diffuse;\n"
+	"		if( nl > 0. )\n"
+	"			c += pow( max( dot( n, normalize( l + vec3( 0., 0., 1. ) ) ), 0. ), m.shininess.x ) * gl_LightSource[i].specular * m.specular;\n"
+	"		color += atten * c;\n"
+	"	}\n"
+	"	return vec4( clamp( color.rgb, 0., 1. ), m.diffuse.a );\n"
+	"}\n"
+	"vec4 FixedLighting( vec3 eye, vec3 n )\n"
+	"{\n"
+	"	FixedMaterial m = FixedMaterial( gl_FrontMaterial.ambient, gl_FrontMaterial.diffuse, gl_FrontMaterial.specular,\n"
+	"		gl_FrontMaterial.emission, vec4( gl_FrontMaterial.shininess ) );\n"
+	"	return FixedLighting( eye, n, m );\n"
+	"}\n";
+
+const char *FixedFunctionFragmentShader =
+	"#version 120\n"
+	"uniform bool uFogOn;\n"
+	"varying float vFogCoord;\n"
+	"void main( )\n"
+	"{\n"
+	"	vec4 color = gl_Color;\n"
+	"	if( uFogOn )\n"
+	"		color.rgb = mix( gl_Fog.color.rgb, color.rgb, clamp( ( gl_Fog.end - vFogCoord ) * gl_Fog.scale, 0., 1. ) );\n"
+	"	gl_FragColor = color;\n"
+	"}\n";
+
+
+// compile one shader from one or more pieces of source, printing the info log if it fails:
+
+GLuint
+CompileShader( GLenum type, const char *source, const char *more = NULL )
+{
+	const char *sources[2] = { source, more };
+	GLuint shader = glCreateShader( type );
+	glShaderSource( shader, ( more != NULL ) ? 2 : 1, sources, NULL );
+	glCompileShader( shader );
+
+	GLint status;
+	glGetShaderiv( shader, GL_COMPILE_STATUS, &status );
+	if( status == GL_FALSE )
+	{
+		char log[1024];
+		glGetShaderInfoLog( shader, sizeof(log), NULL, log );
+		fprintf( stderr, "Shader compile failed:\n%s\n", log );
+	}
+	return shader;
+}
+
+
+// link a program from a vertex shader main( ) that uses FixedFunctionVertexLib:
+// (attributes are bound to locations by name first -- names[i] goes to location first+i)
+
+GLuint
+MakeFixedFunctionProgram( const char *name, const char *vertexMain, const char **attributes, int numAttributes, GLuint first )
+{
+	GLuint program = glCreateProgram( );
+	GLuint vs = CompileShader( GL_VERTEX_SHADER, FixedFunctionVertexLib, vertexMain );
+	GLuint fs = CompileShader( GL_FRAGMENT_SHADER, FixedFunctionFragmentShader );
+	glAttachShader( program, vs );
+	glAttachShader( program, fs );
+	for( int i = 0; i < numAttributes; i++ )
+		glBindAttribLocation( program, first + i, attributes[i] );
+	glLinkProgram( program );
+	glDeleteShader( vs );
+	glDeleteShader( fs );
+
+	GLint status;
+	glGetProgramiv( program, GL_LINK_STATUS, &status );
+	if( status == GL_FALSE )
+	{
+		char log[1024];
+		glGetProgramInfoLog( program, sizeof(log), NULL, log );
+		fprintf( stderr, "%s program link failed:\n%s\n", name, log );
+	}
+	return program;
+}
+
+
+// tell a fixed-function program which lights are on and whether there is fog:
+// (the program must be in use -- the locations are of its uLightOn and uFogOn)
+
+void
+SetFixedFunctionUniforms( GLint lightOnLoc, GLint fogOnLoc )
+{
+	GLint lightOn[3];
+	for( int i = 0; i < 3; i++ )
+		lightOn[i] = glIsEnabled( GL_LIGHT0 + i );
+	glUniform1iv( lightOnLoc, 3, lightOn );
+	glUniform1i( fogOnLoc, glIsEnabled( GL_FOG ) );
+}
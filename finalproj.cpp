@@ -198,24 +198,44 @@ float	Xrot, Yrot;				// rotation angles in degrees
 
 void	Animate( );
 void	Display( );
+void	DoAnimationMenu( int );
 void	DoAxesMenu( int );
 void	DoColorMenu( int );
 void	DoDepthBufferMenu( int );
 void	DoDepthFightingMenu( int );
+void	DoBallMenu( int );
+void	DoBallsMenu( int );
+void	DoCollisionMenu( int );
 void	DoDepthMenu( int );
+void	DoDrawOrderMenu( int );
+void	DoFrameRateMenu( int );
+void	DoCullingMenu( int );
 void	DoDebugMenu( int );
+void	DoGridMenu( int );
 void	DoMainMenu( int );
 void	DoProjectMenu( int );
+void	DoHudMenu( int );
+void	DoLatencyMenu( int );
+void	DoStateCacheMenu( int );
+void	DoRendererMenu( int );
+void	DoTextureCompressMenu( int );
+void	DoTextureFilterMenu( int );
+void	DoVsyncMenu( int );
+void	DoVertexFormatMenu( int );
 void	DoRasterString( float, float, float, char * );
 void	DoStrokeString( float, float, float, float, char * );
 float	ElapsedSeconds( );
 void	InitGraphics( );
 void	InitLists( );
+void	InitWindow( );
+void	BuildMeshList( struct MeshList *, struct ObjMesh * );
 void	InitMenus( );
 void	Keyboard( unsigned char, int, int );
+void	KeyboardUp( unsigned char, int, int );
 void	MouseButton( int, int, int, int );
 void	MouseMotion( int, int );
 void	Reset( );
+void	SampleAnimation( float, struct AnimState * );
 void	Resize( int, int );
 void	Visibility( int );
 
@@ -269,6 +289,14 @@ MulArray3(float factor, float a, float b, float c )
 	return array;
 }
 
+// the gl call trace (compiled in with GL_TRACE) -- this has to come before anything that calls gl:
+
+#include "gltrace.cpp"
+
+// the redundant gl state cache -- this has to come next, so setmaterial.cpp and setlight.cpp go through it:
+
+#include "statecache.cpp"
+
 // these are here for when you need them -- just uncomment the ones you need:
 
 #include "setmaterial.cpp"
@@ -278,12 +306,28 @@ MulArray3(float factor, float a, float b, float c )
 //#include "osutorus.cpp"
 #include "bmptotexture.cpp"
 #include "loadobjfile.cpp"
+#include "objmesh.cpp"
+#include "meshopt.cpp"
 #include "keytime.cpp"
+#include "multikeytimes.cpp"
 //#include "glslprogram.cpp"
+#include "ffshader.cpp"
+#include "culling.cpp"
+#include "frametiming.cpp"
+#include "mappedfile.cpp"
+#include "bmploader.cpp"
+#include "quantize.cpp"
+#include "vertexbuffer.cpp"
+#include "assetbundle.cpp"
+#include "texcache.cpp"
+#include "threadpool.cpp"
+#include "assetloader.cpp"
+#include "framepacer.cpp"
+#include "headless.cpp"
+#include "hud.cpp"
 
 const int ScaleFactor = 60;
 
-GLuint			GridDL;
 GLuint			SphereDL;
 GLuint			PlungerDL;
 GLuint			LeverDL;
@@ -295,45 +339,161 @@ GLuint			CrossDL;
 GLuint			StarDL;
 
 GLuint			SpaceTex;
+long long		SpaceTexBytes;			// what its upload gave the driver
+
+// the same pieces for the buffer renderer (the obj meshes' are in MeshLists[ ]):
+
+struct VertexBuffer	SphereVB;
+struct VertexBuffer	BottomPlateVB;
+
+// the object-space bounding box of each display list, for culling:
+
+struct BoundingBox	SphereBox;
+struct BoundingBox	PlungerBox;
+struct BoundingBox	LeverBox;
+struct BoundingBox	TopPlateBox;
+struct BoundingBox	BottomPlateBox;
+struct BoundingBox	CircleStaticBox;
+struct BoundingBox	TriangleStaticBox;
+struct BoundingBox	CrossBox;
+struct BoundingBox	StarBox;
+
+// the display lists that are made from obj files -- each one is compiled as soon as
+// its mesh has been read (see InitLists( )):
+
+struct MeshList
+{
+	const char *			file;
+	GLuint *				list;
+	float					angle, ax, ay, az;		// rotation before the scale (angle == 0. means none)
+	const float *			material;				// r, g, b, shininess (NULL means keep the current one)
+	struct BoundingBox *	box;
+	struct VertexBuffer		buffer;					// the same mesh in buffer objects (see vertexbuffer.cpp)
+	struct QuantizedMesh	quantized;				// and in 16-bit buffers (see quantize.cpp)
+};
+
+const float	PLATEMATERIAL[ ] = { 0.15f, 0.15f, 0.2f, 10.f };
+const float	GOLDMATERIAL[ ]  = { 0.8f, 0.7f, 0.3f, 128.f };
+
+struct MeshList	MeshLists[ ] =
+{
+	{ "Top.obj",		&TopPlateDL,		-90.f, 1.f, 0.f, 0.f,	PLATEMATERIAL,	&TopPlateBox },
+	{ "Starter.obj",	&PlungerDL,			-90.f, 1.f, 0.f, 0.f,	GOLDMATERIAL,	&PlungerBox },
+	{ "Lever.obj",		&LeverDL,			  0.f, 0.f, 0.f, 0.f,	GOLDMATERIAL,	&LeverBox },
+	{ "Sparkle.obj",	&CrossDL,			  0.f, 0.f, 0.f, 0.f,	NULL,			&CrossBox },
+	{ "Circle.obj",		&CircleStaticDL,	  0.f, 0.f, 0.f, 0.f,	NULL,			&CircleStaticBox },
+	{ "Star.obj",		&StarDL,			  0.f, 0.f, 0.f, 0.f,	NULL,			&StarBox },
+	{ "Triangle.obj",	&TriangleStaticDL,	-30.f, 0.f, 1.f, 0.f,	NULL,			&TriangleStaticBox },
+};
+
+const int	NUMMESHLISTS = sizeof(MeshLists) / sizeof(struct MeshList);
+
+// the queue the objects are drawn through, sorted by program and material:
+
+#include "drawqueue.cpp"
+
+// the animation tracks (the channels are authored one at a time in InitGraphics( )):
+
+MultiKeytimes	Ball;					// x, z
+MultiKeytimes	Spins;					// star, cross rotation
+MultiKeytimes	Levers;					// left, right rotation
+MultiKeytimes	Plunger;				// z
+MultiKeytimes	Camera;					// eye z, look-at y
+MultiKeytimes	StarColor;				// r, g, b
+MultiKeytimes	CrossColor;				// r, g, b
+MultiKeytimes	TriangleColor;			// r, g, b
+
+// everything that is animated, sampled once per frame for Display( ) to read:
+
+struct AnimState
+{
+	float	ballX, ballZ;
+	float	starRot, crossRot;
+	float	leverL, leverR;
+	float	plungerZ;
+	float	posZ, lookY;
+	float	starRGB[3];
+	float	crossRGB[3];
+	float	triangleRGB[3];
+};
+
+struct AnimState	Anim;
+
+// the same values, baked into a fixed-rate table (see the Animation menu):
 
-Keytimes		BallX;
-Keytimes		BallZ;
-Keytimes		StarRot;
-Keytimes		CrossRot;
-Keytimes		LeverL;
-Keytimes		LeverR;
-Keytimes		PlungerZ;
+#include "bakedanim.cpp"
 
-Keytimes		PosZ, LookY;
+// the keyframes are read from a file that can be edited while the program runs:
 
-Keytimes		StarR, StarG, StarB;
-Keytimes		CrossR, CrossG, CrossB;
-Keytimes		TriangleR, TriangleG, TriangleB;
+#include "animfile.cpp"
+
+// the ball can be simulated and played instead, with more balls if wanted (see the Ball,
+// Balls, and Collision menus):
+
+#include "distancefield.cpp"
+#include "physics.cpp"
+#include "multiball.cpp"
+#include "tableinput.cpp"
+#include "simthread.cpp"
+
+// and played with no window at all, many games at once ("-simulate"):
+
+#include "simulate.cpp"
 
 int				LightSwitch = 0.0;
 
 #define XSIDE	100				// length of the x side of the grid
 #define X0      ( -XSIDE/2.0f )		// where one side starts
-#define NX		1000			// how many points in x
-#define DX		( XSIDE/(float)NX )	// change in x between the points
 
 #define YGRID	0.f
 
 #define ZSIDE	100				// length of the z side of the grid
 #define Z0      (-ZSIDE/2.)		// where one side starts
-#define NZ		1000			// how many points in z
-#define DZ		( ZSIDE/(float)NZ )	// change in z between the points
+
+// the grid walls (the number of grid points is GridRes, settable from the menu):
+
+#include "gridbuffer.cpp"
+
+// the frame timing benchmark ("-benchmark"):
+
+#include "benchmark.cpp"
 
 // main program:
 
 int
 main( int argc, char *argv[ ] )
 {
+	// "-headless" draws into an offscreen framebuffer instead of a window, so glut
+	// (which needs a display to talk to) isn't turned on for it -- and neither is it
+	// for "-benchmark", which runs headless:
+
+	ParseHeadlessArgs( argc, argv );
+	ParseBenchmarkArgs( argc, argv );
+	ParseMultiballArgs( argc, argv );
+	ParseSimulateArgs( argc, argv );
+	ParseTextureArgs( argc, argv );
+
+	// "-simulate" only plays the table, so it doesn't need glut or gl at all:
+
+	if( SimulateGames > 0 )
+		return RunSimulation( );
+
 	// turn on the glut package:
 	// (do this before checking argc and argv since glutInit might
 	// pull some command line arguments out)
 
-	glutInit( &argc, argv );
+	if( HeadlessOn == 0 )
+		glutInit( &argc, argv );
+
+	// "-bake" just writes the asset bundle and quits, and so does "-bench-bmp file.bmp [runs]":
+
+	for( int i = 1; i < argc; i++ )
+	{
+		if( strcmp( argv[i], "-bake" ) == 0 )
+			return BakeBundle( BundleFile );
+		if( strcmp( argv[i], "-bench-bmp" ) == 0  &&  i+1 < argc )
+			return BenchmarkBmp( argv[i+1], ( i+2 < argc ) ? atoi( argv[i+2] ) : 20 );
+	}
 
 	// setup all the graphics stuff:
 
@@ -348,6 +508,15 @@ main( int argc, char *argv[ ] )
 
 	Reset( );
 
+	// headless, draw the frames (or run the benchmark) and quit:
+
+	if( BenchmarkFile != NULL )
+		return RunBenchmark( );
+	if( MultiballBenchFile != NULL )
+		return RunMultiballBenchmark( );
+	if( HeadlessOn != 0 )
+		return RunHeadless( );
+
 	// setup all the user interface stuff:
 
 	InitMenus( );
@@ -365,6 +534,37 @@ main( int argc, char *argv[ ] )
 }
 
 
+// sample every track at one time:
+
+void
+SampleAnimation( float t, struct AnimState *a )
+{
+	float v[2];
+
+	Ball.GetValues( t, v );
+	a->ballX = v[0];
+	a->ballZ = v[1];
+
+	Spins.GetValues( t, v );
+	a->starRot  = v[0];
+	a->crossRot = v[1];
+
+	Levers.GetValues( t, v );
+	a->leverL = v[0];
+	a->leverR = v[1];
+
+	Plunger.GetValues( t, &a->plungerZ );
+
+	Camera.GetValues( t, v );
+	a->posZ  = v[0];
+	a->lookY = v[1];
+
+	StarColor.GetValues( t, a->starRGB );
+	CrossColor.GetValues( t, a->crossRGB );
+	TriangleColor.GetValues( t, a->triangleRGB );
+}
+
+
 // this is where one would put code that is to be called
 // everytime the glut main loop has nothing to do
 //
@@ -378,6 +578,15 @@ Animate( )
 	// put animation stuff in here -- change some global variables for Display( ) to find:
 
 	int ms = glutGet(GLUT_ELAPSED_TIME);
+
+	// pick up any edits to the animation file:
+
+	CheckAnimationFile( ms );
+
+	// and the automatic lever presses, if the input latency is being measured with them:
+
+	LatencyAutoPress( );
+
 	ms %= MS_PER_CYCLE;							// makes the value of ms between 0 and MS_PER_CYCLE-1
 	Time = (float)ms / (float)MS_PER_CYCLE;		// makes the value of Time between 0. and slightly less than 1.
 
@@ -397,12 +606,22 @@ Display( )
 {
 	if (DebugOn != 0)
 		fprintf(stderr, "Starting Display.\n");
+	GLTRACE_FRAME( );
+	GLTRACE_SCOPE( "setup" );
 
 	// set which window we want to do the graphics into:
-	glutSetWindow( MainWindow );
+	// (headless, it goes into the framebuffer object, which is always bound)
+	if( HeadlessOn == 0 )
+	{
+		glutSetWindow( MainWindow );
+		glDrawBuffer( GL_BACK );
+	}
+
+	// time the frame in segments (see frametiming.cpp), and count its state changes (see statecache.cpp):
+	StartFrameTiming( );
+	ResetStateCounts( );
 
 	// erase the background:
-	glDrawBuffer( GL_BACK );
 	glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
 
 	glEnable( GL_DEPTH_TEST );
@@ -418,8 +637,8 @@ Display( )
 
 	// set the viewport to be a square centered in the window:
 
-	GLsizei vx = glutGet( GLUT_WINDOW_WIDTH );
-	GLsizei vy = glutGet( GLUT_WINDOW_HEIGHT );
+	GLsizei vx, vy;
+	SceneSize( &vx, &vy );
 	GLsizei v = vx < vy ? vx : vy;			// minimum dimension
 	GLint xl = ( vx - v ) / 2;
 	GLint yb = ( vy - v ) / 2;
@@ -437,6 +656,10 @@ Display( )
 	else
 		gluPerspective( 70.f, 1.f,	0.1f, 1000.f );
 
+	// start this frame's culling with the new projection:
+
+	BeginCulling( );
+
 	// place the objects into the scene:
 
 	glMatrixMode( GL_MODELVIEW );
@@ -487,23 +710,42 @@ Display( )
 	glEnable(GL_LIGHT1);
 	glEnable(GL_LIGHT2);
 
-	// turn # msec into the cycle ( 0 - MSEC-1 ):
-	int msec = glutGet(GLUT_ELAPSED_TIME) % MS_PER_CYCLE;
-	// turn that into a time in seconds:
-	float nowTime = (float)msec / 1000.;
+	// the time in seconds into the cycle ( 0 - MS_PER_CYCLE-1 msec ):
+	// (from the clock, or the fixed timestep in headless mode)
+	float nowTime = SceneTime( );
+
+	// sample all the tracks once for this frame:
+	if (BakedOn != 0)
+	{
+		struct BakedRow row;
+		SampleBaked(nowTime, &row, &Anim);
+	}
+	else
+		SampleAnimation(nowTime, &Anim);
+
+	// or the ball, the levers, and the plunger come from the physics (see physics.cpp):
+	if (PhysicsOn != 0)
+	{
+		RunPhysics(&Anim);
+		if (DebugOn != 0)
+			fprintf(stderr, "Physics: %d steps in %.3f ms, ball at (%.2f, %.2f)\n",
+				PhysicsSteps, PhysicsMs, Anim.ballX, Anim.ballZ);
+		if (DebugOn != 0 && PhysicsView.numBalls > 1)
+			fprintf(stderr, "Multiball: %d balls, move %.3f ms, table %.3f ms, pairs %.3f ms, %d contacts\n",
+				PhysicsView.numBalls, PhysicsMultiballMs[MULTI_MOVE], PhysicsMultiballMs[MULTI_TABLE],
+				PhysicsMultiballMs[MULTI_PAIRS], PhysicsContacts);
+	}
 
 	// set the eye position, look-at position, and up-vector:
 	if (NowProjection == ORTHO) { gluLookAt(0.f, 14.f, 0.f, 0.f, 0.0f, 0.f, 0.f, 0.f, -1.f); }
-	else { gluLookAt(0.f, 14.f, PosZ.GetValue(nowTime), 0.f, LookY.GetValue(nowTime), 0.f, 0.f, 0.f, -1.f); }
+	else { gluLookAt(0.f, 14.f, Anim.posZ, 0.f, Anim.lookY, 0.f, 0.f, 0.f, -1.f); }
 
+	GLTRACE_SCOPE( "lights" );
 	glPushMatrix();
-		glTranslatef(BallX.GetValue(nowTime), 2.3f, BallZ.GetValue(nowTime));
+		glTranslatef(Anim.ballX, 2.3f, Anim.ballZ);
 		SetSpotLight(GL_LIGHT1, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 1.0f, 1.0f);
 	glPopMatrix();
 
-	// enable textures
-	glEnable(GL_TEXTURE_2D);
-
 	if (LightSwitch == 0.0) {
 		glDisable(GL_LIGHT2);
 		glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
@@ -527,118 +769,114 @@ Display( )
 		SetPointLight(GL_LIGHT0, 0, 5, 0, 0.9, 0.9, 1.0); 
 	}
 
+	// the bottom plate, the pinball, and the objects on the table -- they are queued, and drawn
+	// sorted by program, material, and texture (see drawqueue.cpp), each placed from the view
+	// with the draw queue's own translate/rotate/scale instead of opengl's
+	BeginDrawQueue();
+
 	// bottom plate
-	glPushMatrix();
-	glCallList(BottomPlateDL);
-	glPopMatrix();
+	// (it is drawn with the objects, so this segment only times queueing it -- it gets the
+	// grids' material, and its normal, which it used to be left with by the frame before)
+	TimeSegment( SEGMENT_PLATE );
+	GLTRACE_SCOPE( "bottom plate" );
+	QueueLoadView();
+	if (BoxVisible(&BottomPlateBox, QueueMatrix)) {
+		QueueRotate(-90, 1, 0, 0);
+		QueueScale(ScaleFactor);
+		QueueBuffer(&BottomPlateVB, BottomPlateDL, SpaceTex, 0.5f, 0.5f, 0.6f, 30.f);
+	}
 
-	// disable textures
-	glDisable(GL_TEXTURE_2D);
+	TimeSegment( SEGMENT_OBJECTS );
+	GLTRACE_SCOPE( "objects" );
+	QueueLoadView();
+	QueueTranslate(Anim.ballX, 1.8, Anim.ballZ);
+	if (BoxVisible(&SphereBox, QueueMatrix))
+		QueueBuffer(&SphereVB, SphereDL, 0, 1.f, 1.f, 1.f, 128.f);
 
-	// pinball
-	glPushMatrix();
-	glTranslatef(BallX.GetValue(nowTime), 1.8, BallZ.GetValue(nowTime));
-	glCallList(SphereDL);
-	glPopMatrix();
+	// and the other balls, in multiball:
+	for (int i = 1; PhysicsOn != 0 && i < PhysicsView.numBalls; i++)
+	{
+		QueueLoadView();
+		QueueTranslate(PhysicsView.x[i], 1.8, PhysicsView.z[i]);
+		if (BoxVisible(&SphereBox, QueueMatrix))
+			QueueBuffer(&SphereVB, SphereDL, 0, 1.f, 1.f, 1.f, 128.f);
+	}
 
 	// static triangle
-	glPushMatrix();
-	glTranslatef(2.6, 1.8, 2.9);
-	SetMaterial(TriangleR.GetValue(nowTime), TriangleG.GetValue(nowTime), TriangleB.GetValue(nowTime), 128.f);
-	glCallList(TriangleStaticDL);
-	glPopMatrix();
+	QueueLoadView();
+	QueueTranslate(2.6, 1.8, 2.9);
+	if (BoxVisible(&TriangleStaticBox, QueueMatrix))
+		QueueMesh(TriangleStaticDL, Anim.triangleRGB[0], Anim.triangleRGB[1], Anim.triangleRGB[2], 128.f);
 
 	// static circle 2
-	glPushMatrix();
-	glTranslatef(2.4, 1.8, -0.5);
-	SetMaterial(0.8f, 0.7f, 0.3f, 128.f);
-	glCallList(CircleStaticDL);
-	glPopMatrix();
+	QueueLoadView();
+	QueueTranslate(2.4, 1.8, -0.5);
+	if (BoxVisible(&CircleStaticBox, QueueMatrix))
+		QueueMesh(CircleStaticDL, 0.8f, 0.7f, 0.3f, 128.f);
 
 	// static circle 1
-	glPushMatrix();
-	glTranslatef(-2.4, 1.8, -0.5);
-	SetMaterial(0.8f, 0.7f, 0.3f, 128.f);
-	glCallList(CircleStaticDL);
-	glPopMatrix();
+	QueueLoadView();
+	QueueTranslate(-2.4, 1.8, -0.5);
+	if (BoxVisible(&CircleStaticBox, QueueMatrix))
+		QueueMesh(CircleStaticDL, 0.8f, 0.7f, 0.3f, 128.f);
 
 	// cross
-	glPushMatrix();
-	glTranslatef(0, 1.8, -3);
-	glRotatef(CrossRot.GetValue(nowTime), 0, 1, 0);
-	SetMaterial(CrossR.GetValue(nowTime), CrossG.GetValue(nowTime), CrossB.GetValue(nowTime), 128.f);
-	glCallList(CrossDL);
-	glPopMatrix();
+	QueueLoadView();
+	QueueTranslate(0, 1.8, -3);
+	QueueRotate(Anim.crossRot, 0, 1, 0);
+	if (BoxVisible(&CrossBox, QueueMatrix))
+		QueueMesh(CrossDL, Anim.crossRGB[0], Anim.crossRGB[1], Anim.crossRGB[2], 128.f);
 
 	// star
-	glPushMatrix();
-	glTranslatef(-3.5, 1.8, 2.7);
-	glRotatef(StarRot.GetValue(nowTime), 0, 1, 0);
-	SetMaterial(StarR.GetValue(nowTime), StarG.GetValue(nowTime), StarB.GetValue(nowTime), 128.f);
-	glCallList(StarDL);
-	glPopMatrix();
+	QueueLoadView();
+	QueueTranslate(-3.5, 1.8, 2.7);
+	QueueRotate(Anim.starRot, 0, 1, 0);
+	if (BoxVisible(&StarBox, QueueMatrix))
+		QueueMesh(StarDL, Anim.starRGB[0], Anim.starRGB[1], Anim.starRGB[2], 128.f);
 
 	// left lever
-	glPushMatrix();
-	glTranslatef(-2, 1.8, 5.26);
-	glRotatef(LeverL.GetValue(nowTime), 0, 1, 0);
-	glRotatef(-130, 0, 1, 0);
-	glCallList(LeverDL);
-	glPopMatrix();
+	QueueLoadView();
+	QueueTranslate(-2, 1.8, 5.26);
+	QueueRotate(Anim.leverL, 0, 1, 0);
+	QueueRotate(-130, 0, 1, 0);
+	if (BoxVisible(&LeverBox, QueueMatrix))
+		QueueMesh(LeverDL);
 
 	// right lever
-	glPushMatrix();
-	glTranslatef(0.97, 1.8, 5.26);
-	glRotatef(LeverR.GetValue(nowTime), 0, 1, 0);
-	glRotatef(130, 0, 1, 0);
-	glCallList(LeverDL);
-	glPopMatrix();
+	QueueLoadView();
+	QueueTranslate(0.97, 1.8, 5.26);
+	QueueRotate(Anim.leverR, 0, 1, 0);
+	QueueRotate(130, 0, 1, 0);
+	if (BoxVisible(&LeverBox, QueueMatrix))
+		QueueMesh(LeverDL);
 
 	// plunger
-	glPushMatrix();
-	glTranslatef(4.95, 1.8, PlungerZ.GetValue(nowTime));
-	glCallList(PlungerDL);
-	glPopMatrix();
+	QueueLoadView();
+	QueueTranslate(4.95, 1.8, Anim.plungerZ);
+	if (BoxVisible(&PlungerBox, QueueMatrix))
+		QueueMesh(PlungerDL);
 
 	// top plate
-	glPushMatrix();
-	SetMaterial(0.3f, 0.5f, 0.6f, 0.f);
-	glCallList(TopPlateDL);
-	glPopMatrix();
-
-	// left grid
-	glPushMatrix();
-	glTranslatef(-XSIDE / 2 + 5, 0, 0);
-	glRotatef(90, 0, 0, 1);
-	glCallList(GridDL);
-	glPopMatrix();
-
-	// right grid
-	glPushMatrix();
-	glTranslatef(XSIDE / 2 - 5, 0, 0);
-	glRotatef(90, 0, 0, 1);
-	glCallList(GridDL);
-	glPopMatrix();
-
-	// front grid
-	glPushMatrix();
-	glTranslatef(0, 0, -ZSIDE/2);
-	glRotatef(90, 1, 0, 0);
-	glCallList(GridDL);
-	glPopMatrix();
-
-	// back grid
-	glPushMatrix();
-	glTranslatef(0, 0, ZSIDE / 2);
-	glRotatef(90, 1, 0, 0);
-	glCallList(GridDL);
-	glPopMatrix();
+	QueueLoadView();
+	if (BoxVisible(&TopPlateBox, QueueMatrix))
+		QueueMesh(TopPlateDL);
+	SubmitDrawQueue();
+	if (DebugOn != 0)
+		fprintf(stderr, "Draw queue: %d draws, %d program changes, %d material changes, %d texture changes\n",
+			DrawQueueCounts.draws, DrawQueueCounts.programChanges, DrawQueueCounts.materialChanges,
+			DrawQueueCounts.textureChanges);
+
+	// left, right, front, back, and bottom grids, all in one instanced draw
+	// (drawn last so that the occlusion queries see everything in front of them)
+	TimeSegment( SEGMENT_GRIDS );
+	GLTRACE_SCOPE( "grids" );
+	DrawGrid();
+	TimeSegment( SEGMENT_FINISH );
+	GLTRACE_SCOPE( "overlay" );
 
-	// bottom grid
-	glPushMatrix();
-	glTranslatef(0, -1, 0);
-	glCallList(GridDL);
-	glPopMatrix();
+	if (DebugOn != 0)
+		fprintf(stderr, "Culling: %d tested, %d outside the frustum, %d drawn, %d conditional\n",
+			CullCounts.tested, CullCounts.frustumCulled, CullCounts.drawn, CullCounts.conditional);
 
 	glDisable(GL_LIGHTING);
 
@@ -682,14 +920,51 @@ Display( )
 	glColor3f( 1.f, 1.f, 1.f );
 	//DoRasterString( 5.f, 5.f, 0.f, (char *)"Text That Doesn't" );
 
+	// the performance hud, if it is on (see hud.cpp):
+	DrawHud( );
+
 	// swap the double-buffered framebuffers:
 
-	glutSwapBuffers( );
+	if( HeadlessOn == 0 )
+		glutSwapBuffers( );
 
 	// be sure the graphics buffer has been sent:
 	// note: be sure to use glFlush( ) here, not glFinish( ) !
 
 	glFlush( );
+	EndFrameTiming( );
+
+	// (how long the key events this frame shows took to get here -- see tableinput.cpp)
+	if( PhysicsOn != 0 )
+		LatencyFrameShown( PhysicsInput );
+	if( DebugOn != 0 )
+	{
+		for( int k = 0; k < NUMSTATEKINDS; k++ )
+			fprintf( stderr, "State cache: %-10s %4d calls, %4d saved\n", StateKindNames[k],
+				StateCounts.calls[k], StateCounts.saved[k] );
+	}
+	GLTRACE_END( );
+}
+
+
+// 0 means to sample the keyframe tracks, anything else is a baked table rate in Hz:
+
+void
+DoAnimationMenu( int id )
+{
+	FinishAnimationReload( );		// (it may be reading the table, or be about to swap in another)
+	if( id == 0 )
+	{
+		BakedOn = 0;
+	}
+	else
+	{
+		BakeAnimation( (float)id );
+		BakedOn = 1;
+	}
+
+	glutSetWindow( MainWindow );
+	glutPostRedisplay( );
 }
 
 
@@ -713,6 +988,16 @@ DoColorMenu( int id )
 }
 
 
+void
+DoCullingMenu( int id )
+{
+	CullingOn = id;
+
+	glutSetWindow( MainWindow );
+	glutPostRedisplay( );
+}
+
+
 void
 DoDebugMenu( int id )
 {
@@ -753,6 +1038,27 @@ DoDepthMenu( int id )
 }
 
 
+void
+DoFrameRateMenu( int id )
+{
+	TargetFps = id;
+	StartFramePacing( );
+
+	glutSetWindow( MainWindow );
+	glutPostRedisplay( );
+}
+
+
+void
+DoGridMenu( int id )
+{
+	BuildGrid( id );
+
+	glutSetWindow( MainWindow );
+	glutPostRedisplay( );
+}
+
+
 // main menu callback:
 
 void
@@ -771,6 +1077,7 @@ DoMainMenu( int id )
 			glutSetWindow( MainWindow );
 			glFinish( );
 			glutDestroyWindow( MainWindow );
+			StopSimThread( );
 			exit( 0 );
 			break;
 
@@ -793,6 +1100,137 @@ DoProjectMenu( int id )
 }
 
 
+void
+DoHudMenu( int id )
+{
+	SetHud( id );
+
+	glutSetWindow( MainWindow );
+	glutPostRedisplay( );
+}
+
+
+void
+DoLatencyMenu( int id )
+{
+	SetLatency( id );
+
+	glutSetWindow( MainWindow );
+	glutPostRedisplay( );
+}
+
+
+void
+DoBallMenu( int id )
+{
+	SetPhysics( id );
+
+	glutSetWindow( MainWindow );
+	glutPostRedisplay( );
+}
+
+
+void
+DoBallsMenu( int id )
+{
+	// (the simulation thread is stopped while the balls are changed)
+	bool running = StopSimThread( );
+	SetMultiball( id );
+	if( running )
+		StartSimThread( );
+
+	glutSetWindow( MainWindow );
+	glutPostRedisplay( );
+}
+
+
+void
+DoCollisionMenu( int id )
+{
+	bool running = StopSimThread( );
+	FieldOn = id;
+	if( running )
+		StartSimThread( );
+
+	glutSetWindow( MainWindow );
+	glutPostRedisplay( );
+}
+
+
+void
+DoDrawOrderMenu( int id )
+{
+	DrawSortOn = id;
+
+	glutSetWindow( MainWindow );
+	glutPostRedisplay( );
+}
+
+
+void
+DoStateCacheMenu( int id )
+{
+	SetStateCache( id );
+
+	glutSetWindow( MainWindow );
+	glutPostRedisplay( );
+}
+
+
+void
+DoRendererMenu( int id )
+{
+	BuffersOn = id;
+
+	glutSetWindow( MainWindow );
+	glutPostRedisplay( );
+}
+
+
+void
+DoTextureCompressMenu( int id )
+{
+	TextureCompressOn = id;
+	ReloadMipChain( (char *)"space.bmp", SpaceTex, &SpaceTexBytes );
+
+	glutSetWindow( MainWindow );
+	glutPostRedisplay( );
+}
+
+
+void
+DoTextureFilterMenu( int id )
+{
+	TextureFilter = id;
+	glBindTexture( GL_TEXTURE_2D, SpaceTex );
+	ApplyTextureFilter( );
+
+	glutSetWindow( MainWindow );
+	glutPostRedisplay( );
+}
+
+
+void
+DoVsyncMenu( int id )
+{
+	VsyncOn = id;
+	SetSwapInterval( VsyncOn );
+
+	glutSetWindow( MainWindow );
+	glutPostRedisplay( );
+}
+
+
+void
+DoVertexFormatMenu( int id )
+{
+	QuantizedOn = id;
+
+	glutSetWindow( MainWindow );
+	glutPostRedisplay( );
+}
+
+
 // use glut to display a string of characters using a raster font:
 
 void
@@ -874,6 +1312,16 @@ InitMenus( )
 	glutAddMenuEntry( "Off",  0 );
 	glutAddMenuEntry( "On",   1 );
 
+	int animationmenu = glutCreateMenu( DoAnimationMenu );
+	glutAddMenuEntry( "Keyframes",       0 );
+	glutAddMenuEntry( "Baked, 60 Hz",    60 );
+	glutAddMenuEntry( "Baked, 240 Hz",   240 );
+	glutAddMenuEntry( "Baked, 1000 Hz",  1000 );
+
+	int cullingmenu = glutCreateMenu( DoCullingMenu );
+	glutAddMenuEntry( "Off",  0 );
+	glutAddMenuEntry( "On",   1 );
+
 	int debugmenu = glutCreateMenu( DoDebugMenu );
 	glutAddMenuEntry( "Off",  0 );
 	glutAddMenuEntry( "On",   1 );
@@ -882,6 +1330,72 @@ InitMenus( )
 	glutAddMenuEntry( "Orthographic",  ORTHO );
 	glutAddMenuEntry( "Perspective",   PERSP );
 
+	int hudmenu = glutCreateMenu( DoHudMenu );
+	glutAddMenuEntry( "Off",  0 );
+	glutAddMenuEntry( "On",   1 );
+
+	int ballmenu = glutCreateMenu( DoBallMenu );
+	glutAddMenuEntry( "Animated",  0 );
+	glutAddMenuEntry( "Physics",   1 );
+
+	int ballsmenu = glutCreateMenu( DoBallsMenu );
+	glutAddMenuEntry( "1",     1 );
+	glutAddMenuEntry( "3",     3 );
+	glutAddMenuEntry( "12",    12 );
+	glutAddMenuEntry( "48",    48 );
+	glutAddMenuEntry( "1000",  1000 );
+	glutAddMenuEntry( "4096",  MAXBALLS );
+
+	int latencymenu = glutCreateMenu( DoLatencyMenu );
+	glutAddMenuEntry( "Off",                     0 );
+	glutAddMenuEntry( "Measure",                 1 );
+	glutAddMenuEntry( "Measure, Auto Presses",   LATENCYAUTO );
+
+	int collisionmenu = glutCreateMenu( DoCollisionMenu );
+	glutAddMenuEntry( "Triangles",       0 );
+	glutAddMenuEntry( "Distance Field",  1 );
+
+	int drawordermenu = glutCreateMenu( DoDrawOrderMenu );
+	glutAddMenuEntry( "As Queued",  0 );
+	glutAddMenuEntry( "Sorted",     1 );
+
+	int statecachemenu = glutCreateMenu( DoStateCacheMenu );
+	glutAddMenuEntry( "Off",  0 );
+	glutAddMenuEntry( "On",   1 );
+
+	int renderermenu = glutCreateMenu( DoRendererMenu );
+	glutAddMenuEntry( "Display Lists",   0 );
+	glutAddMenuEntry( "Buffer Objects",  1 );
+
+	int texturefiltermenu = glutCreateMenu( DoTextureFilterMenu );
+	glutAddMenuEntry( "Linear",       TEXFILTER_LINEAR );
+	glutAddMenuEntry( "Trilinear",    TEXFILTER_TRILINEAR );
+	glutAddMenuEntry( "Anisotropic",  TEXFILTER_ANISOTROPIC );
+
+	int texturecompressmenu = glutCreateMenu( DoTextureCompressMenu );
+	glutAddMenuEntry( "Off",  0 );
+	glutAddMenuEntry( "On",   1 );
+
+	int vertexformatmenu = glutCreateMenu( DoVertexFormatMenu );
+	glutAddMenuEntry( "Float",      0 );
+	glutAddMenuEntry( "Quantized",  1 );
+
+	int frameratemenu = glutCreateMenu( DoFrameRateMenu );
+	glutAddMenuEntry( "30",         30 );
+	glutAddMenuEntry( "60",         60 );
+	glutAddMenuEntry( "120",        120 );
+	glutAddMenuEntry( "Unlimited",  0 );
+
+	int vsyncmenu = glutCreateMenu( DoVsyncMenu );
+	glutAddMenuEntry( "Off",  0 );
+	glutAddMenuEntry( "On",   1 );
+
+	int gridmenu = glutCreateMenu( DoGridMenu );
+	glutAddMenuEntry( "100",   100 );
+	glutAddMenuEntry( "250",   250 );
+	glutAddMenuEntry( "500",   500 );
+	glutAddMenuEntry( "1000",  1000 );
+
 	int mainmenu = glutCreateMenu( DoMainMenu );
 	glutAddSubMenu(   "Axes",          axesmenu);
 	glutAddSubMenu(   "Axis Colors",   colormenu);
@@ -896,7 +1410,23 @@ InitMenus( )
 
 	glutAddSubMenu(   "Depth Cue",     depthcuemenu);
 	glutAddSubMenu(   "Projection",    projmenu );
+	glutAddSubMenu(   "Grid Resolution", gridmenu );
+	glutAddSubMenu(   "Culling",       cullingmenu );
+	glutAddSubMenu(   "Renderer",      renderermenu );
+	glutAddSubMenu(   "Draw Order",    drawordermenu );
+	glutAddSubMenu(   "Vertex Format", vertexformatmenu );
+	glutAddSubMenu(   "Texture Filter", texturefiltermenu );
+	glutAddSubMenu(   "Texture Compression", texturecompressmenu );
+	glutAddSubMenu(   "Animation",     animationmenu );
+	glutAddSubMenu(   "Ball",          ballmenu );
+	glutAddSubMenu(   "Balls",         ballsmenu );
+	glutAddSubMenu(   "Collision",     collisionmenu );
+	glutAddSubMenu(   "Input Latency", latencymenu );
+	glutAddSubMenu(   "Frame Rate",    frameratemenu );
+	glutAddSubMenu(   "Vsync",         vsyncmenu );
 	glutAddMenuEntry( "Reset",         RESET );
+	glutAddSubMenu(   "Performance HUD", hudmenu );
+	glutAddSubMenu(   "State Cache",   statecachemenu );
 	glutAddSubMenu(   "Debug",         debugmenu);
 	glutAddMenuEntry( "Quit",          QUIT );
 
@@ -916,6 +1446,70 @@ InitGraphics( )
 	if (DebugOn != 0)
 		fprintf(stderr, "Starting InitGraphics.\n");
 
+	// start reading the meshes and textures on the worker threads:
+	// (InitLists( ) builds each one's display list or texture as it comes in)
+
+	StartAssetLoads( );
+
+	// open the window, or the offscreen context in headless mode:
+
+	if( HeadlessOn != 0 )
+	{
+		if( ! CreateHeadlessContext( ) )
+			exit( 1 );
+	}
+	else
+		InitWindow( );
+
+	// set the framebuffer clear values:
+
+	glClearColor( BACKCOLOR[0], BACKCOLOR[1], BACKCOLOR[2], BACKCOLOR[3] );
+
+	// read all the keyframes from the animation file:
+	// (Animate( ) reloads it whenever it is saved)
+
+	LoadAnimation( (char *)"pinball.anim" );
+
+	// Space Texture (its pixels are uploaded by InitLists( ), once they have been read)
+	glGenTextures(1, &SpaceTex);
+
+	// init the glew package (a window must be open to do this):
+	// (the grid buffers and shader need it on every platform, not just windows)
+
+	GLenum err = glewInit( );
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+	// (a glew built for glx complains that there is no glx display under an egl context,
+	// but it has loaded the gl functions by then)
+	if( HeadlessOn != 0  &&  err == GLEW_ERROR_NO_GLX_DISPLAY )
+		err = GLEW_OK;
+#endif
+	if( err != GLEW_OK )
+	{
+		fprintf( stderr, "glewInit Error\n" );
+	}
+	else
+		fprintf( stderr, "GLEW initialized OK\n" );
+	fprintf( stderr, "Status: Using GLEW %s\n", glewGetString(GLEW_VERSION));
+
+	// headless, everything is drawn into a framebuffer object the size of the frames:
+
+	if( HeadlessOn != 0  &&  ! CreateHeadlessFramebuffer( ) )
+		exit( 1 );
+
+	// the state cache starts out knowing nothing about the new context:
+
+	InvalidateStateCache( );
+
+	// all other setups go here, such as GLSLProgram and KeyTime setups:
+
+}
+
+
+// open the glut window and setup the callback functions:
+
+void
+InitWindow( )
+{
 	// request the display modes:
 	// ask for red-green-blue-alpha color, double-buffering, and z-buffering:
 
@@ -931,10 +1525,6 @@ InitGraphics( )
 	MainWindow = glutCreateWindow( WINDOWTITLE );
 	glutSetWindowTitle( WINDOWTITLE );
 
-	// set the framebuffer clear values:
-
-	glClearColor( BACKCOLOR[0], BACKCOLOR[1], BACKCOLOR[2], BACKCOLOR[3] );
-
 	// setup the callback functions:
 	// DisplayFunc -- redraw the window
 	// ReshapeFunc -- handle the user resizing the window
@@ -960,6 +1550,8 @@ InitGraphics( )
 	glutDisplayFunc( Display );
 	glutReshapeFunc( Resize );
 	glutKeyboardFunc( Keyboard );
+	glutKeyboardUpFunc( KeyboardUp );
+	glutIgnoreKeyRepeat( 1 );			// (the levers and the plunger are held down)
 	glutMouseFunc( MouseButton );
 	glutMotionFunc( MouseMotion );
 	glutPassiveMotionFunc(MouseMotion);
@@ -977,235 +1569,12 @@ InitGraphics( )
 	glutMenuStateFunc( NULL );
 	glutTimerFunc( -1, NULL, 0 );
 
-	// setup glut to call Animate( ) every time it has
-	// 	nothing it needs to respond to (which is most of the time)
-	// we don't need to do this for this program, and really should set the argument to NULL
-	// but, this sets us up nicely for doing animation
-
-	glutIdleFunc( Animate );
-
-	float starRed = 0.2;
-	float starGreen = 0.35;
-	float starBlue = 0.45;
-	float crossRed = 0.45;
-	float crossGreen = 0.2;
-	float crossBlue = 0.4;
-
-	StarR.Init();
-		StarR.AddTimeValue(6.55, 0.8);
-		StarR.AddTimeValue(6.6, starRed);
-		StarR.AddTimeValue(8.3, starRed);
-		StarR.AddTimeValue(8.35, 0.8);
-
-	StarG.Init();
-		StarG.AddTimeValue(6.55, 0.7);
-		StarG.AddTimeValue(6.6, starGreen);
-		StarG.AddTimeValue(8.3, starGreen);
-		StarG.AddTimeValue(8.35, 0.7);
-
-	StarB.Init();
-		StarB.AddTimeValue(6.55, 0.3);
-		StarB.AddTimeValue(6.6, starBlue);
-		StarB.AddTimeValue(8.3, starBlue);
-		StarB.AddTimeValue(8.35, 0.3);
-
-	CrossR.Init();
-		CrossR.AddTimeValue(7.15, 0.8);
-		CrossR.AddTimeValue(7.2, crossRed);
-		CrossR.AddTimeValue(7.4, 0.8);
-
-	CrossG.Init();
-		CrossG.AddTimeValue(7.15, 0.7);
-		CrossG.AddTimeValue(7.2, crossGreen);
-		CrossG.AddTimeValue(7.4, 0.7);
-
-	CrossB.Init();
-		CrossB.AddTimeValue(7.15, 0.3);
-		CrossB.AddTimeValue(7.2, crossBlue);
-		CrossB.AddTimeValue(7.5, 0.3);
-
-	TriangleR.Init();
-		TriangleR.AddTimeValue(9.35, 0.8);
-		TriangleR.AddTimeValue(9.4, starRed);
-		TriangleR.AddTimeValue(9.45, 0.8);
-
-	TriangleG.Init();
-		TriangleG.AddTimeValue(9.35, 0.7);
-		TriangleG.AddTimeValue(9.4, starGreen);
-		TriangleG.AddTimeValue(9.45, 0.7);
-
-	TriangleB.Init();
-		TriangleB.AddTimeValue(9.3, 0.3);
-		TriangleB.AddTimeValue(9.4, starBlue);
-		TriangleB.AddTimeValue(9.5, 0.3);
-	
-	PosZ.Init();
-		PosZ.AddTimeValue(0.0, 35);
-		PosZ.AddTimeValue(3.0, 5);
-	
-	LookY.Init();
-		LookY.AddTimeValue(3.0, 10);
-		LookY.AddTimeValue(4.0, 0);
-
-	PlungerZ.Init();
-		PlungerZ.AddTimeValue(4.0, 6);
-		PlungerZ.AddTimeValue(6.0, 7.5);
-		PlungerZ.AddTimeValue(6.05, 6);
-
-	BallX.Init();
-		// moving pinball
-		BallX.AddTimeValue(6.1, 4.95);
-		BallX.AddTimeValue(6.2, 3.2);
-		BallX.AddTimeValue(6.3, 0);
-		BallX.AddTimeValue(6.4, -3.2);
-		BallX.AddTimeValue(6.5, -4.95);
-		// exit the road
-		BallX.AddTimeValue(6.6, -4);	 // hit the star
-		BallX.AddTimeValue(6.64, -3.08); // hit the star
-		BallX.AddTimeValue(6.67, -2.24); // hit the star
-		// hit the right lever
-		BallX.AddTimeValue(6.8, 0.05);	//exaggerate impact
-		BallX.AddTimeValue(6.95, 0.05);	// move down
-		BallX.AddTimeValue(7.0, 0.1);	//exaggerate impact
-		BallX.AddTimeValue(7.3, 1.46);	// hit the cross
-		// enter the chaos
-		BallX.AddTimeValue(7.7, -3.88);	// hit the cross
-		BallX.AddTimeValue(7.8, -3.24);
-		BallX.AddTimeValue(7.9, -3.95);
-		BallX.AddTimeValue(8.0, -3.55);
-		BallX.AddTimeValue(8.1, -3.55);
-		BallX.AddTimeValue(8.2, -3.38);
-		// exit the chaos
-		BallX.AddTimeValue(8.3, -3.1);
-		BallX.AddTimeValue(8.4, -3.14);	// hit the star
-		BallX.AddTimeValue(8.6, -2.19); // hit the star
-		BallX.AddTimeValue(8.7, -1.7);
-		// hit left lever
-		BallX.AddTimeValue(8.9, -1.42);	
-		BallX.AddTimeValue(9, -1.34);	//exaggerate impact
-		BallX.AddTimeValue(9.05, -0.8);
-		// hit right circle
-		BallX.AddTimeValue(9.3, 1.67);
-		// hit the triangle
-		BallX.AddTimeValue(9.4, 2.19);
-		// hit the left circle
-		BallX.AddTimeValue(9.6, -1.64);
-		// hit the right lever
-		BallX.AddTimeValue(10.0, 0.43);
-		BallX.AddTimeValue(10.05, 0.1);
-		BallX.AddTimeValue(10.1, -0.3);
-		BallX.AddTimeValue(10.3, -1);
-
-	BallZ.Init();
-		// plunger movement
-		BallZ.AddTimeValue(4.0, 4.3);
-		BallZ.AddTimeValue(6.0, 5.8);
-		BallZ.AddTimeValue(6.05, 4.3);
-		// moving pinball
-		BallZ.AddTimeValue(6.1, -1.5);
-		BallZ.AddTimeValue(6.2, -5.3);
-		BallZ.AddTimeValue(6.3, -6.5);
-		BallZ.AddTimeValue(6.4, -5.3);
-		BallZ.AddTimeValue(6.5, -1.5);
-		// exit the road
-		BallZ.AddTimeValue(6.6, 1.5);	// hit the star
-		BallZ.AddTimeValue(6.64, 1.6);	// hit the star
-		BallZ.AddTimeValue(6.67, 2.6);	// hit the star
-		// hit the right lever
-		BallZ.AddTimeValue(6.8, 5.13);	//exaggerate impact
-		BallZ.AddTimeValue(6.95, 5.4);	// move down
-		BallZ.AddTimeValue(7.0, 5.25);	//exaggerate impact
-		BallZ.AddTimeValue(7.3, -5);	// hit the cross
-		// enter the chaos
-		BallZ.AddTimeValue(7.7, -2.29);	// hit the cross
-		BallZ.AddTimeValue(7.8, -1.26);
-		BallZ.AddTimeValue(7.9, -1.5);
-		BallZ.AddTimeValue(8.0, -0.7);
-		BallZ.AddTimeValue(8.1, 0.1);
-		BallZ.AddTimeValue(8.2, 0.05);
-		// exit the chaos
-		BallZ.AddTimeValue(8.3, 1.04);
-		BallZ.AddTimeValue(8.4, 1.33);	// hit the star
-		BallZ.AddTimeValue(8.6, 2.36);	// hit the star
-		BallZ.AddTimeValue(8.7, 3.25);
-		// hit left lever
-		BallZ.AddTimeValue(8.9, 4.94);
-		BallZ.AddTimeValue(9, 5.56);	//exaggerate impact
-		BallZ.AddTimeValue(9.05, 5.0);
-		// hit right circle
-		BallZ.AddTimeValue(9.3, 0.46);
-		// hit the triangle
-		BallZ.AddTimeValue(9.4, 2.83);
-		// hit the left circle
-		BallZ.AddTimeValue(9.6, 0.3);
-		// hit right lever
-		BallZ.AddTimeValue(10.0, 4.86);
-		BallZ.AddTimeValue(10.05, 5.25);
-		BallZ.AddTimeValue(10.1, 5.74);
-		BallZ.AddTimeValue(10.3, 7.4);
-
-
-	StarRot.Init();
-		StarRot.AddTimeValue(6.6, 0);
-		StarRot.AddTimeValue(6.8, -360 * 1.8);
-		StarRot.AddTimeValue(8, -360 * 2.73);
-
-		StarRot.AddTimeValue(8.4, -360 * 2.73);
-		StarRot.AddTimeValue(8.75, -360 * 3);
-		StarRot.AddTimeValue(11, -360 * 3.25);
-
-	CrossRot.Init();
-		CrossRot.AddTimeValue(7.2, 0);
-		CrossRot.AddTimeValue(7.23, 50);
-		CrossRot.AddTimeValue(7.5, 100);
-		CrossRot.AddTimeValue(8.5, 160);
-		CrossRot.AddTimeValue(8.8, 180);
-
-	LeverL.Init();
-		LeverL.AddTimeValue(8.9, 0);
-		LeverL.AddTimeValue(8.95, -35);
-		LeverL.AddTimeValue(9.0, -35);
-		LeverL.AddTimeValue(9.05, 0);
-
-	LeverR.Init();
-		LeverR.AddTimeValue(6.8, 0);
-		LeverR.AddTimeValue(6.85, 30);
-		LeverR.AddTimeValue(6.95, 30);
-		LeverR.AddTimeValue(7.0, 0);
-
-	// Space Texture
-	int width, height;
-	char* file = (char*)"space.bmp";
-	unsigned char* texture = BmpToTexture(file, &width, &height);
-	if (texture == NULL)
-		fprintf(stderr, "Cannot open texture '%s'\n", file);
-	else
-		fprintf(stderr, "Opened '%s': width = %d ; height = %d\n", file, width, height);
-
-	glGenTextures(1, &SpaceTex);
-	glBindTexture(GL_TEXTURE_2D, SpaceTex);
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexImage2D(GL_TEXTURE_2D, 0, 3, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, texture);
-
-	// init the glew package (a window must be open to do this):
-
-#ifdef WIN32
-	GLenum err = glewInit( );
-	if( err != GLEW_OK )
-	{
-		fprintf( stderr, "glewInit Error\n" );
-	}
-	else
-		fprintf( stderr, "GLEW initialized OK\n" );
-	fprintf( stderr, "Status: Using GLEW %s\n", glewGetString(GLEW_VERSION));
-#endif
-
-	// all other setups go here, such as GLSLProgram and KeyTime setups:
+	// Animate( ) is called by the frame pacer at the target frame rate, not as the idle
+	// function -- so the program sleeps between frames, stops drawing when the window is
+	// hidden, and slows down to an attract loop when nobody is playing (see framepacer.cpp)
 
+	glutIdleFunc( NULL );
+	InitFramePacing( );
 }
 
 
@@ -1220,16 +1589,8 @@ InitLists( )
 	if (DebugOn != 0)
 		fprintf(stderr, "Starting InitLists.\n");
 
-	glutSetWindow( MainWindow );
-
-	// Create the top plate:
-	TopPlateDL = glGenLists(1);
-	glNewList(TopPlateDL, GL_COMPILE);
-	glRotatef(-90, 1, 0, 0);
-	glScalef(ScaleFactor, ScaleFactor, ScaleFactor);
-	SetMaterial(0.15f, 0.15f, 0.2f, 10.f);
-	LoadObjFile((char*)"Top.obj");
-	glEndList();
+	if( HeadlessOn == 0 )
+		glutSetWindow( MainWindow );
 
 	// Create the bottom plate:
 	float dx = 0.1016;
@@ -1238,10 +1599,8 @@ InitLists( )
 	BottomPlateDL = glGenLists(1);
 	glNewList(BottomPlateDL, GL_COMPILE);
 	glPushMatrix();
-		glBindTexture(GL_TEXTURE_2D, SpaceTex);
-		glRotatef(-90, 1, 0, 0);
-		glScalef(ScaleFactor, ScaleFactor, ScaleFactor);
 		//LoadObjFile((char*)"Bottom.obj");
+		glNormal3f(0., 1., 0.);
 		glBegin(GL_QUADS);
 			
 			glTexCoord2f(0.0, 0.0);
@@ -1282,58 +1641,56 @@ InitLists( )
 	glPopMatrix();
 	glEndList();
 
+	// the same plate for the buffer renderer -- each quad is split into 2 triangles across its
+	// 1-3 diagonal, the way GL_QUADS gets drawn, only the top has texture coordinates (the other
+	// faces get the last one, (0.,1.)), and every vertex has the list's one normal:
+	// (the draw queue rotates and scales both of them, and binds the texture)
+	float plate[6][4][3] =
+	{
+		{ {-dx, -dy,  dz}, { dx, -dy,  dz}, { dx,  dy,  dz}, {-dx,  dy,  dz} },
+		{ {-dx, -dy, -dz}, { dx, -dy, -dz}, { dx,  dy, -dz}, {-dx,  dy, -dz} },
+		{ {-dx, -dy,  dz}, { dx, -dy,  dz}, { dx, -dy, -dz}, {-dx, -dy, -dz} },
+		{ { dx, -dy,  dz}, { dx,  dy,  dz}, { dx,  dy, -dz}, { dx, -dy, -dz} },
+		{ {-dx, -dy,  dz}, {-dx,  dy,  dz}, {-dx,  dy, -dz}, {-dx, -dy, -dz} },
+		{ {-dx,  dy,  dz}, { dx,  dy,  dz}, { dx,  dy, -dz}, {-dx,  dy, -dz} },
+	};
+	const float topST[4][2] = { {0., 0.}, {1., 0.}, {1., 1.}, {0., 1.} };
+	float plateVertices[24 * OBJVERTEXFLOATS];
+	GLuint plateIndices[36];
+	for (int f = 0; f < 6; f++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			float* v = &plateVertices[(4*f + c) * OBJVERTEXFLOATS];
+			v[0] = (f == 0) ? topST[c][0] : 0.f;
+			v[1] = (f == 0) ? topST[c][1] : 1.f;
+			v[2] = v[4] = 0.f;
+			v[3] = 1.f;
+			v[5] = plate[f][c][0];
+			v[6] = plate[f][c][1];
+			v[7] = plate[f][c][2];
+		}
+		const int corners[6] = { 0, 1, 3, 1, 2, 3 };
+		for (int k = 0; k < 6; k++)
+			plateIndices[6*f + k] = (GLuint)(4*f + corners[k]);
+	}
+	BuildVertexBuffer(&BottomPlateVB, GL_TRIANGLES, plateVertices, 24, plateIndices, 36, true, true);
+
+	// (the -90 degree rotation about x turns the plate's y into -z and its z into y)
+	InitBox(&BottomPlateBox);
+	ExpandBox(&BottomPlateBox, -dx * ScaleFactor, -dz * ScaleFactor, -dy * ScaleFactor);
+	ExpandBox(&BottomPlateBox,  dx * ScaleFactor,  dz * ScaleFactor,  dy * ScaleFactor);
+
 	// create the pinball:
 	SphereDL = glGenLists(1);
 	glNewList(SphereDL, GL_COMPILE);
 	SetMaterial(1.f, 1.f, 1.f, 128.f);
 	OsuSphere(0.35f, 32, 32);
 	glEndList();
-
-	// Create the plunger:
-	PlungerDL = glGenLists(1);
-	glNewList(PlungerDL, GL_COMPILE);
-	glRotatef(-90, 1, 0, 0);
-	glScalef(ScaleFactor, ScaleFactor, ScaleFactor);
-	SetMaterial(0.8f, 0.7f, 0.3f, 128.f);
-	LoadObjFile((char*)"Starter.obj");
-	glEndList();
-
-	// Create the lever:
-	LeverDL = glGenLists(1);
-	glNewList(LeverDL, GL_COMPILE);
-	glScalef(ScaleFactor, ScaleFactor, ScaleFactor);
-	SetMaterial(0.8f, 0.7f, 0.3f, 128.f);
-	LoadObjFile((char*)"Lever.obj");
-	glEndList();
-
-	// Create the cross:
-	CrossDL = glGenLists(1);
-	glNewList(CrossDL, GL_COMPILE);
-	glScalef(ScaleFactor, ScaleFactor, ScaleFactor);
-	LoadObjFile((char*)"Sparkle.obj");
-	glEndList();
-
-	// Create the static circle:
-	CircleStaticDL = glGenLists(1);
-	glNewList(CircleStaticDL, GL_COMPILE);
-	glScalef(ScaleFactor, ScaleFactor, ScaleFactor);
-	LoadObjFile((char*)"Circle.obj");
-	glEndList();
-
-	// Create the static star:
-	StarDL = glGenLists(1);
-	glNewList(StarDL, GL_COMPILE);
-	glScalef(ScaleFactor, ScaleFactor, ScaleFactor);
-	LoadObjFile((char*)"Star.obj");
-	glEndList();
-
-	// Create the static triangle:
-	TriangleStaticDL = glGenLists(1);
-	glNewList(TriangleStaticDL, GL_COMPILE);
-	glRotatef(-30, 0, 1, 0);
-	glScalef(ScaleFactor, ScaleFactor, ScaleFactor);
-	LoadObjFile((char*)"Triangle.obj");
-	glEndList();
+	BuildSphereBuffer(0.35f, 32, 32, &SphereVB);
+	InitBox(&SphereBox);
+	ExpandBox(&SphereBox, -0.35f, -0.35f, -0.35f);
+	ExpandBox(&SphereBox,  0.35f,  0.35f,  0.35f);
 
 	// create the axes:
 	AxesList = glGenLists( 1 );
@@ -1343,22 +1700,69 @@ InitLists( )
 		glLineWidth( 1. );
 	glEndList( );
 
-	// create the grid:
-	GridDL = glGenLists(1);
-	glNewList(GridDL, GL_COMPILE);
-	SetMaterial(0.5f, 0.5f, 0.6f, 30.f);
-	glNormal3f(0., 1., 0.);
-	for (int i = 0; i < NZ; i++)
+	// create the grid buffers and the per-wall transforms:
+	InitGrid();
+
+	// build the obj display lists and upload the textures in whatever order the workers finish them:
+	// (the meshes come out of the asset bundle if there is one, else from the obj files)
+	int asset;
+	while ((asset = NextLoadedAsset()) >= 0)
 	{
-		glBegin(GL_QUAD_STRIP);
-		for (int j = 0; j < NX; j++)
+		struct LoadedAsset* a = &LoadedAssets[asset];
+		const char* file = BundleAssets[asset].name;
+		if (BundleAssets[asset].type == BUNDLE_TEXTURE)
 		{
-			glVertex3f(X0 + DX * (float)j, YGRID, Z0 + DZ * (float)(i + 0));
-			glVertex3f(X0 + DX * (float)j, YGRID, Z0 + DZ * (float)(i + 1));
+			if (!a->ok)
+			{
+				fprintf(stderr, "Cannot open texture '%s'\n", file);
+				continue;
+			}
+			struct MipChain* mips = &a->mips;
+			const struct MipLevel* last = &mips->levels[mips->numLevels - 1];
+			fprintf(stderr, "Opened '%s': width = %d ; height = %d ; %d mip levels, %s, %d KB\n", file,
+				mips->levels[0].width, mips->levels[0].height, mips->numLevels,
+				mips->format == TEXCACHE_BC1 ? "BC1" : "RGB", (last->offset + last->size) / 1024);
+			if (!mips->fromCache)
+				fprintf(stderr, "  (built and cached in %.1f ms, BC1 PSNR %.1f dB)\n", mips->buildMs, mips->psnr);
+			if (strcmp(file, "space.bmp") == 0)
+				SpaceTexBytes = UploadMipChain(SpaceTex, mips);
+			FreeMipChain(mips);
+			continue;
 		}
-		glEnd();
+
+		if (!a->ok)
+			continue;
+		for (int i = 0; i < NUMMESHLISTS; i++)
+		{
+			if (strcmp(file, MeshLists[i].file) == 0)
+				BuildMeshList(&MeshLists[i], &a->mesh);
+		}
+		FreeObjMesh(&a->mesh);
 	}
+
+	// everything has been copied into display lists and textures, so the workers and the bundle can go:
+	FinishAssetLoads();
+}
+
+
+// compile one obj file's display list, and get its bounding box:
+
+void
+BuildMeshList( struct MeshList *ml, struct ObjMesh *mesh )
+{
+	*ml->list = glGenLists(1);
+	glNewList(*ml->list, GL_COMPILE);
+	if (ml->angle != 0.)
+		glRotatef(ml->angle, ml->ax, ml->ay, ml->az);
+	glScalef(ScaleFactor, ScaleFactor, ScaleFactor);
+	if (ml->material != NULL)
+		SetMaterial(ml->material[0], ml->material[1], ml->material[2], ml->material[3]);
+	DrawObjMesh(mesh);
 	glEndList();
+	MeshBox(mesh, ml->angle, ml->ax, ml->ay, ml->az, ScaleFactor, ml->box);
+	BuildCollisionMesh(ml, mesh);
+	BuildMeshBuffer(mesh, &ml->buffer);
+	BuildQuantizedMesh(ml->file, mesh, ScaleFactor, &ml->quantized);
 }
 
 
@@ -1369,6 +1773,7 @@ Keyboard( unsigned char c, int x, int y )
 {
 	if( DebugOn != 0 )
 		fprintf( stderr, "Keyboard: '%c' (0x%0x)\n", c, c );
+	NoteActivity( );
 
 	switch( c )
 	{
@@ -1388,6 +1793,45 @@ Keyboard( unsigned char c, int x, int y )
 			DoMainMenu( QUIT );	// will not return here
 			break;				// happy compiler
 
+		case 'h':
+		case 'H':
+			SetHud( !HudOn );
+			break;
+
+#ifdef GL_TRACE
+		case 't':
+		case 'T':
+			GlTraceDumpNext = 1;
+			break;
+#endif
+
+		case 'r':
+		case 'R':
+			BuffersOn = !BuffersOn;
+			fprintf( stderr, "Renderer: %s\n", BuffersOn ? "buffer objects" : "display lists" );
+			break;
+
+		case 'b':
+		case 'B':
+			SetPhysics( !PhysicsOn );
+			break;
+
+		case 'z':
+		case 'Z':
+			if( PhysicsOn != 0 )
+				PushTableKey( KEYLEFTLEVER, true );
+			break;
+
+		case '/':
+			if( PhysicsOn != 0 )
+				PushTableKey( KEYRIGHTLEVER, true );
+			break;
+
+		case ' ':
+			if( PhysicsOn != 0 )
+				PushTableKey( KEYPLUNGER, true );
+			break;
+
 		case 'l':
 		case 'L':
 			if (LightSwitch == 0.0) { LightSwitch = 1.0; }
@@ -1408,6 +1852,34 @@ Keyboard( unsigned char c, int x, int y )
 }
 
 
+// the keyboard release callback -- for the keys that are held down:
+
+void
+KeyboardUp( unsigned char c, int x, int y )
+{
+	NoteActivity( );
+
+	switch( c )
+	{
+		case 'z':
+		case 'Z':
+			if( PhysicsOn != 0 )
+				PushTableKey( KEYLEFTLEVER, false );
+			break;
+
+		case '/':
+			if( PhysicsOn != 0 )
+				PushTableKey( KEYRIGHTLEVER, false );
+			break;
+
+		case ' ':
+			if( PhysicsOn != 0 )
+				PushTableKey( KEYPLUNGER, false );
+			break;
+	}
+}
+
+
 // called when the mouse button transitions down or up:
 
 void
@@ -1417,6 +1889,7 @@ MouseButton( int button, int state, int x, int y )
 
 	if( DebugOn != 0 )
 		fprintf( stderr, "MouseButton: %d, %d, %d, %d\n", button, state, x, y );
+	NoteActivity( );
 
 	
 	// get the proper button bit mask:
@@ -1478,6 +1951,8 @@ MouseMotion( int x, int y )
 	int dx = x - Xmouse;		// change in mouse coords
 	int dy = y - Ymouse;
 
+	NoteActivity( );
+
 	if( ( ActiveButton & LEFT ) != 0 )
 	{
 		Xrot += ( ANGFACT*dy );
@@ -1546,14 +2021,14 @@ Visibility ( int state )
 
 	if( state == GLUT_VISIBLE )
 	{
+		SetWindowVisible( 1 );
 		glutSetWindow( MainWindow );
 		glutPostRedisplay( );
 	}
 	else
 	{
-		// could optimize by keeping track of the fact
-		// that the window is not visible and avoid
-		// animating or redrawing it ...
+		// stop animating and redrawing until it can be seen again:
+		SetWindowVisible( 0 );
 	}
 }
 
@@ -0,0 +1,226 @@
+// frame pacing -- drawing at a target frame rate instead of as fast as the idle callback spins:
+//
+//	Animate( ) used to be the glut idle function, which glut calls again the moment it
+//	returns -- so the program redrew as fast as it could and kept a core at 100% even
+//	with nothing changing on the screen, or with the window hidden
+//
+//	now each frame is started by a glut timer:
+//
+//		the timer is set to go off a little (PACINGSLACKMS) before the next frame is due,
+//		since glut timers only have millisecond resolution and can be late, and the
+//		rest of the wait is a precise sleep_until( ) -- the process sleeps in between
+//
+//		the next frame is due one frame period after the last one started -- if vsync
+//		is on and the swap held the frame up past that, the next frame starts right away
+//		instead of adding a sleep on top, so the swap does the pacing
+//
+//		when the window is hidden (or iconified), the timer just isn't set again, and
+//		Visibility( ) starts it back up when the window can be seen
+//
+//		after ATTRACTSECONDS with no keyboard, mouse, or menu input, the frame rate
+//		drops to ATTRACTFPS -- the table keeps playing its animation as an attract
+//		loop, and any input brings the full rate right back
+//
+//	glut timers can't be cancelled, so each one carries a generation number, and a
+//	timer from before the last restart is ignored when it goes off
+
+#include <chrono>
+#include <thread>
+#include <time.h>
+
+#ifdef WIN32
+#include <windows.h>
+#elif !defined(__APPLE__)
+// (just the one glx function, so X11's macros don't come along with all of glx.h)
+extern "C" void ( *glXGetProcAddressARB( const GLubyte * ) )( void );
+#endif
+
+
+const int	PACINGSLACKMS  = 2;			// how early the glut timer goes off
+const int	ATTRACTFPS     = 10;
+const int	ATTRACTSECONDS = 120;
+
+int		TargetFps = 60;					// 0 means as fast as possible
+int		VsyncOn = 1;					// != 0 means swaps wait for the vertical retrace
+int		WindowVisible = 1;
+bool	AttractMode = false;
+
+typedef std::chrono::steady_clock	PacingClock;
+
+PacingClock::time_point	NextFrameDue;
+PacingClock::time_point	LastActivity;
+int						PacingGeneration;		// the generation of the timer that should be pending
+bool					PacingRunning;
+
+// for the once-a-second report with DebugOn:
+
+PacingClock::time_point	ReportStart;
+int						ReportFrames;
+clock_t					ReportCpu;
+
+
+// ask the driver for (or not) vsync:
+
+void
+SetSwapInterval( int interval )
+{
+#ifdef WIN32
+	typedef BOOL (WINAPI *SwapIntervalProc)( int );
+	SwapIntervalProc swapInterval = (SwapIntervalProc)wglGetProcAddress( "wglSwapIntervalEXT" );
+	if( swapInterval != NULL )
+		swapInterval( interval );
+#elif !defined(__APPLE__)
+	typedef int (*SwapIntervalProc)( unsigned int );
+	SwapIntervalProc swapInterval = (SwapIntervalProc)glXGetProcAddressARB( (const GLubyte *)"glXSwapIntervalMESA" );
+	if( swapInterval == NULL )
+		swapInterval = (SwapIntervalProc)glXGetProcAddressARB( (const GLubyte *)"glXSwapIntervalSGI" );
+	if( swapInterval != NULL )
+		swapInterval( (unsigned int)interval );
+#endif
+}
+
+
+// how long one frame is right now:
+
+PacingClock::duration
+FramePeriod( )
+{
+	int fps = AttractMode ? ATTRACTFPS : TargetFps;
+	if( fps <= 0 )
+		return PacingClock::duration::zero( );
+	return std::chrono::duration_cast<PacingClock::duration>( std::chrono::duration<double>( 1. / (double)fps ) );
+}
+
+
+void	PacedFrame( int );
+
+
+// set the glut timer for the next frame:
+
+void
+ScheduleFrame( )
+{
+	PacingClock::duration wait = NextFrameDue - PacingClock::now( );
+	int ms = (int)std::chrono::duration_cast<std::chrono::milliseconds>( wait ).count( ) - PACINGSLACKMS;
+	glutTimerFunc( ms > 0 ? ms : 0, PacedFrame, PacingGeneration );
+}
+
+
+// (re)start pacing from now:
+
+void
+StartFramePacing( )
+{
+	PacingGeneration++;
+	PacingRunning = true;
+	NextFrameDue = PacingClock::now( );
+	ReportStart = NextFrameDue;
+	ReportFrames = 0;
+	ReportCpu = clock( );
+	ScheduleFrame( );
+}
+
+
+// some input came in -- leave attract mode if it was on:
+
+void
+NoteActivity( )
+{
+	LastActivity = PacingClock::now( );
+	if( AttractMode )
+	{
+		AttractMode = false;
+		if( DebugOn != 0 )
+			fprintf( stderr, "Leaving attract mode\n" );
+		if( PacingRunning )
+			StartFramePacing( );		// don't wait out the rest of a slow frame
+	}
+}
+
+
+// the glut timer callback -- wait out the last bit precisely, then start a frame:
+
+void
+PacedFrame( int generation )
+{
+	if( generation != PacingGeneration )
+		return;
+	if( WindowVisible == 0 )
+	{
+		PacingRunning = false;
+		return;
+	}
+
+	PacingClock::time_point now = PacingClock::now( );
+	if( now < NextFrameDue )
+	{
+		std::this_thread::sleep_until( NextFrameDue );
+		now = PacingClock::now( );
+	}
+
+	if( ! AttractMode  &&  now - LastActivity > std::chrono::seconds( ATTRACTSECONDS ) )
+	{
+		AttractMode = true;
+		if( DebugOn != 0 )
+			fprintf( stderr, "No input for %d seconds -- attract mode at %d fps\n", ATTRACTSECONDS, ATTRACTFPS );
+	}
+
+	Animate( );
+
+	// the next frame is due a period after this one was -- unless this one started late
+	// (the swap held it, or the frame took too long), then it is due a period from now:
+
+	NextFrameDue += FramePeriod( );
+	if( NextFrameDue < now )
+		NextFrameDue = now + FramePeriod( );
+	ScheduleFrame( );
+
+	if( DebugOn != 0 )
+	{
+		ReportFrames++;
+		double seconds = std::chrono::duration<double>( now - ReportStart ).count( );
+		if( seconds >= 1. )
+		{
+			// (the cpu time is the whole process's, so it includes the drawing and any worker threads)
+			clock_t cpu = clock( );
+			fprintf( stderr, "Frames: %.1f fps%s, %.0f%% cpu\n", (double)ReportFrames / seconds,
+				AttractMode ? " (attract mode)" : "", 100. * (double)( cpu - ReportCpu ) / CLOCKS_PER_SEC / seconds );
+			ReportStart = now;
+			ReportFrames = 0;
+			ReportCpu = cpu;
+		}
+	}
+}
+
+
+// the window was shown or hidden:
+
+void
+SetWindowVisible( int visible )
+{
+	WindowVisible = visible;
+	if( visible != 0  &&  ! PacingRunning )
+		StartFramePacing( );
+	// (a hidden window's pending timer goes off once more and then stops)
+}
+
+
+// glut's menu state callback -- a menu being used counts as input:
+
+void
+MenuState( int )
+{
+	NoteActivity( );
+}
+
+
+// set everything up -- called once the window is open:
+
+void
+InitFramePacing( )
+{
+	SetSwapInterval( VsyncOn );
+	LastActivity = PacingClock::now( );
+	glutMenuStateFunc( MenuState );
+	StartFramePacing( );
+}
@@ -0,0 +1,248 @@
+// frame timing -- how long each part of Display( ) takes, on the cpu and on the gpu:
+//
+//	Display( ) is split into segments (the setup, the bottom plate, the dynamic objects,
+//	the grids, and the finish -- the text and the swap), and TimeSegment( ) is called
+//	at the start of each one
+//
+//	the cpu time of a segment is the wall clock time spent issuing its gl calls, and the
+//	gpu time is a GL_TIME_ELAPSED query around the same calls -- the queries can't be
+//	nested, which is why the segments just follow one another and the frame's total is
+//	their sum
+//
+//	query results come back a few frames late, so there are TIMINGFRAMESINFLIGHT sets
+//	of queries used round-robin, and a frame's times are picked up when its set comes
+//	around again -- without waiting: if its last query still isn't done, the frame is
+//	recorded with its cpu times and no gpu ones (FlushFrameTiming( ), for the benchmark,
+//	does wait for the gpu)
+//
+//	what the timing itself costs the cpu -- the clock reads, beginning and ending the
+//	queries, and picking up the results -- is kept with each frame as its timingMs
+//
+//	all of it does nothing unless FrameTimingOn is set
+//
+//	the draw calls and vertices of each frame are counted here too (always -- it is just
+//	two adds a draw), by CountDraw( ) calls next to the draws themselves
+
+#include <chrono>
+
+
+enum FrameSegment
+{
+	SEGMENT_SETUP,
+	SEGMENT_PLATE,
+	SEGMENT_OBJECTS,
+	SEGMENT_GRIDS,
+	SEGMENT_FINISH,
+	NUMSEGMENTS
+};
+
+const char *	SegmentNames[NUMSEGMENTS] =
+{
+	"setup",
+	"bottom_plate",
+	"dynamic_objects",
+	"grids",
+	"finish"
+};
+
+const int	TIMINGFRAMESINFLIGHT = 4;
+const int	TIMINGHISTORY = 256;			// frames kept in FrameTimings[ ]
+
+struct FrameTiming
+{
+	double		cpuMs[NUMSEGMENTS];
+	double		gpuMs[NUMSEGMENTS];		// < 0. if there are no timer queries, or they weren't back in time
+	double		cpuTotalMs;
+	double		gpuTotalMs;
+	double		timingMs;				// the timing's own cost
+};
+
+struct TimingSlot
+{
+	GLuint		queries[NUMSEGMENTS];
+	double		cpuMs[NUMSEGMENTS];
+	bool		used[NUMSEGMENTS];		// Display( ) doesn't always get to every segment
+	int			last;					// the segment whose query was issued last, -1 for none
+	bool		pending;				// the queries have been issued but not read
+	double		timingMs;
+};
+
+// how much this frame drew:
+
+struct DrawStats
+{
+	int			drawCalls;
+	long long	vertices;				// the vertices (or indices) submitted, instances included
+};
+
+int					FrameTimingOn = 0;		// != 0 means Display( ) is timed
+bool				GpuTimersOk;
+
+struct DrawStats	DrawCounts;				// this frame's counts
+struct FrameTiming	FrameTimings[TIMINGHISTORY];
+int					FrameTimingCount;		// how many frames have been recorded (the newest is FrameTimings[(FrameTimingCount-1) % TIMINGHISTORY])
+
+typedef std::chrono::steady_clock	TimingClock;
+
+struct TimingSlot		TimingSlots[TIMINGFRAMESINFLIGHT];
+bool					TimingSlotsMade;
+int						CurrentSlot;			// the slot this frame is using
+int						TimingSegment = -1;		// the segment being timed, -1 between frames
+TimingClock::time_point	SegmentStart;
+
+
+// count one draw call:
+
+inline void
+CountDraw( long long vertices )
+{
+	DrawCounts.drawCalls++;
+	DrawCounts.vertices += vertices;
+}
+
+
+// read a slot's queries and record its frame -- waiting for them if wait is set, and
+// otherwise leaving its gpu times out if they aren't back yet:
+// (the queries finish in the order they were issued, so the last one says for all of them)
+
+void
+CollectTimingSlot( struct TimingSlot *ts, bool wait )
+{
+	if( ! ts->pending )
+		return;
+	ts->pending = false;
+
+	bool gpu = GpuTimersOk;
+	if( gpu  &&  ! wait  &&  ts->last >= 0 )
+	{
+		GLint available = 0;
+		glGetQueryObjectiv( ts->queries[ ts->last ], GL_QUERY_RESULT_AVAILABLE, &available );
+		gpu = ( available != 0 );
+	}
+
+	struct FrameTiming *ft = &FrameTimings[ FrameTimingCount % TIMINGHISTORY ];
+	ft->cpuTotalMs = 0.;
+	ft->gpuTotalMs = gpu ? 0. : -1.;
+	ft->timingMs = ts->timingMs;
+	for( int s = 0; s < NUMSEGMENTS; s++ )
+	{
+		ft->cpuMs[s] = ts->cpuMs[s];
+		ft->cpuTotalMs += ts->cpuMs[s];
+		ft->gpuMs[s] = gpu ? 0. : -1.;
+		if( gpu  &&  ts->used[s] )
+		{
+			GLuint64 ns = 0;
+			glGetQueryObjectui64v( ts->queries[s], GL_QUERY_RESULT, &ns );
+			ft->gpuMs[s] = (double)ns / 1000000.;
+			ft->gpuTotalMs += ft->gpuMs[s];
+		}
+	}
+	FrameTimingCount++;
+}
+
+
+// the most recently recorded frame (NULL if there hasn't been one):
+
+struct FrameTiming *
+LastFrameTiming( )
+{
+	if( FrameTimingCount == 0 )
+		return NULL;
+	return &FrameTimings[ ( FrameTimingCount - 1 ) % TIMINGHISTORY ];
+}
+
+
+// end the segment being timed, and start another (or none, with -1):
+
+void
+TimeSegment( int segment )
+{
+	if( FrameTimingOn == 0  ||  ( TimingSegment < 0  &&  segment < 0 ) )
+		return;
+
+	TimingClock::time_point now = TimingClock::now( );
+	struct TimingSlot *ts = &TimingSlots[CurrentSlot];
+	if( TimingSegment >= 0 )
+	{
+		ts->cpuMs[TimingSegment] = std::chrono::duration<double, std::milli>( now - SegmentStart ).count( );
+		if( GpuTimersOk )
+			glEndQuery( GL_TIME_ELAPSED );
+	}
+
+	TimingSegment = segment;
+	if( segment >= 0 )
+	{
+		if( GpuTimersOk )
+		{
+			glBeginQuery( GL_TIME_ELAPSED, ts->queries[segment] );
+			ts->last = segment;
+		}
+		ts->used[segment] = true;
+		SegmentStart = TimingClock::now( );
+		ts->timingMs += std::chrono::duration<double, std::milli>( SegmentStart - now ).count( );
+	}
+	else
+		ts->timingMs += std::chrono::duration<double, std::milli>( TimingClock::now( ) - now ).count( );
+}
+
+
+// called at the top of Display( ) -- zeroes the counts and starts timing its setup segment:
+
+void
+StartFrameTiming( )
+{
+	DrawCounts.drawCalls = 0;
+	DrawCounts.vertices = 0;
+	if( FrameTimingOn == 0 )
+		return;
+	TimingClock::time_point start = TimingClock::now( );
+
+	if( ! TimingSlotsMade )
+	{
+		GpuTimersOk = ( GLEW_ARB_timer_query != 0 );
+		if( GpuTimersOk )
+		{
+			for( int i = 0; i < TIMINGFRAMESINFLIGHT; i++ )
+				glGenQueries( NUMSEGMENTS, TimingSlots[i].queries );
+		}
+		else
+			fprintf( stderr, "No GL_ARB_timer_query -- only cpu times will be recorded\n" );
+		TimingSlotsMade = true;
+	}
+
+	CurrentSlot = ( CurrentSlot + 1 ) % TIMINGFRAMESINFLIGHT;
+	struct TimingSlot *ts = &TimingSlots[CurrentSlot];
+	CollectTimingSlot( ts, false );
+	for( int s = 0; s < NUMSEGMENTS; s++ )
+	{
+		ts->cpuMs[s] = 0.;
+		ts->used[s] = false;
+	}
+	ts->last = -1;
+	ts->timingMs = std::chrono::duration<double, std::milli>( TimingClock::now( ) - start ).count( );
+
+	TimingSegment = -1;
+	TimeSegment( SEGMENT_SETUP );
+}
+
+
+// called at the end of Display( ):
+
+void
+EndFrameTiming( )
+{
+	if( FrameTimingOn == 0  ||  TimingSegment < 0 )
+		return;
+	TimeSegment( -1 );
+	TimingSlots[CurrentSlot].pending = true;
+}
+
+
+// wait for every frame still in flight and record it:
+
+void
+FlushFrameTiming( )
+{
+	for( int i = 1; i <= TIMINGFRAMESINFLIGHT; i++ )
+		CollectTimingSlot( &TimingSlots[ ( CurrentSlot + i ) % TIMINGFRAMESINFLIGHT ], true );
+}
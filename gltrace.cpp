@@ -0,0 +1,454 @@
+// the gl call trace -- counting (and optionally recording) the gl calls each frame makes:
+//
+//	compiled in only with GL_TRACE defined (like the DEMO_ options) -- without it, the
+//	GLTRACE_ macros below are empty and nothing here exists, so it costs nothing
+//
+//	with it, the gl entry points in GlTraceNames[ ] are wrapped by macros: each call is
+//	counted against the scope that is current (GLTRACE_SCOPE( "name" ) starts a scope,
+//	and it lasts until the next one), and then passed on to gl -- the time from one
+//	scope to the next is added to that scope too, so the counts and the cpu time of
+//	e.g. the LightSwitch branches in Display( ) can be told apart from the rest
+//
+//	GLTRACE_FRAME( ) is called at the start of each frame and GLTRACE_END( ) at the end
+//	(calls in between frames are counted in the "(outside)" scope, but not timed) --
+//	GLTRACE_FRAME( ) keeps the last frame's
+//	counts (and prints them with DebugOn), and if GlTraceDumpNext was set (the 't' key)
+//	it writes every call of the frame that follows, with its arguments, to
+//	gltrace_NNNNN.txt, with that frame's counts at the end
+//
+//	this file has to be included before any code that calls gl, so the macros see it
+
+#ifdef GL_TRACE
+
+#include <chrono>
+#include <stdarg.h>
+#include <string.h>
+
+
+enum GlTraceFunc
+{
+	TRACE_CALLLIST,
+	TRACE_PUSHMATRIX,
+	TRACE_POPMATRIX,
+	TRACE_TRANSFORM,			// glTranslatef, glRotatef, glScalef
+	TRACE_ENABLE,
+	TRACE_DISABLE,
+	TRACE_MATERIAL,				// glMaterialf, glMaterialfv
+	TRACE_LIGHT,				// glLightf, glLightfv
+	TRACE_BINDTEXTURE,
+	TRACE_TEXENV,
+	TRACE_SHADEMODEL,
+	TRACE_FOG,					// glFogf, glFogi, glFogfv
+	TRACE_COLOR,
+	TRACE_BEGIN,
+	TRACE_DRAWARRAYS,
+	TRACE_DRAWELEMENTS,
+	TRACE_DRAWINSTANCED,
+	NUMTRACEFUNCS
+};
+
+const char *	GlTraceNames[NUMTRACEFUNCS] =
+{
+	"glCallList",
+	"glPushMatrix",
+	"glPopMatrix",
+	"glTranslate/Rotate/Scale",
+	"glEnable",
+	"glDisable",
+	"glMaterial",
+	"glLight",
+	"glBindTexture",
+	"glTexEnv",
+	"glShadeModel",
+	"glFog",
+	"glColor",
+	"glBegin",
+	"glDrawArrays",
+	"glDrawElements",
+	"glDrawElementsInstanced"
+};
+
+const int	MAXTRACESCOPES = 16;
+
+struct GlTraceScope
+{
+	const char *	name;
+	int				counts[NUMTRACEFUNCS];
+	double			ms;
+};
+
+struct GlTraceScope		GlTraceScopes[MAXTRACESCOPES];		// this frame's
+struct GlTraceScope		GlTraceLast[MAXTRACESCOPES];		// the last whole frame's
+int						GlTraceNumScopes;
+int						GlTraceCurrent;						// the scope the calls are counted in
+std::chrono::steady_clock::time_point	GlTraceScopeStart;
+
+int			GlTraceFrameNumber;
+int			GlTraceDumpNext;				// != 0 means record the next frame
+FILE *		GlTraceStream;					// != NULL while a frame is being recorded
+
+extern int	DebugOn;
+
+
+// the number of values a glMaterialfv( ) or glLightfv( ) parameter has:
+
+int
+GlTraceValues( GLenum pname )
+{
+	switch( pname )
+	{
+		case GL_AMBIENT:
+		case GL_DIFFUSE:
+		case GL_SPECULAR:
+		case GL_EMISSION:
+		case GL_POSITION:
+		case GL_AMBIENT_AND_DIFFUSE:
+		case GL_FOG_COLOR:
+			return 4;
+		case GL_SPOT_DIRECTION:
+			return 3;
+		default:
+			return 1;
+	}
+}
+
+
+void
+GlTraceCall( int func )
+{
+	GlTraceScopes[GlTraceCurrent].counts[func]++;
+}
+
+
+// write one call to the frame being recorded:
+
+void
+GlTraceWrite( const char *format, ... )
+{
+	va_list args;
+	va_start( args, format );
+	vfprintf( GlTraceStream, format, args );
+	va_end( args );
+	fputc( '\n', GlTraceStream );
+}
+
+
+void
+GlTraceWriteValues( const char *func, GLenum target, GLenum pname, const GLfloat *v )
+{
+	fprintf( GlTraceStream, "%s( 0x%04x, 0x%04x, {", func, target, pname );
+	for( int i = 0; i < GlTraceValues( pname ); i++ )
+		fprintf( GlTraceStream, " %g", v[i] );
+	fprintf( GlTraceStream, " } )\n" );
+}
+
+
+// end the current scope's time and start counting in another:
+
+void
+GlTraceSetScope( const char *name )
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now( );
+	GlTraceScopes[GlTraceCurrent].ms += std::chrono::duration<double, std::milli>( now - GlTraceScopeStart ).count( );
+	GlTraceScopeStart = now;
+
+	int s;
+	for( s = 0; s < GlTraceNumScopes; s++ )
+	{
+		if( strcmp( GlTraceScopes[s].name, name ) == 0 )
+			break;
+	}
+	if( s == GlTraceNumScopes )
+	{
+		if( GlTraceNumScopes == MAXTRACESCOPES )
+			s = MAXTRACESCOPES - 1;			// (the extras all land in the last one)
+		else
+		{
+			GlTraceScopes[s].name = name;
+			GlTraceNumScopes++;
+		}
+	}
+	GlTraceCurrent = s;
+	if( GlTraceStream != NULL )
+		fprintf( GlTraceStream, "# %s\n", name );
+}
+
+
+// print a frame's counts, a row per scope:
+
+void
+GlTracePrint( FILE *fp, const struct GlTraceScope *scopes, int frame )
+{
+	int totals[NUMTRACEFUNCS] = { 0 };
+	double totalMs = 0.;
+	fprintf( fp, "GL calls in frame %d:\n", frame );
+	for( int s = 0; s < GlTraceNumScopes; s++ )
+	{
+		if( s == 0 )
+			fprintf( fp, "  %-16s            ", scopes[s].name );
+		else
+			fprintf( fp, "  %-16s %7.3f ms ", scopes[s].name, scopes[s].ms );
+		for( int f = 0; f < NUMTRACEFUNCS; f++ )
+		{
+			if( scopes[s].counts[f] != 0 )
+				fprintf( fp, " %s %d", GlTraceNames[f], scopes[s].counts[f] );
+			totals[f] += scopes[s].counts[f];
+		}
+		fprintf( fp, "\n" );
+		if( s != 0 )
+			totalMs += scopes[s].ms;
+	}
+	fprintf( fp, "  %-16s %7.3f ms ", "total", totalMs );
+	for( int f = 0; f < NUMTRACEFUNCS; f++ )
+	{
+		if( totals[f] != 0 )
+			fprintf( fp, " %s %d", GlTraceNames[f], totals[f] );
+	}
+	fprintf( fp, "\n" );
+}
+
+
+// the start of a frame -- finish up the last one and start counting this one:
+
+void
+GlTraceFrame( )
+{
+	if( GlTraceNumScopes == 0 )
+	{
+		GlTraceScopes[0].name = "(outside)";		// for calls outside any frame
+		GlTraceNumScopes = 1;
+	}
+	GlTraceSetScope( GlTraceScopes[0].name );
+
+	memcpy( GlTraceLast, GlTraceScopes, sizeof(GlTraceScopes) );
+	if( GlTraceStream != NULL )
+	{
+		GlTracePrint( GlTraceStream, GlTraceLast, GlTraceFrameNumber );
+		fclose( GlTraceStream );
+		GlTraceStream = NULL;
+		fprintf( stderr, "Wrote the calls of frame %d to gltrace_%05d.txt\n", GlTraceFrameNumber, GlTraceFrameNumber );
+	}
+	if( DebugOn != 0  &&  GlTraceFrameNumber > 0 )
+		GlTracePrint( stderr, GlTraceLast, GlTraceFrameNumber );
+
+	GlTraceFrameNumber++;
+	for( int s = 0; s < GlTraceNumScopes; s++ )
+	{
+		memset( GlTraceScopes[s].counts, 0, sizeof(GlTraceScopes[s].counts) );
+		GlTraceScopes[s].ms = 0.;
+	}
+
+	if( GlTraceDumpNext != 0 )
+	{
+		GlTraceDumpNext = 0;
+		char file[64];
+		snprintf( file, sizeof(file), "gltrace_%05d.txt", GlTraceFrameNumber );
+		GlTraceStream = fopen( file, "w" );
+		if( GlTraceStream == NULL )
+			fprintf( stderr, "Cannot write '%s'\n", file );
+	}
+}
+
+
+// the wrappers -- count, record, and pass the call on:
+
+inline void Trace_glCallList( GLuint list )
+{
+	GlTraceCall( TRACE_CALLLIST );
+	if( GlTraceStream != NULL )	GlTraceWrite( "glCallList( %u )", list );
+	glCallList( list );
+}
+
+inline void Trace_glPushMatrix( )
+{
+	GlTraceCall( TRACE_PUSHMATRIX );
+	if( GlTraceStream != NULL )	GlTraceWrite( "glPushMatrix( )" );
+	glPushMatrix( );
+}
+
+inline void Trace_glPopMatrix( )
+{
+	GlTraceCall( TRACE_POPMATRIX );
+	if( GlTraceStream != NULL )	GlTraceWrite( "glPopMatrix( )" );
+	glPopMatrix( );
+}
+
+inline void Trace_glTranslatef( GLfloat x, GLfloat y, GLfloat z )
+{
+	GlTraceCall( TRACE_TRANSFORM );
+	if( GlTraceStream != NULL )	GlTraceWrite( "glTranslatef( %g, %g, %g )", x, y, z );
+	glTranslatef( x, y, z );
+}
+
+inline void Trace_glRotatef( GLfloat a, GLfloat x, GLfloat y, GLfloat z )
+{
+	GlTraceCall( TRACE_TRANSFORM );
+	if( GlTraceStream != NULL )	GlTraceWrite( "glRotatef( %g, %g, %g, %g )", a, x, y, z );
+	glRotatef( a, x, y, z );
+}
+
+inline void Trace_glScalef( GLfloat x, GLfloat y, GLfloat z )
+{
+	GlTraceCall( TRACE_TRANSFORM );
+	if( GlTraceStream != NULL )	GlTraceWrite( "glScalef( %g, %g, %g )", x, y, z );
+	glScalef( x, y, z );
+}
+
+inline void Trace_glEnable( GLenum cap )
+{
+	GlTraceCall( TRACE_ENABLE );
+	if( GlTraceStream != NULL )	GlTraceWrite( "glEnable( 0x%04x )", cap );
+	glEnable( cap );
+}
+
+inline void Trace_glDisable( GLenum cap )
+{
+	GlTraceCall( TRACE_DISABLE );
+	if( GlTraceStream != NULL )	GlTraceWrite( "glDisable( 0x%04x )", cap );
+	glDisable( cap );
+}
+
+inline void Trace_glMaterialf( GLenum face, GLenum pname, GLfloat param )
+{
+	GlTraceCall( TRACE_MATERIAL );
+	if( GlTraceStream != NULL )	GlTraceWrite( "glMaterialf( 0x%04x, 0x%04x, %g )", face, pname, param );
+	glMaterialf( face, pname, param );
+}
+
+inline void Trace_glMaterialfv( GLenum face, GLenum pname, const GLfloat *params )
+{
+	GlTraceCall( TRACE_MATERIAL );
+	if( GlTraceStream != NULL )	GlTraceWriteValues( "glMaterialfv", face, pname, params );
+	glMaterialfv( face, pname, params );
+}
+
+inline void Trace_glLightf( GLenum light, GLenum pname, GLfloat param )
+{
+	GlTraceCall( TRACE_LIGHT );
+	if( GlTraceStream != NULL )	GlTraceWrite( "glLightf( 0x%04x, 0x%04x, %g )", light, pname, param );
+	glLightf( light, pname, param );
+}
+
+inline void Trace_glLightfv( GLenum light, GLenum pname, const GLfloat *params )
+{
+	GlTraceCall( TRACE_LIGHT );
+	if( GlTraceStream != NULL )	GlTraceWriteValues( "glLightfv", light, pname, params );
+	glLightfv( light, pname, params );
+}
+
+inline void Trace_glBindTexture( GLenum target, GLuint texture )
+{
+	GlTraceCall( TRACE_BINDTEXTURE );
+	if( GlTraceStream != NULL )	GlTraceWrite( "glBindTexture( 0x%04x, %u )", target, texture );
+	glBindTexture( target, texture );
+}
+
+inline void Trace_glTexEnvf( GLenum target, GLenum pname, GLfloat param )
+{
+	GlTraceCall( TRACE_TEXENV );
+	if( GlTraceStream != NULL )	GlTraceWrite( "glTexEnvf( 0x%04x, 0x%04x, %g )", target, pname, param );
+	glTexEnvf( target, pname, param );
+}
+
+inline void Trace_glShadeModel( GLenum mode )
+{
+	GlTraceCall( TRACE_SHADEMODEL );
+	if( GlTraceStream != NULL )	GlTraceWrite( "glShadeModel( 0x%04x )", mode );
+	glShadeModel( mode );
+}
+
+inline void Trace_glFogf( GLenum pname, GLfloat param )
+{
+	GlTraceCall( TRACE_FOG );
+	if( GlTraceStream != NULL )	GlTraceWrite( "glFogf( 0x%04x, %g )", pname, param );
+	glFogf( pname, param );
+}
+
+inline void Trace_glFogi( GLenum pname, GLint param )
+{
+	GlTraceCall( TRACE_FOG );
+	if( GlTraceStream != NULL )	GlTraceWrite( "glFogi( 0x%04x, %d )", pname, param );
+	glFogi( pname, param );
+}
+
+inline void Trace_glFogfv( GLenum pname, const GLfloat *params )
+{
+	GlTraceCall( TRACE_FOG );
+	if( GlTraceStream != NULL )	GlTraceWriteValues( "glFogfv", 0, pname, params );
+	glFogfv( pname, params );
+}
+
+inline void Trace_glColor3f( GLfloat r, GLfloat g, GLfloat b )
+{
+	GlTraceCall( TRACE_COLOR );
+	if( GlTraceStream != NULL )	GlTraceWrite( "glColor3f( %g, %g, %g )", r, g, b );
+	glColor3f( r, g, b );
+}
+
+inline void Trace_glBegin( GLenum mode )
+{
+	GlTraceCall( TRACE_BEGIN );
+	if( GlTraceStream != NULL )	GlTraceWrite( "glBegin( 0x%04x )", mode );
+	glBegin( mode );
+}
+
+inline void Trace_glDrawArrays( GLenum mode, GLint first, GLsizei count )
+{
+	GlTraceCall( TRACE_DRAWARRAYS );
+	if( GlTraceStream != NULL )	GlTraceWrite( "glDrawArrays( 0x%04x, %d, %d )", mode, first, count );
+	glDrawArrays( mode, first, count );
+}
+
+inline void Trace_glDrawElements( GLenum mode, GLsizei count, GLenum type, const void *indices )
+{
+	GlTraceCall( TRACE_DRAWELEMENTS );
+	if( GlTraceStream != NULL )	GlTraceWrite( "glDrawElements( 0x%04x, %d, 0x%04x, %p )", mode, count, type, indices );
+	glDrawElements( mode, count, type, indices );
+}
+
+// (glew makes this one a macro of its own, which the wrapper uses before it is replaced)
+
+inline void Trace_glDrawElementsInstanced( GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei n )
+{
+	GlTraceCall( TRACE_DRAWINSTANCED );
+	if( GlTraceStream != NULL )	GlTraceWrite( "glDrawElementsInstanced( 0x%04x, %d, 0x%04x, %p, %d )", mode, count, type, indices, n );
+	glDrawElementsInstanced( mode, count, type, indices, n );
+}
+
+#undef glDrawElementsInstanced
+
+#define glCallList( l )				Trace_glCallList( l )
+#define glPushMatrix( )				Trace_glPushMatrix( )
+#define glPopMatrix( )				Trace_glPopMatrix( )
+#define glTranslatef( x, y, z )		Trace_glTranslatef( x, y, z )
+#define glRotatef( a, x, y, z )		Trace_glRotatef( a, x, y, z )
+#define glScalef( x, y, z )			Trace_glScalef( x, y, z )
+#define glEnable( c )				Trace_glEnable( c )
+#define glDisable( c )				Trace_glDisable( c )
+#define glMaterialf( f, p, v )		Trace_glMaterialf( f, p, v )
+#define glMaterialfv( f, p, v )		Trace_glMaterialfv( f, p, v )
+#define glLightf( l, p, v )			Trace_glLightf( l, p, v )
+#define glLightfv( l, p, v )		Trace_glLightfv( l, p, v )
+#define glBindTexture( t, n )		Trace_glBindTexture( t, n )
+#define glTexEnvf( t, p, v )		Trace_glTexEnvf( t, p, v )
+#define glShadeModel( m )			Trace_glShadeModel( m )
+#define glFogf( p, v )				Trace_glFogf( p, v )
+#define glFogi( p, v )				Trace_glFogi( p, v )
+#define glFogfv( p, v )				Trace_glFogfv( p, v )
+#define glColor3f( r, g, b )		Trace_glColor3f( r, g, b )
+#define glBegin( m )				Trace_glBegin( m )
+#define glDrawArrays( m, f, c )		Trace_glDrawArrays( m, f, c )
+#define glDrawElements( m, c, t, i )	Trace_glDrawElements( m, c, t, i )
+#define glDrawElementsInstanced( m, c, t, i, n )	Trace_glDrawElementsInstanced( m, c, t, i, n )
+
+#define GLTRACE_SCOPE( name )		GlTraceSetScope( name )
+#define GLTRACE_FRAME( )			GlTraceFrame( )
+#define GLTRACE_END( )				GlTraceSetScope( GlTraceScopes[0].name )
+
+#else
+
+#define GLTRACE_SCOPE( name )
+#define GLTRACE_FRAME( )
+#define GLTRACE_END( )
+
+#endif
@@ -0,0 +1,373 @@
+// the grid walls, stored once in buffer objects and drawn with instancing:
+//
+//	the grid used to be a display list of GL_QUAD_STRIPs that was called once
+//	per wall, which pushed about 10M vertices per frame for five flat planes
+//
+//	now the grid vertices and indices live in buffer objects, and all five walls
+//	are drawn with a single glDrawElementsInstanced( ) -- each wall gets its model
+//	transform from a per-instance attribute instead of a push/translate/rotate/pop
+//
+//	the instance transform means the fixed-function pipeline can't draw it, so the
+//	walls use a small shader built on the fixed-function lighting and fog in
+//	ffshader.cpp (they pick up the same lights, material, and fog the rest of the
+//	scene uses)
+//
+//	the walls are culled one by one: a wall outside the view frustum is left out of
+//	the instance buffer -- and every wall still in the frustum gets an occlusion query
+//	each frame, by drawing its plane with color and depth writes off before any of the
+//	walls are drawn (so it is only tested against the bottom plate and the objects,
+//	never against its own depth)
+//
+//	a wall whose last query came back with no samples passing (usually the bottom wall
+//	hiding under the table) is left out of the instanced draw, and drawn on its own
+//	under conditional rendering on this frame's query instead -- so the gpu skips it if
+//	it is still hidden, and draws it if it isn't (or if the answer isn't in yet): a
+//	visible wall is never culled
+
+
+// how many grid points there are in x and how many strips there are in z:
+// (this used to be the NX and NZ #defines)
+
+int				GridRes = 1000;
+
+GLuint			GridProgram;			// the shader that draws the walls
+GLuint			GridVertexBuffer;		// (x,z) of each grid point
+GLuint			GridIndexBuffer;		// one long triangle strip
+GLuint			GridInstanceBuffer;		// one 4x4 model matrix per wall
+int				GridNumIndices;
+GLint			GridLightOnLoc;
+GLint			GridFogOnLoc;
+struct BoundingBox	GridBox;				// one wall, in its own coordinates
+
+// the walls, in the order the instance buffer holds them:
+
+enum GridWalls
+{
+	LEFTWALL,
+	RIGHTWALL,
+	FRONTWALL,
+	BACKWALL,
+	BOTTOMWALL,
+	NUMGRIDWALLS
+};
+
+// attribute locations for the 4 columns of the instance matrix:
+// (stay away from 0, which some drivers alias to gl_Vertex)
+
+const GLuint	GRIDINSTANCELOC = 1;
+
+GLfloat			GridWallMatrix[NUMGRIDWALLS][16];	// where each wall goes
+GLuint			GridQueries[NUMGRIDWALLS];			// occlusion query for each wall
+int				GridQueryIssued[NUMGRIDWALLS];		// != 0 means there is a result coming
+int				GridOccluded[NUMGRIDWALLS];			// != 0 means the last result said hidden
+
+
+// the vertex shader's main( ) -- the lighting and fog come from ffshader.cpp:
+
+const char *GridVertexShader =
+	"attribute vec4 aInstance0;\n"
+	"attribute vec4 aInstance1;\n"
+	"attribute vec4 aInstance2;\n"
+	"attribute vec4 aInstance3;\n"
+	"void main( )\n"
+	"{\n"
+	"	mat4 inst = mat4( aInstance0, aInstance1, aInstance2, aInstance3 );\n"
+	"	vec4 eye = gl_ModelViewMatrix * ( inst * vec4( gl_Vertex.x, 0., gl_Vertex.y, 1. ) );\n"
+	"	vec3 n = normalize( gl_NormalMatrix * ( mat3( inst[0].xyz, inst[1].xyz, inst[2].xyz ) * gl_Normal ) );\n"
+	"	gl_FrontColor = FixedLighting( eye.xyz, n );\n"
+	"	vFogCoord = abs( eye.z );\n"
+	"	gl_Position = gl_ProjectionMatrix * eye;\n"
+	"}\n";
+
+
+// compile and link the grid program, binding the instance matrix columns first:
+
+GLuint
+MakeGridProgram( )
+{
+	const char *attributes[4] = { "aInstance0", "aInstance1", "aInstance2", "aInstance3" };
+	return MakeFixedFunctionProgram( "Grid", GridVertexShader, attributes, 4, GRIDINSTANCELOC );
+}
+
+
+// (re)build the grid vertex and index buffers at a given resolution:
+//
+//	there are res points across x and res+1 rows down z, the same points the old
+//	quad strips used -- the rows are stitched into one strip by repeating the last
+//	index of a row and the first index of the next (the degenerate triangles in
+//	between never rasterize)
+
+void
+BuildGrid( int res )
+{
+	if( res < 2 )
+		res = 2;
+	GridRes = res;
+
+	float dx = XSIDE / (float)res;
+	float dz = ZSIDE / (float)res;
+
+	InitBox( &GridBox );
+	ExpandBox( &GridBox, X0, 0., Z0 );
+	ExpandBox( &GridBox, X0 + dx * (float)(res-1), 0., Z0 + ZSIDE );
+
+	int nverts = res * ( res + 1 );
+	float *xz = new float[ 2*nverts ];
+	float *p = xz;
+	for( int i = 0; i <= res; i++ )
+	{
+		for( int j = 0; j < res; j++ )
+		{
+			*p++ = X0 + dx * (float)j;
+			*p++ = Z0 + dz * (float)i;
+		}
+	}
+
+	GridNumIndices = res * 2*res  +  ( res - 1 ) * 2;
+	GLuint *indices = new GLuint[ GridNumIndices ];
+	GLuint *q = indices;
+	for( int i = 0; i < res; i++ )
+	{
+		if( i > 0 )
+		{
+			GLuint last = q[-1];
+			*q++ = last;							// repeat the end of the last row
+			*q++ = (GLuint)( (i+0)*res );			// repeat the start of this row
+		}
+		for( int j = 0; j < res; j++ )
+		{
+			*q++ = (GLuint)( (i+0)*res + j );
+			*q++ = (GLuint)( (i+1)*res + j );
+		}
+	}
+
+	glBindBuffer( GL_ARRAY_BUFFER, GridVertexBuffer );
+	glBufferData( GL_ARRAY_BUFFER, 2*nverts*sizeof(float), xz, GL_STATIC_DRAW );
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, GridIndexBuffer );
+	glBufferData( GL_ELEMENT_ARRAY_BUFFER, GridNumIndices*sizeof(GLuint), indices, GL_STATIC_DRAW );
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+
+	delete [ ] xz;
+	delete [ ] indices;
+
+	if( DebugOn != 0 )
+		fprintf( stderr, "Grid: %d x %d, %d vertices, %d indices\n", res, res+1, nverts, GridNumIndices );
+}
+
+
+// create the grid program and buffers, and the per-wall transforms:
+
+void
+InitGrid( )
+{
+	GridProgram = MakeGridProgram( );
+	GridLightOnLoc = glGetUniformLocation( GridProgram, "uLightOn" );
+	GridFogOnLoc   = glGetUniformLocation( GridProgram, "uFogOn" );
+
+	glGenBuffers( 1, &GridVertexBuffer );
+	glGenBuffers( 1, &GridIndexBuffer );
+	glGenBuffers( 1, &GridInstanceBuffer );
+
+	glGenQueries( NUMGRIDWALLS, GridQueries );
+
+	// let opengl compose the wall transforms exactly as the old push/translate/rotate blocks did:
+
+	GLfloat (*walls)[16] = GridWallMatrix;
+	glMatrixMode( GL_MODELVIEW );
+	glPushMatrix( );
+		glLoadIdentity( );
+		glTranslatef( -XSIDE / 2 + 5, 0, 0 );
+		glRotatef( 90, 0, 0, 1 );
+		glGetFloatv( GL_MODELVIEW_MATRIX, walls[LEFTWALL] );
+
+		glLoadIdentity( );
+		glTranslatef( XSIDE / 2 - 5, 0, 0 );
+		glRotatef( 90, 0, 0, 1 );
+		glGetFloatv( GL_MODELVIEW_MATRIX, walls[RIGHTWALL] );
+
+		glLoadIdentity( );
+		glTranslatef( 0, 0, -ZSIDE / 2 );
+		glRotatef( 90, 1, 0, 0 );
+		glGetFloatv( GL_MODELVIEW_MATRIX, walls[FRONTWALL] );
+
+		glLoadIdentity( );
+		glTranslatef( 0, 0, ZSIDE / 2 );
+		glRotatef( 90, 1, 0, 0 );
+		glGetFloatv( GL_MODELVIEW_MATRIX, walls[BACKWALL] );
+
+		glLoadIdentity( );
+		glTranslatef( 0, -1, 0 );
+		glGetFloatv( GL_MODELVIEW_MATRIX, walls[BOTTOMWALL] );
+	glPopMatrix( );
+
+	glBindBuffer( GL_ARRAY_BUFFER, GridInstanceBuffer );
+	glBufferData( GL_ARRAY_BUFFER, sizeof(GridWallMatrix), GridWallMatrix, GL_DYNAMIC_DRAW );
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+	BuildGrid( GridRes );
+}
+
+
+// draw n walls from the instance buffer, starting at the first'th:
+
+void
+DrawGridInstances( int first, int n )
+{
+	glUseProgram( GridProgram );
+	SetFixedFunctionUniforms( GridLightOnLoc, GridFogOnLoc );
+
+	glBindBuffer( GL_ARRAY_BUFFER, GridVertexBuffer );
+	glEnableClientState( GL_VERTEX_ARRAY );
+	glVertexPointer( 2, GL_FLOAT, 0, (void *)0 );
+
+	glBindBuffer( GL_ARRAY_BUFFER, GridInstanceBuffer );
+	for( GLuint c = 0; c < 4; c++ )
+	{
+		glEnableVertexAttribArray( GRIDINSTANCELOC + c );
+		glVertexAttribPointer( GRIDINSTANCELOC + c, 4, GL_FLOAT, GL_FALSE, 16*sizeof(GLfloat),
+			(void *)( ( 16*first + 4*c ) * sizeof(GLfloat) ) );
+		glVertexAttribDivisor( GRIDINSTANCELOC + c, 1 );
+	}
+
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, GridIndexBuffer );
+	glDrawElementsInstanced( GL_TRIANGLE_STRIP, GridNumIndices, GL_UNSIGNED_INT, (void *)0, n );
+	CountDraw( (long long)GridNumIndices * n );
+
+	for( GLuint c = 0; c < 4; c++ )
+	{
+		glVertexAttribDivisor( GRIDINSTANCELOC + c, 0 );
+		glDisableVertexAttribArray( GRIDINSTANCELOC + c );
+	}
+	glDisableClientState( GL_VERTEX_ARRAY );
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+	glUseProgram( 0 );
+}
+
+
+// draw the quad that a wall covers, for its occlusion query:
+
+void
+DrawGridProxy( int wall )
+{
+	glPushMatrix( );
+		glMultMatrixf( GridWallMatrix[wall] );
+		glBegin( GL_QUADS );
+			glVertex3f( GridBox.xmin, 0., GridBox.zmin );
+			glVertex3f( GridBox.xmax, 0., GridBox.zmin );
+			glVertex3f( GridBox.xmax, 0., GridBox.zmax );
+			glVertex3f( GridBox.xmin, 0., GridBox.zmax );
+		glEnd( );
+	glPopMatrix( );
+	CountDraw( 4 );
+}
+
+
+// draw all five walls, minus the ones that can't be seen:
+// (the caller's modelview, lights, and fog are used as-is)
+
+void
+DrawGrid( )
+{
+	GLfloat modelview[16];
+	glGetFloatv( GL_MODELVIEW_MATRIX, modelview );
+
+	// decide which walls are in the frustum, and which were hidden the last time they were asked about:
+
+	int inFrustum[NUMGRIDWALLS];
+	for( int w = 0; w < NUMGRIDWALLS; w++ )
+	{
+		CullCounts.tested++;
+		inFrustum[w] = 1;
+		if( CullingOn == 0 )
+		{
+			GridOccluded[w] = 0;
+			continue;
+		}
+
+		GLfloat m[16];
+		MulMatrix( modelview, GridWallMatrix[w], m );
+		inFrustum[w] = BoxInFrustum( &GridBox, m );
+		if( ! inFrustum[w] )
+		{
+			GridOccluded[w] = 0;		// test it fresh when it comes back into view
+			CullCounts.frustumCulled++;
+			continue;
+		}
+
+		if( GridQueryIssued[w] != 0 )
+		{
+			GLuint available = 0;
+			glGetQueryObjectuiv( GridQueries[w], GL_QUERY_RESULT_AVAILABLE, &available );
+			if( available != 0 )
+			{
+				GLuint samples = 0;
+				glGetQueryObjectuiv( GridQueries[w], GL_QUERY_RESULT, &samples );
+				GridOccluded[w] = ( samples == 0 );
+				GridQueryIssued[w] = 0;
+			}
+			else
+			{
+				GridOccluded[w] = 0;	// (no query of this frame's to render it conditionally on)
+			}
+		}
+	}
+
+	// query every wall in the frustum against the plate and the objects, before any wall is drawn:
+	// (a query whose last result hasn't come back yet is left alone)
+
+	if( CullingOn != 0 )
+	{
+		glColorMask( GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE );
+		glDepthMask( GL_FALSE );
+		for( int w = 0; w < NUMGRIDWALLS; w++ )
+		{
+			if( inFrustum[w] == 0  ||  GridQueryIssued[w] != 0 )
+				continue;
+			glBeginQuery( GL_SAMPLES_PASSED, GridQueries[w] );
+			DrawGridProxy( w );
+			glEndQuery( GL_SAMPLES_PASSED );
+			GridQueryIssued[w] = 1;
+		}
+		glDepthMask( GL_TRUE );
+		glColorMask( GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE );
+	}
+
+	// the instance buffer: the walls drawn together first, then the ones drawn conditionally:
+
+	int order[NUMGRIDWALLS];
+	int numDrawn = 0;
+	for( int w = 0; w < NUMGRIDWALLS; w++ )
+	{
+		if( inFrustum[w] != 0  &&  GridOccluded[w] == 0 )
+			order[numDrawn++] = w;
+	}
+	int numVisible = numDrawn;
+	for( int w = 0; w < NUMGRIDWALLS; w++ )
+	{
+		if( inFrustum[w] != 0  &&  GridOccluded[w] != 0 )
+			order[numVisible++] = w;
+	}
+	glBindBuffer( GL_ARRAY_BUFFER, GridInstanceBuffer );
+	for( int i = 0; i < numVisible; i++ )
+		glBufferSubData( GL_ARRAY_BUFFER, i*sizeof(GridWallMatrix[0]), sizeof(GridWallMatrix[0]), GridWallMatrix[ order[i] ] );
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+	CullCounts.drawn += numDrawn;
+	CullCounts.conditional += numVisible - numDrawn;
+
+	// the walls' material and normal:
+
+	SetMaterial( 0.5f, 0.5f, 0.6f, 30.f );
+	glNormal3f( 0., 1., 0. );
+
+	if( numDrawn > 0 )
+		DrawGridInstances( 0, numDrawn );
+	for( int i = numDrawn; i < numVisible; i++ )
+	{
+		glBeginConditionalRender( GridQueries[ order[i] ], GL_QUERY_NO_WAIT );
+		DrawGridInstances( i, 1 );
+		glEndConditionalRender( );
+	}
+}
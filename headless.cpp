@@ -0,0 +1,264 @@
+// headless mode -- drawing the table with no window, for machines with no display or gpu:
+//
+//	"finalproj -headless [-frames n] [-fps f] [-size w h] [-dump prefix]"
+//
+//	makes an offscreen opengl context instead of a glut window -- with egl on a
+//	surfaceless display (mesa's llvmpipe works with no x server and no gpu), or with
+//	osmesa if this was compiled with HEADLESS_OSMESA -- and draws into a framebuffer
+//	object of the given size (INIT_WINDOW_SIZE square by default)
+//
+//	the frames are drawn by the same InitLists( ) and Display( ) as the window, but at
+//	a fixed timestep instead of the clock: frame i is drawn at i * 1000/fps ms, and the
+//	default is one MS_PER_CYCLE loop at 60 fps -- so two runs always draw the same frames
+//
+//	with -dump, each frame is also written to <prefix>NNNNN.ppm
+//
+//	(on linux this needs -lEGL, or -lOSMesa with HEADLESS_OSMESA, when linking)
+
+#include <chrono>
+
+#ifdef HEADLESS_OSMESA
+#include <GL/osmesa.h>
+#elif !defined(WIN32) && !defined(__APPLE__)
+#define HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+
+int			HeadlessOn = 0;				// != 0 means there is no window, just the framebuffer object
+int			HeadlessWidth  = INIT_WINDOW_SIZE;
+int			HeadlessHeight = INIT_WINDOW_SIZE;
+int			HeadlessFrames = 0;			// 0 means one animation cycle
+float		HeadlessFps = 60.f;
+char *		HeadlessDump = NULL;		// the frame file prefix, NULL means don't write them
+GLuint		HeadlessFramebuffer;
+
+double		SceneTimeMs = -1.;			// >= 0. means Display( ) draws this time instead of the clock's
+
+#ifdef HEADLESS_OSMESA
+OSMesaContext		HeadlessContext;
+unsigned char *		HeadlessPixels;		// osmesa's own color buffer (the fbo is drawn into, not this)
+#endif
+
+
+// the time Display( ) should draw, in milliseconds since the start (it doesn't wrap around):
+
+double
+SceneClockMs( )
+{
+	if( SceneTimeMs >= 0. )
+		return SceneTimeMs;
+	return (double)glutGet( GLUT_ELAPSED_TIME );
+}
+
+
+// the same, in seconds into the animation cycle:
+
+float
+SceneTime( )
+{
+	return (float)( fmod( SceneClockMs( ), (double)MS_PER_CYCLE ) / 1000. );
+}
+
+
+// the size of what Display( ) draws into:
+
+void
+SceneSize( GLsizei *width, GLsizei *height )
+{
+	if( HeadlessOn != 0 )
+	{
+		*width = HeadlessWidth;
+		*height = HeadlessHeight;
+		return;
+	}
+	*width = glutGet( GLUT_WINDOW_WIDTH );
+	*height = glutGet( GLUT_WINDOW_HEIGHT );
+}
+
+
+// pick the headless options out of the command line:
+// (returns != 0 if -headless was there)
+
+int
+ParseHeadlessArgs( int argc, char *argv[ ] )
+{
+	for( int i = 1; i < argc; i++ )
+	{
+		if( strcmp( argv[i], "-headless" ) == 0 )
+			HeadlessOn = 1;
+		else if( strcmp( argv[i], "-frames" ) == 0  &&  i+1 < argc )
+			HeadlessFrames = atoi( argv[++i] );
+		else if( strcmp( argv[i], "-fps" ) == 0  &&  i+1 < argc )
+			HeadlessFps = (float)atof( argv[++i] );
+		else if( strcmp( argv[i], "-size" ) == 0  &&  i+2 < argc )
+		{
+			HeadlessWidth  = atoi( argv[++i] );
+			HeadlessHeight = atoi( argv[++i] );
+		}
+		else if( strcmp( argv[i], "-dump" ) == 0  &&  i+1 < argc )
+			HeadlessDump = argv[++i];
+	}
+	if( HeadlessFps <= 0. )
+		HeadlessFps = 60.f;
+	if( HeadlessWidth < 1  ||  HeadlessHeight < 1 )
+		HeadlessWidth = HeadlessHeight = INIT_WINDOW_SIZE;
+	return HeadlessOn;
+}
+
+
+// make an offscreen context current, in place of glutCreateWindow( ):
+// (returns false if there isn't one to be had)
+
+bool
+CreateHeadlessContext( )
+{
+#if defined(HEADLESS_OSMESA)
+	HeadlessContext = OSMesaCreateContextExt( OSMESA_RGBA, 24, 8, 0, NULL );
+	if( HeadlessContext == NULL )
+	{
+		fprintf( stderr, "Headless: cannot create an OSMesa context\n" );
+		return false;
+	}
+	HeadlessPixels = new unsigned char[ 4 * HeadlessWidth * HeadlessHeight ];
+	if( ! OSMesaMakeCurrent( HeadlessContext, HeadlessPixels, GL_UNSIGNED_BYTE, HeadlessWidth, HeadlessHeight ) )
+	{
+		fprintf( stderr, "Headless: cannot make the OSMesa context current\n" );
+		return false;
+	}
+#elif defined(HEADLESS_EGL)
+	// a surfaceless display if mesa has one (no x server needed), else the default one:
+
+	EGLDisplay display = EGL_NO_DISPLAY;
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress( "eglGetPlatformDisplayEXT" );
+	if( getPlatformDisplay != NULL )
+		display = getPlatformDisplay( EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL );
+	if( display == EGL_NO_DISPLAY )
+		display = eglGetDisplay( EGL_DEFAULT_DISPLAY );
+
+	EGLint major, minor;
+	if( display == EGL_NO_DISPLAY  ||  ! eglInitialize( display, &major, &minor ) )
+	{
+		fprintf( stderr, "Headless: cannot initialize EGL\n" );
+		return false;
+	}
+	eglBindAPI( EGL_OPENGL_API );
+
+	// (there is no surface -- everything is drawn into the framebuffer object)
+
+	const EGLint configAttribs[ ] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+	EGLConfig config = NULL;
+	EGLint numConfigs = 0;
+	eglChooseConfig( display, configAttribs, &config, 1, &numConfigs );
+	EGLContext context = eglCreateContext( display, numConfigs > 0 ? config : (EGLConfig)NULL, EGL_NO_CONTEXT, NULL );
+	if( context == EGL_NO_CONTEXT  ||  ! eglMakeCurrent( display, EGL_NO_SURFACE, EGL_NO_SURFACE, context ) )
+	{
+		fprintf( stderr, "Headless: cannot make a surfaceless EGL %d.%d context\n", major, minor );
+		return false;
+	}
+#else
+	fprintf( stderr, "Headless: this build has no offscreen context (compile with EGL or HEADLESS_OSMESA)\n" );
+	return false;
+#endif
+	return true;
+}
+
+
+// the framebuffer object that takes the place of the window's back buffer:
+// (the gl functions have to be loaded first)
+
+bool
+CreateHeadlessFramebuffer( )
+{
+	GLuint renderbuffers[2];
+	glGenRenderbuffers( 2, renderbuffers );
+	glBindRenderbuffer( GL_RENDERBUFFER, renderbuffers[0] );
+	glRenderbufferStorage( GL_RENDERBUFFER, GL_RGBA8, HeadlessWidth, HeadlessHeight );
+	glBindRenderbuffer( GL_RENDERBUFFER, renderbuffers[1] );
+	glRenderbufferStorage( GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, HeadlessWidth, HeadlessHeight );
+	glBindRenderbuffer( GL_RENDERBUFFER, 0 );
+
+	glGenFramebuffers( 1, &HeadlessFramebuffer );
+	glBindFramebuffer( GL_FRAMEBUFFER, HeadlessFramebuffer );
+	glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0] );
+	glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1] );
+	if( glCheckFramebufferStatus( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
+	{
+		fprintf( stderr, "Headless: the %d x %d framebuffer is not complete\n", HeadlessWidth, HeadlessHeight );
+		return false;
+	}
+
+	fprintf( stderr, "Headless: %s, %s, %d x %d\n", (const char *)glGetString( GL_RENDERER ),
+		(const char *)glGetString( GL_VERSION ), HeadlessWidth, HeadlessHeight );
+	return true;
+}
+
+
+// write the framebuffer to a binary ppm file, top row first:
+
+bool
+WriteFramePpm( const char *file )
+{
+	std::vector<unsigned char> pixels( 3 * HeadlessWidth * HeadlessHeight );
+	glPixelStorei( GL_PACK_ALIGNMENT, 1 );
+	glReadPixels( 0, 0, HeadlessWidth, HeadlessHeight, GL_RGB, GL_UNSIGNED_BYTE, &pixels[0] );
+
+	FILE *fp = fopen( file, "wb" );
+	if( fp == NULL )
+	{
+		fprintf( stderr, "Cannot write frame '%s'\n", file );
+		return false;
+	}
+	fprintf( fp, "P6\n%d %d\n255\n", HeadlessWidth, HeadlessHeight );
+	for( int y = HeadlessHeight - 1; y >= 0; y-- )
+		fwrite( &pixels[ 3 * y * HeadlessWidth ], 1, 3 * HeadlessWidth, fp );
+	bool ok = ( ferror( fp ) == 0 );
+	fclose( fp );
+	return ok;
+}
+
+
+// draw (and maybe dump) the frames at the fixed timestep:
+// (returns 0 if it all worked, so main( ) can exit with it)
+
+int
+RunHeadless( )
+{
+	int frames = HeadlessFrames;
+	if( frames <= 0 )
+		frames = (int)ceilf( (float)MS_PER_CYCLE * HeadlessFps / 1000.f );
+	double stepMs = 1000. / (double)HeadlessFps;
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now( );
+	int status = 0;
+	for( int i = 0; i < frames; i++ )
+	{
+		SceneTimeMs = (double)i * stepMs;
+		Display( );
+		if( HeadlessDump != NULL )
+		{
+			char file[1024];
+			snprintf( file, sizeof(file), "%s%05d.ppm", HeadlessDump, i );
+			if( ! WriteFramePpm( file ) )
+			{
+				status = 1;
+				break;
+			}
+		}
+	}
+	glFinish( );
+
+	GLenum err = glGetError( );
+	if( err != GL_NO_ERROR )
+	{
+		fprintf( stderr, "Headless: GL error 0x%x\n", err );
+		status = 1;
+	}
+
+	double ms = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now( ) - start ).count( );
+	fprintf( stderr, "Headless: drew %d frames at %.3f ms steps in %.1f ms (%.2f ms a frame)%s%s\n",
+		frames, stepMs, ms, ms / frames, HeadlessDump != NULL ? ", wrote " : "", HeadlessDump != NULL ? HeadlessDump : "" );
+	return status;
+}
@@ -0,0 +1,345 @@
+// the performance hud -- what the frame is costing, drawn over the scene ('h' or the menu):
+//
+//	a few lines of text (fps, the cpu and gpu time of a frame, draw calls, vertices,
+//	culled objects, texture memory, and what the hud itself costs) over a graph of the
+//	last HUDHISTORY frames' cpu (yellow) and gpu (cyan) times, with a line at the
+//	target frame time
+//
+//	the times come from frametiming.cpp, which the hud turns on -- they are a few
+//	frames old, since the gpu queries aren't waited for (a frame whose queries still
+//	aren't back has no gpu time, and is left out of the gpu average and line)
+//
+//	the "hud" it shows is its own drawing plus that timing's cpu cost, since the timing
+//	is only on for it -- to stay well under 0.1 ms a frame, the hud is never more than
+//	a few gl calls:
+//
+//		glut's bitmap characters are a glBitmap( ) apiece, which many drivers do very
+//		slowly -- so they are drawn just once, the first time the hud is shown, into a
+//		texture (HUDFONTCOLUMNS x HUDFONTROWS cells of HUDFONTCELL pixels), and the
+//		text is one array of textured quads out of that
+//
+//		the quads are only rebuilt every HUDTEXTMS, so the numbers can be read -- and
+//		then they are put in HudBuffer, a vertex buffer, where they stay
+//
+//		the graph is one glBufferSubData( ) into the front of HudBuffer a frame, and two
+//		draws out of it -- the background, and all of its lines at once (the target
+//		line and each frame's cpu and gpu segments, with their colors in the vertices)
+//
+//	it is drawn with the rest of the fixed-screen overlay, in Display( )'s percent units
+
+#include <chrono>
+
+
+const int	HUDHISTORY = 120;			// frames in the graph
+const int	HUDTEXTMS = 250;			// how often the text is rebuilt
+const float	HUDGRAPHMS = 33.3f;			// the time at the top of the graph
+
+const int	HUDFONTCELL = 16;			// pixels, with room for glut's 12-point helvetica
+const int	HUDFONTCOLUMNS = 16;
+const int	HUDFONTROWS = 6;			// the 96 printable ascii characters
+const int	HUDFONTBASELINE = 4;		// pixels up from the bottom of a cell
+const int	HUDMAXCHARS = 256;			// on the screen at once
+
+// HudBuffer's layout -- the graph's vertices (4 for the background, then the lines'), and
+// then the text's corners:
+
+const int	HUDGRAPHVERTICES = 4 + 2 + 2*2*( HUDHISTORY - 1 );
+
+// where it goes, in percent units:
+
+const float	HUDLEFT = 2.f;
+const float	HUDTOP = 97.f;
+const float	HUDLINE = 3.5f;				// the text line spacing
+const float	HUDGRAPHWIDTH = 40.f;
+const float	HUDGRAPHHEIGHT = 15.f;
+
+int			HudOn = 0;					// != 0 means the hud is drawn
+
+GLuint		HudFontTex;
+int			HudFontAdvance[96];			// in pixels
+struct HudVertex
+{
+	GLfloat		x, y;
+	GLubyte		color[4];
+};
+
+GLfloat		HudTextQuads[4*4*HUDMAXCHARS];	// x, y, s, t for each corner
+int			HudTextVertices;
+GLuint		HudBuffer;
+const size_t	HUDTEXTOFFSET = HUDGRAPHVERTICES * sizeof(struct HudVertex);
+
+std::chrono::steady_clock::time_point	HudTextTime;
+int			HudFrames;					// frames drawn since the text was rebuilt
+double		HudMs;						// what the hud cost, over the same frames
+double		HudLastMs;
+struct HudVertex	HudGraph[HUDGRAPHVERTICES];
+int			HudGraphVertices;
+
+
+void
+SetHud( int on )
+{
+	HudOn = on;
+	FrameTimingOn = on;
+	HudTextTime = std::chrono::steady_clock::time_point( );		// rebuild the text right away
+	HudFrames = 0;
+	HudMs = 0.;
+}
+
+
+// draw glut's font into the font texture, through a framebuffer object:
+// (this leaves the framebuffer, viewport, and matrices the way it found them)
+
+void
+MakeHudFont( )
+{
+	int width = HUDFONTCOLUMNS * HUDFONTCELL;
+	int height = HUDFONTROWS * HUDFONTCELL;
+
+	glGenTextures( 1, &HudFontTex );
+	glBindTexture( GL_TEXTURE_2D, HudFontTex );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0 );
+	glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL );
+	glBindTexture( GL_TEXTURE_2D, 0 );
+
+	GLint oldFramebuffer, oldViewport[4];
+	glGetIntegerv( GL_FRAMEBUFFER_BINDING, &oldFramebuffer );
+	glGetIntegerv( GL_VIEWPORT, oldViewport );
+
+	GLuint fb;
+	glGenFramebuffers( 1, &fb );
+	glBindFramebuffer( GL_FRAMEBUFFER, fb );
+	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, HudFontTex, 0 );
+	glViewport( 0, 0, width, height );
+	glClearColor( 0.f, 0.f, 0.f, 0.f );
+	glClear( GL_COLOR_BUFFER_BIT );
+	glClearColor( BACKCOLOR[0], BACKCOLOR[1], BACKCOLOR[2], BACKCOLOR[3] );
+
+	glMatrixMode( GL_PROJECTION );
+	glPushMatrix( );
+	glLoadIdentity( );
+	gluOrtho2D( 0., (double)width, 0., (double)height );
+	glMatrixMode( GL_MODELVIEW );
+	glPushMatrix( );
+	glLoadIdentity( );
+
+	glColor4f( 1.f, 1.f, 1.f, 1.f );
+	for( int c = 0; c < 96; c++ )
+	{
+		int column = c % HUDFONTCOLUMNS;
+		int row = c / HUDFONTCOLUMNS;
+		glRasterPos2i( column * HUDFONTCELL, row * HUDFONTCELL + HUDFONTBASELINE );
+		glutBitmapCharacter( GLUT_BITMAP_HELVETICA_12, ' ' + c );
+		HudFontAdvance[c] = glutBitmapWidth( GLUT_BITMAP_HELVETICA_12, ' ' + c );
+	}
+
+	glPopMatrix( );
+	glMatrixMode( GL_PROJECTION );
+	glPopMatrix( );
+	glMatrixMode( GL_MODELVIEW );
+
+	glBindFramebuffer( GL_FRAMEBUFFER, (GLuint)oldFramebuffer );
+	glDeleteFramebuffers( 1, &fb );
+	glViewport( oldViewport[0], oldViewport[1], oldViewport[2], oldViewport[3] );
+}
+
+
+// add a string's quads to the text array, starting at (x,y) percent units:
+
+void
+HudString( float x, float y, const char *s, float unitsPerPixel )
+{
+	float cell = (float)HUDFONTCELL * unitsPerPixel;
+	y -= (float)HUDFONTBASELINE * unitsPerPixel;
+	for( ; *s != '\0'  &&  HudTextVertices < 4*HUDMAXCHARS; s++ )
+	{
+		int c = *s - ' ';
+		if( c < 0  ||  c >= 96 )
+			c = '?' - ' ';
+		float s0 = (float)( c % HUDFONTCOLUMNS ) / (float)HUDFONTCOLUMNS;
+		float t0 = (float)( c / HUDFONTCOLUMNS ) / (float)HUDFONTROWS;
+		float s1 = s0 + 1.f / (float)HUDFONTCOLUMNS;
+		float t1 = t0 + 1.f / (float)HUDFONTROWS;
+		GLfloat corners[16] =
+		{
+			x,        y,         s0, t0,
+			x + cell, y,         s1, t0,
+			x + cell, y + cell,  s1, t1,
+			x,        y + cell,  s0, t1
+		};
+		memcpy( &HudTextQuads[ 4 * HudTextVertices ], corners, sizeof(corners) );
+		HudTextVertices += 4;
+		x += (float)HudFontAdvance[c] * unitsPerPixel;
+	}
+}
+
+
+// rebuild the text from the last HUDTEXTMS worth of frames:
+
+void
+BuildHudText( double seconds )
+{
+	// average the frames recorded since the last rebuild:
+
+	int n = HudFrames < TIMINGHISTORY ? HudFrames : TIMINGHISTORY;
+	if( n > FrameTimingCount )
+		n = FrameTimingCount;
+	double cpuMs = 0., gpuMs = 0., timingMs = 0.;
+	int gpuFrames = 0;
+	for( int i = 1; i <= n; i++ )
+	{
+		const struct FrameTiming *ft = &FrameTimings[ ( FrameTimingCount - i ) % TIMINGHISTORY ];
+		cpuMs += ft->cpuTotalMs;
+		timingMs += ft->timingMs;
+		if( ft->gpuTotalMs >= 0. )
+		{
+			gpuMs += ft->gpuTotalMs;
+			gpuFrames++;
+		}
+	}
+	if( n > 0 )
+	{
+		cpuMs /= n;
+		timingMs /= n;
+	}
+	if( gpuFrames > 0 )
+		gpuMs /= gpuFrames;
+
+	char line[4][128];
+	double fps = seconds > 0. ? HudFrames / seconds : 0.;
+	if( GpuTimersOk )
+		snprintf( line[0], sizeof(line[0]), "%.0f fps   cpu %.2f ms   gpu %.2f ms", fps, cpuMs, gpuMs );
+	else
+		snprintf( line[0], sizeof(line[0]), "%.0f fps   cpu %.2f ms   gpu n/a", fps, cpuMs );
+	int stateCalls, stateSaved;
+	StateCountTotals( &stateCalls, &stateSaved );
+	snprintf( line[1], sizeof(line[1]), "%d draws   %lld vertices   state %d of %d saved", DrawCounts.drawCalls,
+		DrawCounts.vertices, stateSaved, stateCalls );
+	snprintf( line[2], sizeof(line[2]), "culled %d of %d by the frustum, %d conditional",
+		CullCounts.frustumCulled, CullCounts.tested, CullCounts.conditional );
+	double drawMs = HudFrames > 0 ? HudMs / HudFrames : HudLastMs;
+	snprintf( line[3], sizeof(line[3]), "textures %.2f MB   hud %.3f ms (%.3f drawing, %.3f timing)",
+		(double)TextureBytes / ( 1024. * 1024. ), drawMs + timingMs, drawMs, timingMs );
+
+	// the percent units are spread over the viewport, so a font pixel is this many of them:
+
+	GLint viewport[4];
+	glGetIntegerv( GL_VIEWPORT, viewport );
+	float unitsPerPixel = 100.f / (float)( viewport[3] > 0 ? viewport[3] : 1 );
+
+	HudTextVertices = 0;
+	for( int i = 0; i < 4; i++ )
+		HudString( HUDLEFT, HUDTOP - HUDLINE * (float)( i + 1 ), line[i], unitsPerPixel );
+	glBindBuffer( GL_ARRAY_BUFFER, HudBuffer );
+	glBufferSubData( GL_ARRAY_BUFFER, HUDTEXTOFFSET, 4 * HudTextVertices * sizeof(GLfloat), HudTextQuads );
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+}
+
+
+// draw the hud -- call this with the percent-unit projection and modelview set,
+// and lighting and depth testing off:
+
+void
+DrawHud( )
+{
+	if( HudOn == 0 )
+		return;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now( );
+
+	if( HudFontTex == 0 )
+	{
+		MakeHudFont( );
+		glGenBuffers( 1, &HudBuffer );
+		glBindBuffer( GL_ARRAY_BUFFER, HudBuffer );
+		glBufferData( GL_ARRAY_BUFFER, HUDTEXTOFFSET + sizeof(HudTextQuads), NULL, GL_DYNAMIC_DRAW );
+		glBindBuffer( GL_ARRAY_BUFFER, 0 );
+	}
+
+	double seconds = std::chrono::duration<double>( start - HudTextTime ).count( );
+	if( seconds * 1000. >= HUDTEXTMS )
+	{
+		BuildHudText( seconds );
+		HudTextTime = start;
+		HudLastMs = HudFrames > 0 ? HudMs / HudFrames : 0.;
+		HudFrames = 0;
+		HudMs = 0.;
+	}
+
+	// the graph -- oldest frame on the left (a frame with no gpu time keeps the one before's):
+
+	float y0 = HUDTOP - 5.f * HUDLINE - HUDGRAPHHEIGHT;
+	float x1 = HUDLEFT + HUDGRAPHWIDTH;
+	float y1 = y0 + HUDGRAPHHEIGHT;
+	float target = TargetFps > 0 ? 1000.f / (float)TargetFps : 1000.f / 60.f;
+	float yt = y0 + HUDGRAPHHEIGHT * ( target < HUDGRAPHMS ? target : HUDGRAPHMS ) / HUDGRAPHMS;
+	const struct HudVertex fixed[6] =
+	{
+		{ HUDLEFT, y0, { 0, 0, 0, 128 } },		{ x1, y0, { 0, 0, 0, 128 } },
+		{ x1, y1, { 0, 0, 0, 128 } },			{ HUDLEFT, y1, { 0, 0, 0, 128 } },
+		{ HUDLEFT, yt, { 128, 128, 128, 255 } },	{ x1, yt, { 128, 128, 128, 255 } }
+	};
+	memcpy( HudGraph, fixed, sizeof(fixed) );
+	HudGraphVertices = 6;
+
+	int n = FrameTimingCount < HUDHISTORY ? FrameTimingCount : HUDHISTORY;
+	float lastX = 0.f, lastCpu = 0.f, lastGpu = 0.f, gpu = 0.f;
+	for( int i = 0; i < n; i++ )
+	{
+		const struct FrameTiming *ft = &FrameTimings[ ( FrameTimingCount - n + i ) % TIMINGHISTORY ];
+		float x = HUDLEFT + HUDGRAPHWIDTH * (float)i / (float)( HUDHISTORY - 1 );
+		float cpu = (float)ft->cpuTotalMs < HUDGRAPHMS ? (float)ft->cpuTotalMs : HUDGRAPHMS;
+		if( ft->gpuTotalMs >= 0. )
+			gpu = (float)ft->gpuTotalMs < HUDGRAPHMS ? (float)ft->gpuTotalMs : HUDGRAPHMS;
+		float yc = y0 + HUDGRAPHHEIGHT * cpu / HUDGRAPHMS;
+		float yg = y0 + HUDGRAPHHEIGHT * gpu / HUDGRAPHMS;
+		if( i > 0 )
+		{
+			const struct HudVertex segments[4] =
+			{
+				{ lastX, lastCpu, { 255, 255, 0, 255 } },	{ x, yc, { 255, 255, 0, 255 } },
+				{ lastX, lastGpu, { 0, 255, 255, 255 } },	{ x, yg, { 0, 255, 255, 255 } }
+			};
+			memcpy( &HudGraph[HudGraphVertices], segments, ( GpuTimersOk ? 4 : 2 ) * sizeof(struct HudVertex) );
+			HudGraphVertices += GpuTimersOk ? 4 : 2;
+		}
+		lastX = x;
+		lastCpu = yc;
+		lastGpu = yg;
+	}
+
+	glBindBuffer( GL_ARRAY_BUFFER, HudBuffer );
+	glBufferSubData( GL_ARRAY_BUFFER, 0, HudGraphVertices * sizeof(struct HudVertex), HudGraph );
+
+	glPushAttrib( GL_ENABLE_BIT | GL_TEXTURE_BIT | GL_COLOR_BUFFER_BIT | GL_CURRENT_BIT );
+	glDisable( GL_TEXTURE_2D );
+	glEnable( GL_BLEND );
+	glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+	glEnableClientState( GL_VERTEX_ARRAY );
+	glEnableClientState( GL_COLOR_ARRAY );
+	glVertexPointer( 2, GL_FLOAT, sizeof(struct HudVertex), (void *)0 );
+	glColorPointer( 4, GL_UNSIGNED_BYTE, sizeof(struct HudVertex), (void *)( 2*sizeof(GLfloat) ) );
+	glDrawArrays( GL_QUADS, 0, 4 );
+	glDrawArrays( GL_LINES, 4, HudGraphVertices - 4 );
+	glDisableClientState( GL_COLOR_ARRAY );
+
+	// the text, white modulated by the font's alpha:
+
+	glEnable( GL_TEXTURE_2D );
+	glBindTexture( GL_TEXTURE_2D, HudFontTex );
+	glTexEnvf( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE );
+	glColor3f( 1.f, 1.f, 1.f );
+	glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+	glVertexPointer( 2, GL_FLOAT, 4*sizeof(GLfloat), (void *)HUDTEXTOFFSET );
+	glTexCoordPointer( 2, GL_FLOAT, 4*sizeof(GLfloat), (void *)( HUDTEXTOFFSET + 2*sizeof(GLfloat) ) );
+	glDrawArrays( GL_QUADS, 0, HudTextVertices );
+	glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+	glDisableClientState( GL_VERTEX_ARRAY );
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+	glBindTexture( GL_TEXTURE_2D, 0 );
+	glPopAttrib( );
+
+	HudFrames++;
+	HudMs += std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now( ) - start ).count( );
+}
@@ -0,0 +1,86 @@
+// read-only memory-mapped files, for the asset bundle and the bmp loader:
+// (the whole file is mapped, and the pages are read in by the os as they are touched)
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include <sys/types.h>
+#include <sys/stat.h>
+
+
+struct MappedFile
+{
+	const unsigned char *	data;			// NULL if it isn't mapped
+	size_t					size;
+#ifdef WIN32
+	HANDLE					fileHandle;
+	HANDLE					mapHandle;
+#endif
+};
+
+
+void
+UnmapFile( struct MappedFile *mf )
+{
+	if( mf->data == NULL )
+		return;
+#ifdef WIN32
+	UnmapViewOfFile( mf->data );
+	CloseHandle( mf->mapHandle );
+	CloseHandle( mf->fileHandle );
+#else
+	munmap( (void *)mf->data, mf->size );
+#endif
+	mf->data = NULL;
+	mf->size = 0;
+}
+
+
+// map a whole file (returns false if it isn't there or is empty):
+
+bool
+MapFile( const char *file, struct MappedFile *mf )
+{
+	mf->data = NULL;
+	mf->size = 0;
+
+#ifdef WIN32
+	mf->fileHandle = CreateFileA( file, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if( mf->fileHandle == INVALID_HANDLE_VALUE )
+		return false;
+	LARGE_INTEGER size;
+	GetFileSizeEx( mf->fileHandle, &size );
+	mf->mapHandle = ( size.QuadPart > 0 ) ? CreateFileMappingA( mf->fileHandle, NULL, PAGE_READONLY, 0, 0, NULL ) : NULL;
+	if( mf->mapHandle == NULL )
+	{
+		CloseHandle( mf->fileHandle );
+		return false;
+	}
+	mf->data = (const unsigned char *)MapViewOfFile( mf->mapHandle, FILE_MAP_READ, 0, 0, 0 );
+	if( mf->data == NULL )
+	{
+		CloseHandle( mf->mapHandle );
+		CloseHandle( mf->fileHandle );
+		return false;
+	}
+	mf->size = (size_t)size.QuadPart;
+#else
+	int fd = open( file, O_RDONLY );
+	if( fd < 0 )
+		return false;
+	struct stat st;
+	fstat( fd, &st );
+	size_t size = (size_t)st.st_size;
+	void *p = ( size > 0 ) ? mmap( NULL, size, PROT_READ, MAP_PRIVATE, fd, 0 ) : MAP_FAILED;
+	close( fd );
+	if( p == MAP_FAILED )
+		return false;
+	mf->data = (const unsigned char *)p;
+	mf->size = size;
+#endif
+	return true;
+}
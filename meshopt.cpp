@@ -0,0 +1,307 @@
+// mesh optimization -- turning an obj file's triangle soup into a cache-friendly indexed mesh:
+//
+//	1. weld:	vertices whose 8 floats are identical become one vertex, and the
+//				triangles become an index list (a vertex shared by 6 faces used
+//				to be sent, and transformed, 6 times)
+//
+//	2. cache:	the triangles are reordered for the post-transform vertex cache with
+//				Tom Forsyth's "linear-speed vertex cache optimisation" -- each vertex
+//				gets a score from where it sits in a simulated LRU cache and from how
+//				many of its triangles are still left to draw, and the triangle with
+//				the best total score is always drawn next
+//
+//	3. fetch:	the vertices are renumbered in the order the new index list first
+//				uses them, so the vertex fetches walk forward through memory
+//
+//	the ACMR (average cache miss ratio = vertices transformed per triangle, 3.0 for a
+//	triangle soup, 0.5 is the ideal for a big regular grid) is measured with a FIFO
+//	cache of ACMRCACHESIZE entries before and after, and printed for each mesh
+
+#include <math.h>
+#include <string>
+#include <unordered_map>
+
+
+const int	FORSYTHCACHESIZE = 32;		// the LRU cache that the scores are computed for
+const int	ACMRCACHESIZE    = 16;		// the FIFO cache that the ACMR is measured with
+
+
+// the average cache miss ratio of an index list, with a FIFO post-transform cache:
+
+float
+ComputeACMR( const GLuint *indices, int numIndices, int numVertices, int cacheSize )
+{
+	if( numIndices < 3 )
+		return 0.;
+
+	std::vector<int> timeIn( numVertices, -1 );		// when each vertex went into the fifo
+	int misses = 0;
+	for( int i = 0; i < numIndices; i++ )
+	{
+		int v = (int)indices[i];
+		if( timeIn[v] < 0  ||  misses - timeIn[v] >= cacheSize )
+		{
+			timeIn[v] = misses;
+			misses++;
+		}
+	}
+	return (float)misses / (float)( numIndices / 3 );
+}
+
+
+// step 1: weld identical vertices and make the index list:
+
+void
+WeldVertices( struct ObjMesh *mesh )
+{
+	int n = mesh->numVertices;
+	std::vector<float> welded;
+	GLuint *indices = new GLuint[ n + 1 ];
+	std::unordered_map<std::string, GLuint> seen;
+	seen.reserve( n );
+
+	for( int i = 0; i < n; i++ )
+	{
+		// (adding 0. turns -0. into 0., so the two weld)
+		float key[OBJVERTEXFLOATS];
+		for( int k = 0; k < OBJVERTEXFLOATS; k++ )
+			key[k] = mesh->vertices[ i*OBJVERTEXFLOATS + k ] + 0.f;
+
+		std::string bytes( (const char *)key, sizeof(key) );
+		std::unordered_map<std::string, GLuint>::iterator it = seen.find( bytes );
+		if( it != seen.end( ) )
+		{
+			indices[i] = it->second;
+			continue;
+		}
+		GLuint index = (GLuint)( welded.size( ) / OBJVERTEXFLOATS );
+		seen[bytes] = index;
+		indices[i] = index;
+		welded.insert( welded.end( ), key, key + OBJVERTEXFLOATS );
+	}
+
+	delete [ ] mesh->owned;
+	delete [ ] mesh->ownedIndices;
+	mesh->numVertices = (int)( welded.size( ) / OBJVERTEXFLOATS );
+	mesh->owned = new float[ welded.size( ) + 1 ];
+	if( ! welded.empty( ) )
+		memcpy( mesh->owned, &welded[0], welded.size( ) * sizeof(float) );
+	mesh->vertices = mesh->owned;
+	mesh->numIndices = n;
+	mesh->ownedIndices = indices;
+	mesh->indices = indices;
+}
+
+
+// a vertex's forsyth score:
+// (cachePos < 0 means it is not in the cache)
+
+float
+VertexCacheScore( int cachePos, int trianglesLeft )
+{
+	if( trianglesLeft == 0 )
+		return -1.;
+
+	float score = 0.;
+	if( cachePos >= 0 )
+	{
+		// the 3 vertices of the triangle just drawn get a fixed score, so that
+		// the next triangle doesn't just depend on which of them happened to be first:
+
+		if( cachePos < 3 )
+			score = 0.75f;
+		else
+			score = powf( 1.f - (float)( cachePos - 3 ) / (float)( FORSYTHCACHESIZE - 3 ), 1.5f );
+	}
+
+	// vertices with few triangles left get a boost, so they get finished off:
+
+	score += 2.f * powf( (float)trianglesLeft, -0.5f );
+	return score;
+}
+
+
+// step 2: reorder the triangles for the vertex cache:
+
+void
+OptimizeVertexCache( GLuint *indices, int numIndices, int numVertices )
+{
+	int numTris = numIndices / 3;
+	if( numTris == 0 )
+		return;
+
+	// each vertex's triangles:
+
+	std::vector<int> trianglesLeft( numVertices, 0 );
+	for( int i = 0; i < numIndices; i++ )
+		trianglesLeft[ indices[i] ]++;
+	std::vector<int> firstTri( numVertices + 1, 0 );
+	for( int v = 0; v < numVertices; v++ )
+		firstTri[v+1] = firstTri[v] + trianglesLeft[v];
+	std::vector<int> vertexTris( numIndices );
+	std::vector<int> fill( firstTri.begin( ), firstTri.end( ) - 1 );
+	for( int i = 0; i < numIndices; i++ )
+		vertexTris[ fill[ indices[i] ]++ ] = i / 3;
+
+	std::vector<int> cachePos( numVertices, -1 );
+	std::vector<float> vertexScore( numVertices );
+	for( int v = 0; v < numVertices; v++ )
+		vertexScore[v] = VertexCacheScore( -1, trianglesLeft[v] );
+
+	std::vector<float> triScore( numTris );
+	std::vector<char> triDrawn( numTris, 0 );
+	for( int t = 0; t < numTris; t++ )
+		triScore[t] = vertexScore[ indices[3*t] ] + vertexScore[ indices[3*t+1] ] + vertexScore[ indices[3*t+2] ];
+
+	int cache[ FORSYTHCACHESIZE + 3 ];
+	int cacheUsed = 0;
+	std::vector<GLuint> out;
+	out.reserve( numIndices );
+
+	int best = 0;
+	for( int t = 1; t < numTris; t++ )
+	{
+		if( triScore[t] > triScore[best] )
+			best = t;
+	}
+	int scanFrom = 0;			// everything before this has been drawn
+
+	while( best >= 0 )
+	{
+		// draw it:
+
+		triDrawn[best] = 1;
+		int tv[3] = { (int)indices[3*best], (int)indices[3*best+1], (int)indices[3*best+2] };
+		for( int k = 0; k < 3; k++ )
+		{
+			int v = tv[k];
+			out.push_back( (GLuint)v );
+
+			// take the triangle off the vertex's list:
+
+			int *tris = &vertexTris[ firstTri[v] ];
+			for( int j = 0; j < trianglesLeft[v]; j++ )
+			{
+				if( tris[j] == best )
+				{
+					tris[j] = tris[ trianglesLeft[v] - 1 ];
+					break;
+				}
+			}
+			trianglesLeft[v]--;
+		}
+
+		// move its vertices to the front of the cache:
+
+		int newCache[ FORSYTHCACHESIZE + 3 ];
+		int newUsed = 0;
+		for( int k = 0; k < 3; k++ )
+		{
+			if( ( k < 1  ||  tv[k] != tv[0] )  &&  ( k < 2  ||  tv[k] != tv[1] ) )
+				newCache[ newUsed++ ] = tv[k];
+		}
+		for( int c = 0; c < cacheUsed; c++ )
+		{
+			int v = cache[c];
+			if( v != tv[0]  &&  v != tv[1]  &&  v != tv[2] )
+				newCache[ newUsed++ ] = v;
+		}
+
+		// rescore everything that was or is in the cache, and their triangles:
+
+		for( int c = 0; c < newUsed; c++ )
+		{
+			int v = newCache[c];
+			cachePos[v] = ( c < FORSYTHCACHESIZE ) ? c : -1;
+			float score = VertexCacheScore( cachePos[v], trianglesLeft[v] );
+			float delta = score - vertexScore[v];
+			vertexScore[v] = score;
+			int *tris = &vertexTris[ firstTri[v] ];
+			for( int j = 0; j < trianglesLeft[v]; j++ )
+				triScore[ tris[j] ] += delta;
+		}
+
+		// the next triangle is the best one that uses a vertex in the cache:
+
+		best = -1;
+		float bestScore = -1.e30f;
+		for( int c = 0; c < newUsed; c++ )
+		{
+			int v = newCache[c];
+			int *tris = &vertexTris[ firstTri[v] ];
+			for( int j = 0; j < trianglesLeft[v]; j++ )
+			{
+				if( triScore[ tris[j] ] > bestScore )
+				{
+					bestScore = triScore[ tris[j] ];
+					best = tris[j];
+				}
+			}
+		}
+		cacheUsed = ( newUsed < FORSYTHCACHESIZE ) ? newUsed : FORSYTHCACHESIZE;
+		for( int c = 0; c < cacheUsed; c++ )
+			cache[c] = newCache[c];
+
+		// nothing in the cache has triangles left -- start on the next undrawn one:
+
+		if( best < 0 )
+		{
+			while( scanFrom < numTris  &&  triDrawn[scanFrom] != 0 )
+				scanFrom++;
+			if( scanFrom < numTris )
+				best = scanFrom;
+		}
+	}
+
+	memcpy( indices, &out[0], numIndices * sizeof(GLuint) );
+}
+
+
+// step 3: renumber the vertices in the order the index list first uses them:
+
+void
+OptimizeVertexFetch( struct ObjMesh *mesh )
+{
+	std::vector<int> newIndex( mesh->numVertices, -1 );
+	float *vertices = new float[ mesh->numVertices * OBJVERTEXFLOATS + 1 ];
+	int used = 0;
+	for( int i = 0; i < mesh->numIndices; i++ )
+	{
+		int v = (int)mesh->ownedIndices[i];
+		if( newIndex[v] < 0 )
+		{
+			newIndex[v] = used;
+			memcpy( &vertices[ used*OBJVERTEXFLOATS ], &mesh->vertices[ v*OBJVERTEXFLOATS ], OBJVERTEXFLOATS*sizeof(float) );
+			used++;
+		}
+		mesh->ownedIndices[i] = (GLuint)newIndex[v];
+	}
+
+	delete [ ] mesh->owned;
+	mesh->owned = vertices;
+	mesh->vertices = vertices;
+	mesh->numVertices = used;
+}
+
+
+// run the whole pipeline on a triangle soup from ReadObjFile( ):
+// (name is just for the report)
+
+void
+OptimizeObjMesh( const char *name, struct ObjMesh *mesh )
+{
+	if( mesh->numVertices < 3  ||  mesh->numIndices != 0  ||  mesh->owned == NULL )
+		return;
+
+	int soupVertices = mesh->numVertices;
+	WeldVertices( mesh );
+	float before = ComputeACMR( mesh->indices, mesh->numIndices, mesh->numVertices, ACMRCACHESIZE );
+
+	OptimizeVertexCache( mesh->ownedIndices, mesh->numIndices, mesh->numVertices );
+	OptimizeVertexFetch( mesh );
+	float after = ComputeACMR( mesh->indices, mesh->numIndices, mesh->numVertices, ACMRCACHESIZE );
+
+	if( DebugOn != 0 )
+		fprintf( stderr, "Optimized '%s': %d triangles, %d -> %d vertices, ACMR %.3f -> %.3f\n",
+			name, mesh->numIndices / 3, soupVertices, mesh->numVertices, before, after );
+}
@@ -0,0 +1,529 @@
+// multiball -- many balls on the table at once, for multiball play and for load testing:
+//
+//	with MultiballCount > 1 (the Balls menu) the physics has that many balls: the player's
+//	(Table.ball, the one the plunger serves) and MultiballCount-1 more, dropped in across
+//	the top of the table -- and dropped in again when they drain
+//
+//	the balls are a structure of arrays -- x[ ], z[ ], vx[ ], vz[ ], and spin[ ] (about the
+//	vertical, from the friction in their hits) -- all in one 32-byte aligned block made once
+//	for MAXBALLS, so any number of balls is just a count, and the work on every ball runs
+//	8 balls at a time with AVX2 (if the cpu has it, else one at a time -- the AVX2 kernels
+//	are compiled in on x86 with gcc and clang whether or not -mavx2 is given):
+//
+//		moving		gravity down the table, rolling drag, and the step
+//		the table	for each piece, which balls are within its reach, and then (if its mesh
+//					has a distance field) how far each of those is from it, 8 lookups at
+//					once with gathers -- only the few balls that are touching it go through
+//					CollidePiece( ) one at a time
+//
+//	ball against ball is sweep and prune: order[ ] keeps the balls sorted by x, and a
+//	ball is only tested against the ones after it that are less than a ball's width farther
+//	along -- it is insertion sorted every step, which is close to free, since no ball moves
+//	more than a little in one step
+//
+//	"finalproj -multiball-bench [file.json]" runs the steps headless with 1 up to MAXBALLS
+//	balls, and writes how long a step takes at each count (multiball.json by default)
+
+#include <chrono>
+
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+#include <immintrin.h>
+#define MULTIBALL_AVX2
+#define MULTIBALL_AVX2_TARGET	__attribute__(( target( "avx2" ) ))
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define MULTIBALL_AVX2
+#define MULTIBALL_AVX2_TARGET
+#endif
+
+
+const int		MAXBALLS = 4096;				// a multiple of 8
+const float		SPINDECAY = 2.f;				// fraction of the spin lost per second
+const float		BALLRESTITUTION = 0.9f;			// ball against ball
+const float		DROPXMIN = -5.f;				// where the balls are dropped in
+const float		DROPXMAX = 4.f;
+const float		DROPZ = -7.5f;
+const float		FILLZMAX = 6.f;					// balls are first spread down to here
+
+const int		MULTIBENCHWARMUP = 200;			// steps
+const int		MULTIBENCHSTEPS = 1000;
+
+enum MultiballSegments
+{
+	MULTI_MOVE,
+	MULTI_TABLE,
+	MULTI_PAIRS,
+	NUMMULTISEGMENTS
+};
+
+struct BallSet
+{
+	int				count;
+	float *			x;
+	float *			z;
+	float *			vx;
+	float *			vz;
+	float *			spin;				// radians / second, about the vertical
+	int *			order;				// the balls sorted by x
+	unsigned int	seed;				// for where they are dropped
+};
+
+int				MultiballCount = 1;
+struct BallSet	Balls;
+char *			MultiballBenchFile = NULL;	// != NULL means -multiball-bench was given
+
+double			MultiballMs[NUMMULTISEGMENTS];	// summed over the last frame's steps
+int				MultiballContacts;				// ball against ball, in the last frame's steps
+
+
+void
+ParseMultiballArgs( int argc, char *argv[ ] )
+{
+	for( int i = 1; i < argc; i++ )
+	{
+		if( strcmp( argv[i], "-multiball-bench" ) == 0 )
+		{
+			MultiballBenchFile = (char *)"multiball.json";
+			if( i+1 < argc  &&  argv[i+1][0] != '-' )
+				MultiballBenchFile = argv[++i];
+			HeadlessOn = 1;
+		}
+	}
+}
+
+
+inline float
+BallRandom( struct BallSet *b )
+{
+	b->seed = b->seed*1664525u + 1013904223u;
+	return (float)( b->seed >> 8 ) / 16777216.f;
+}
+
+
+// drop a ball in at the top of the table:
+
+void
+DropBall( struct BallSet *b, int i )
+{
+	b->x[i] = DROPXMIN + ( DROPXMAX - DROPXMIN ) * BallRandom( b );
+	b->z[i] = DROPZ;
+	b->vx[i] = 2.f * BallRandom( b ) - 1.f;
+	b->vz[i] = 0.f;
+	b->spin[i] = 0.f;
+}
+
+
+// have n balls on the table -- ball 0 is Table.ball, the rest are spread over the table:
+// (the arrays are made the first time, for MAXBALLS)
+
+void
+SetMultiball( int n )
+{
+	struct BallSet *b = &Balls;
+	if( b->x == NULL )
+	{
+		float *block = AlignedFloats( 5*MAXBALLS );
+		memset( block, 0, 5*MAXBALLS*sizeof(float) );
+		b->x = block;
+		b->z = block + MAXBALLS;
+		b->vx = block + 2*MAXBALLS;
+		b->vz = block + 3*MAXBALLS;
+		b->spin = block + 4*MAXBALLS;
+		b->order = new int[ MAXBALLS ];
+	}
+
+	MultiballCount = ( n < 1 ) ? 1 : ( n > MAXBALLS ? MAXBALLS : n );
+	b->count = MultiballCount;
+	b->seed = 12345;
+	for( int i = 0; i < b->count; i++ )
+	{
+		DropBall( b, i );
+		b->z[i] = DROPZ + ( FILLZMAX - DROPZ ) * BallRandom( b );
+		b->order[i] = i;
+	}
+	b->x[0] = Table.ball.x;
+	b->z[0] = Table.ball.z;
+	b->vx[0] = Table.ball.vx;
+	b->vz[0] = Table.ball.vz;
+}
+
+
+#ifdef MULTIBALL_AVX2
+
+// can the AVX2 kernels be used on this cpu?
+
+bool
+MultiballHasAVX2( )
+{
+#if defined(__GNUC__)
+	static const bool avx2 = __builtin_cpu_supports( "avx2" );
+	return avx2;
+#else
+	return true;		// (this was compiled for AVX2)
+#endif
+}
+
+
+// the move, 8 balls at a time:
+
+MULTIBALL_AVX2_TARGET void
+MoveBallsAVX2( struct BallSet *b, float pull, float drag, float spinDrag, float dt )
+{
+	const __m256 vpull = _mm256_set1_ps( pull );
+	const __m256 vdrag = _mm256_set1_ps( drag );
+	const __m256 vspinDrag = _mm256_set1_ps( spinDrag );
+	const __m256 vdt = _mm256_set1_ps( dt );
+	for( int i = 0; i < b->count; i += 8 )		// (the lanes past count are harmless)
+	{
+		__m256 vx = _mm256_mul_ps( _mm256_load_ps( b->vx + i ), vdrag );
+		__m256 vz = _mm256_mul_ps( _mm256_add_ps( _mm256_load_ps( b->vz + i ), vpull ), vdrag );
+		_mm256_store_ps( b->vx + i, vx );
+		_mm256_store_ps( b->vz + i, vz );
+		_mm256_store_ps( b->x + i, _mm256_add_ps( _mm256_load_ps( b->x + i ), _mm256_mul_ps( vx, vdt ) ) );
+		_mm256_store_ps( b->z + i, _mm256_add_ps( _mm256_load_ps( b->z + i ), _mm256_mul_ps( vz, vdt ) ) );
+		_mm256_store_ps( b->spin + i, _mm256_mul_ps( _mm256_load_ps( b->spin + i ), vspinDrag ) );
+	}
+}
+
+#endif
+
+
+// gravity, drag, and the move, for all of the balls:
+
+void
+MoveBalls( struct BallSet *b, float dt )
+{
+	const float pull = GRAVITY * sinf( TABLETILT * F_PI / 180.f ) * ROLLINGFACTOR * dt;
+	const float drag = 1.f - ROLLINGDRAG * dt;
+	const float spinDrag = 1.f - SPINDECAY * dt;
+
+#ifdef MULTIBALL_AVX2
+	if( MultiballHasAVX2( ) )
+	{
+		MoveBallsAVX2( b, pull, drag, spinDrag, dt );
+		return;
+	}
+#endif
+	for( int i = 0; i < b->count; i++ )
+	{
+		b->vx[i] *= drag;
+		b->vz[i] = ( b->vz[i] + pull ) * drag;
+		b->x[i] += b->vx[i] * dt;
+		b->z[i] += b->vz[i] * dt;
+		b->spin[i] *= spinDrag;
+	}
+}
+
+
+// bounce ball i off a piece, the same way as the player's ball:
+
+void
+CollideBall( struct BallSet *b, int i, const struct TablePiece *piece, const struct PieceFrame *f,
+	const struct CollisionMesh *cm )
+{
+	struct Ball ball = { b->x[i], b->z[i], b->vx[i], b->vz[i] };
+	CollidePiece( &ball, &b->spin[i], piece, f, cm );
+	b->x[i] = ball.x;
+	b->z[i] = ball.z;
+	b->vx[i] = ball.vx;
+	b->vz[i] = ball.vz;
+}
+
+
+#ifdef MULTIBALL_AVX2
+
+// FieldDistance( ) for 8 points at once -- the lanes not in active, or outside the stored
+// bricks, are FIELDBAND:
+
+MULTIBALL_AVX2_TARGET inline __m256
+FieldDistance8( const struct DistanceField *f, __m256 px, __m256 py, __m256 pz, __m256 active )
+{
+	const __m256 inv = _mm256_set1_ps( 1.f / FIELDCELL );
+	const __m256 zero = _mm256_setzero_ps( );
+	__m256 gx = _mm256_mul_ps( _mm256_sub_ps( px, _mm256_set1_ps( f->origin[0] ) ), inv );
+	__m256 gy = _mm256_mul_ps( _mm256_sub_ps( py, _mm256_set1_ps( f->origin[1] ) ), inv );
+	__m256 gz = _mm256_mul_ps( _mm256_sub_ps( pz, _mm256_set1_ps( f->origin[2] ) ), inv );
+	__m256 inside = _mm256_and_ps( active, _mm256_and_ps( _mm256_cmp_ps( gx, zero, _CMP_GE_OQ ),
+		_mm256_and_ps( _mm256_cmp_ps( gy, zero, _CMP_GE_OQ ), _mm256_cmp_ps( gz, zero, _CMP_GE_OQ ) ) ) );
+
+	__m256i cx = _mm256_cvttps_epi32( gx );
+	__m256i cy = _mm256_cvttps_epi32( gy );
+	__m256i cz = _mm256_cvttps_epi32( gz );
+	__m256i bx = _mm256_srli_epi32( cx, FIELDBRICKSHIFT );
+	__m256i by = _mm256_srli_epi32( cy, FIELDBRICKSHIFT );
+	__m256i bz = _mm256_srli_epi32( cz, FIELDBRICKSHIFT );
+	__m256i valid = _mm256_and_si256( _mm256_castps_si256( inside ),
+		_mm256_and_si256( _mm256_cmpgt_epi32( _mm256_set1_epi32( f->dims[0] ), bx ),
+		_mm256_and_si256( _mm256_cmpgt_epi32( _mm256_set1_epi32( f->dims[1] ), by ),
+			_mm256_cmpgt_epi32( _mm256_set1_epi32( f->dims[2] ), bz ) ) ) );
+
+	__m256i brick = _mm256_add_epi32( _mm256_mullo_epi32( _mm256_add_epi32(
+		_mm256_mullo_epi32( bz, _mm256_set1_epi32( f->dims[1] ) ), by ), _mm256_set1_epi32( f->dims[0] ) ), bx );
+	__m256i b = _mm256_mask_i32gather_epi32( _mm256_set1_epi32( -1 ), f->brickIndex, brick, valid, 4 );
+	valid = _mm256_and_si256( valid, _mm256_cmpgt_epi32( b, _mm256_set1_epi32( -1 ) ) );
+	if( _mm256_testz_si256( valid, valid ) )
+		return _mm256_set1_ps( FIELDBAND );
+
+	// the index of sample 0, 0, 0 of each point's cell:
+	__m256i lx = _mm256_sub_epi32( cx, _mm256_slli_epi32( bx, FIELDBRICKSHIFT ) );
+	__m256i ly = _mm256_sub_epi32( cy, _mm256_slli_epi32( by, FIELDBRICKSHIFT ) );
+	__m256i lz = _mm256_sub_epi32( cz, _mm256_slli_epi32( bz, FIELDBRICKSHIFT ) );
+	const __m256i side = _mm256_set1_epi32( FIELDSAMPLES );
+	__m256i s = _mm256_add_epi32( _mm256_mullo_epi32( b, _mm256_set1_epi32( FIELDBRICKSAMPLES ) ),
+		_mm256_add_epi32( _mm256_mullo_epi32( _mm256_add_epi32( _mm256_mullo_epi32( lz, side ), ly ), side ), lx ) );
+
+	// the 8 samples around each point, each read as 32 bits and cut down to its 16:
+	const int dy = FIELDSAMPLES;
+	const int dz = FIELDSAMPLES * FIELDSAMPLES;
+	const int corners[8] = { 0, 1, dy, dy+1, dz, dz+1, dz+dy, dz+dy+1 };
+	const __m256i low = _mm256_set1_epi32( 0xffff );
+	__m256 v[8];
+	for( int k = 0; k < 8; k++ )
+	{
+		__m256i sample = _mm256_mask_i32gather_epi32( _mm256_setzero_si256( ), (const int *)f->samples,
+			_mm256_add_epi32( s, _mm256_set1_epi32( corners[k] ) ), valid, 2 );
+		v[k] = _mm256_cvtepi32_ps( _mm256_and_si256( sample, low ) );
+	}
+
+	__m256 tx = _mm256_sub_ps( gx, _mm256_cvtepi32_ps( cx ) );
+	__m256 ty = _mm256_sub_ps( gy, _mm256_cvtepi32_ps( cy ) );
+	__m256 tz = _mm256_sub_ps( gz, _mm256_cvtepi32_ps( cz ) );
+	__m256 x00 = _mm256_add_ps( v[0], _mm256_mul_ps( tx, _mm256_sub_ps( v[1], v[0] ) ) );
+	__m256 x10 = _mm256_add_ps( v[2], _mm256_mul_ps( tx, _mm256_sub_ps( v[3], v[2] ) ) );
+	__m256 x01 = _mm256_add_ps( v[4], _mm256_mul_ps( tx, _mm256_sub_ps( v[5], v[4] ) ) );
+	__m256 x11 = _mm256_add_ps( v[6], _mm256_mul_ps( tx, _mm256_sub_ps( v[7], v[6] ) ) );
+	__m256 y0 = _mm256_add_ps( x00, _mm256_mul_ps( ty, _mm256_sub_ps( x10, x00 ) ) );
+	__m256 y1 = _mm256_add_ps( x01, _mm256_mul_ps( ty, _mm256_sub_ps( x11, x01 ) ) );
+	__m256 d = _mm256_mul_ps( _mm256_set1_ps( FIELDQUANTUM ), _mm256_add_ps( y0, _mm256_mul_ps( tz, _mm256_sub_ps( y1, y0 ) ) ) );
+	return _mm256_blendv_ps( _mm256_set1_ps( FIELDBAND ), d, _mm256_castsi256_ps( valid ) );
+}
+
+
+// bounce all of the balls but the player's off one piece, 8 balls at a time, down to just
+// the ones that might be touching the piece (ball 0, the player's, has already been done
+// by StepTable( )):
+
+MULTIBALL_AVX2_TARGET void
+CollidePieceAVX2( struct BallSet *b, const struct TablePiece *piece, const struct PieceFrame *f,
+	const struct CollisionMesh *cm )
+{
+	const float reach = cm->radius + BALLRADIUS;
+	const __m256 lane = _mm256_setr_ps( 0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f );
+	const __m256 one = _mm256_set1_ps( 1.f );
+	const __m256 count = _mm256_set1_ps( (float)b->count );
+	const __m256 fx = _mm256_set1_ps( f->x ), fz = _mm256_set1_ps( f->z );
+	const __m256 c = _mm256_set1_ps( f->c ), sn = _mm256_set1_ps( f->s );
+	const __m256 height = _mm256_set1_ps( BALLY - piece->y );
+	const __m256 radius = _mm256_set1_ps( BALLRADIUS );
+	bool field = ( FieldOn != 0  &&  cm->field.brickIndex != NULL );
+	for( int i = 0; i < b->count; i += 8 )
+	{
+		__m256 dx = _mm256_sub_ps( _mm256_load_ps( b->x + i ), fx );
+		__m256 dz = _mm256_sub_ps( _mm256_load_ps( b->z + i ), fz );
+		__m256 d2 = _mm256_add_ps( _mm256_mul_ps( dx, dx ), _mm256_mul_ps( dz, dz ) );
+		__m256 which = _mm256_add_ps( lane, _mm256_set1_ps( (float)i ) );
+		__m256 near = _mm256_and_ps( _mm256_cmp_ps( d2, _mm256_set1_ps( reach*reach ), _CMP_LE_OQ ),
+			_mm256_and_ps( _mm256_cmp_ps( which, one, _CMP_GE_OQ ), _mm256_cmp_ps( which, count, _CMP_LT_OQ ) ) );
+		int hits = _mm256_movemask_ps( near );
+		if( hits == 0 )
+			continue;
+		if( field )
+		{
+			__m256 px = _mm256_sub_ps( _mm256_mul_ps( c, dx ), _mm256_mul_ps( sn, dz ) );
+			__m256 pz = _mm256_add_ps( _mm256_mul_ps( sn, dx ), _mm256_mul_ps( c, dz ) );
+			__m256 dist = FieldDistance8( &cm->field, px, height, pz, near );
+			hits &= _mm256_movemask_ps( _mm256_cmp_ps( dist, radius, _CMP_LT_OQ ) );
+		}
+		for( int k = 0; k < 8; k++ )
+		{
+			if( ( hits & ( 1 << k ) ) != 0 )
+				CollideBall( b, i + k, piece, f, cm );
+		}
+	}
+}
+
+#endif
+
+
+// bounce all of the balls but the player's off the table:
+
+void
+CollideBallsWithTable( struct BallSet *b, const struct TableState *s )
+{
+	for( int p = 0; p < NUMTABLEPIECES; p++ )
+	{
+		const struct TablePiece *piece = &TablePieces[p];
+		const struct CollisionMesh *cm = PieceMesh( piece );
+		if( cm == NULL  ||  cm->numTriangles == 0 )
+			continue;
+		struct PieceFrame f;
+		PieceFrameAt( s, piece, &f );
+
+#ifdef MULTIBALL_AVX2
+		if( MultiballHasAVX2( ) )
+		{
+			CollidePieceAVX2( b, piece, &f, cm );
+			continue;
+		}
+#endif
+		for( int i = 1; i < b->count; i++ )
+			CollideBall( b, i, piece, &f, cm );
+	}
+}
+
+
+// bounce the balls off each other:
+// (sweep and prune along x)
+
+void
+CollideBallPairs( struct BallSet *b )
+{
+	int *order = b->order;
+	for( int i = 1; i < b->count; i++ )
+	{
+		int ball = order[i];
+		float x = b->x[ball];
+		int j = i - 1;
+		for( ; j >= 0  &&  b->x[ order[j] ] > x; j-- )
+			order[j+1] = order[j];
+		order[j+1] = ball;
+	}
+
+	const float width = 2.f * BALLRADIUS;
+	for( int i = 0; i < b->count; i++ )
+	{
+		int p = order[i];
+		for( int j = i + 1; j < b->count; j++ )
+		{
+			int q = order[j];
+			float dx = b->x[q] - b->x[p];
+			if( dx >= width )
+				break;
+			float dz = b->z[q] - b->z[p];
+			float d2 = dx*dx + dz*dz;
+			if( d2 >= width*width  ||  d2 == 0.f )
+				continue;
+
+			// push them apart, half each, and bounce them if they are coming together:
+			float d = sqrtf( d2 );
+			float nx = dx / d;
+			float nz = dz / d;
+			float half = 0.5f * ( width - d );
+			b->x[p] -= half * nx;
+			b->z[p] -= half * nz;
+			b->x[q] += half * nx;
+			b->z[q] += half * nz;
+			MultiballContacts++;
+
+			float vn = ( b->vx[q] - b->vx[p] )*nx + ( b->vz[q] - b->vz[p] )*nz;
+			if( vn >= 0.f )
+				continue;
+			float impulse = -0.5f * ( 1.f + BALLRESTITUTION ) * vn;
+			b->vx[p] -= impulse * nx;
+			b->vz[p] -= impulse * nz;
+			b->vx[q] += impulse * nx;
+			b->vz[q] += impulse * nz;
+		}
+	}
+}
+
+
+// one fixed step of the balls other than the player's, after StepTable( ) has done that one:
+
+void
+StepMultiball( struct TableState *s, float dt )
+{
+	struct BallSet *b = &Balls;
+	if( MultiballCount < 2  ||  b->count != MultiballCount )
+		return;
+
+	std::chrono::high_resolution_clock::time_point t0 = std::chrono::high_resolution_clock::now( );
+	MoveBalls( b, dt );
+	std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now( );
+	CollideBallsWithTable( b, s );
+	for( int i = 1; i < b->count; i++ )
+	{
+		bool lost = !( fabsf( b->x[i] ) < TABLELIMIT  &&  fabsf( b->z[i] ) < TABLELIMIT );
+		if( lost  ||  b->z[i] > DRAINZ )
+			DropBall( b, i );
+	}
+	std::chrono::high_resolution_clock::time_point t2 = std::chrono::high_resolution_clock::now( );
+
+	// (ball 0 was moved by StepTable( ) -- it only takes part in the ball against ball)
+	b->x[0] = s->ball.x;
+	b->z[0] = s->ball.z;
+	b->vx[0] = s->ball.vx;
+	b->vz[0] = s->ball.vz;
+	CollideBallPairs( b );
+	s->ball.x = b->x[0];
+	s->ball.z = b->z[0];
+	s->ball.vx = b->vx[0];
+	s->ball.vz = b->vz[0];
+	std::chrono::high_resolution_clock::time_point t3 = std::chrono::high_resolution_clock::now( );
+
+	MultiballMs[MULTI_MOVE]  += std::chrono::duration<double, std::milli>( t1 - t0 ).count( );
+	MultiballMs[MULTI_TABLE] += std::chrono::duration<double, std::milli>( t2 - t1 ).count( );
+	MultiballMs[MULTI_PAIRS] += std::chrono::duration<double, std::milli>( t3 - t2 ).count( );
+}
+
+
+// time the steps with more and more balls, and write it out:
+// (returns 0 if it worked, so main( ) can exit with it)
+
+int
+RunMultiballBenchmark( )
+{
+	FILE *fp = fopen( MultiballBenchFile, "w" );
+	if( fp == NULL )
+	{
+		fprintf( stderr, "Cannot write '%s'\n", MultiballBenchFile );
+		return 1;
+	}
+	const char *kernels = "scalar";
+#ifdef MULTIBALL_AVX2
+	if( MultiballHasAVX2( ) )
+		kernels = "avx2";
+#endif
+	fprintf( fp, "{\n  \"kernels\": \"%s\",\n  \"distanceFields\": %s,\n  \"steps\": %d,\n  \"runs\": [\n",
+		kernels, FieldOn != 0 ? "true" : "false", MULTIBENCHSTEPS );
+	fprintf( stderr, "Multiball benchmark (%s kernels), %d steps each:\n", kernels, MULTIBENCHSTEPS );
+	fprintf( stderr, "  balls   us/step   ns/ball    move   table   pairs   contacts/step\n" );
+
+	for( int n = 1; n <= MAXBALLS; n *= 2 )
+	{
+		ResetTable( &Table );
+		SetMultiball( n );
+		for( int i = 0; i < MULTIBENCHWARMUP; i++ )
+		{
+			StepTable( &Table, PHYSICSDT );
+			StepMultiball( &Table, PHYSICSDT );
+		}
+
+		memset( MultiballMs, 0, sizeof(MultiballMs) );
+		MultiballContacts = 0;
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now( );
+		for( int i = 0; i < MULTIBENCHSTEPS; i++ )
+		{
+			StepTable( &Table, PHYSICSDT );
+			StepMultiball( &Table, PHYSICSDT );
+		}
+		double us = std::chrono::duration<double, std::micro>( std::chrono::high_resolution_clock::now( ) - start ).count( )
+			/ (double)MULTIBENCHSTEPS;
+
+		double segment[NUMMULTISEGMENTS];
+		for( int k = 0; k < NUMMULTISEGMENTS; k++ )
+			segment[k] = 1000. * MultiballMs[k] / (double)MULTIBENCHSTEPS;
+		double contacts = (double)MultiballContacts / (double)MULTIBENCHSTEPS;
+		fprintf( fp, "    { \"balls\": %d, \"usPerStep\": %.3f, \"nsPerBall\": %.1f, \"moveUs\": %.3f, \"tableUs\": %.3f, "
+			"\"pairsUs\": %.3f, \"contactsPerStep\": %.1f }%s\n", n, us, 1000. * us / (double)n,
+			segment[MULTI_MOVE], segment[MULTI_TABLE], segment[MULTI_PAIRS], contacts, ( 2*n <= MAXBALLS ) ? "," : "" );
+		fprintf( stderr, "  %5d  %8.2f  %8.1f  %6.2f  %6.2f  %6.2f  %8.1f\n", n, us, 1000. * us / (double)n,
+			segment[MULTI_MOVE], segment[MULTI_TABLE], segment[MULTI_PAIRS], contacts );
+	}
+
+	fprintf( fp, "  ]\n}\n" );
+	fclose( fp );
+	SetMultiball( 1 );
+	fprintf( stderr, "Wrote '%s'\n", MultiballBenchFile );
+	return 0;
+}
@@ -0,0 +1,258 @@
+// a keyframe track that holds several channels (ball x and z, red green and blue, ...):
+//
+//	each channel is still authored as its own Keytimes, with its own key times,
+//	and Build( ) then turns all of the channels into one list of key times
+//	(the union of every channel's key times) with one cubic per segment per channel
+//
+//	because every channel's own key times are in the union, each merged segment
+//	falls inside a single segment of each channel's Keytimes curve, so that piece
+//	is one cubic -- it is recovered exactly from 4 samples of the Keytimes curve
+//	and the tracks look exactly like the separate Keytimes did
+//
+//	the coefficients are stored structure-of-arrays style:
+//		Coeffs[ ( segment*4 + power ) * NumChannels + channel ]
+//	so one segment's constant terms for all channels are together, then the linear
+//	terms, and so on -- GetValues( ) evaluates all channels with one Horner loop
+//
+//	GetValues( ) remembers the last segment it used and walks forward from there,
+//	so while time keeps moving forward a lookup is constant time -- going backward
+//	(the animation cycle wrapping around) falls back to a binary search
+
+#include <assert.h>
+#include <vector>
+#include <algorithm>
+
+
+// channel proxy, so a channel can be authored with the same AddTimeValue( ) calls as a Keytimes:
+
+class MultiKeytimes;
+
+struct KeyChannel
+{
+	MultiKeytimes *	track;
+	int				channel;
+
+	void	AddTimeValue( float, float );
+};
+
+
+class MultiKeytimes
+{
+	private:
+		int						NumChannels;
+		std::vector<Keytimes>	Sources;		// what was authored, one per channel
+		std::vector<int>		NumSourceKeys;	// keys authored in each channel
+		std::vector< std::vector<float> >	SourceKeys;	// each channel's t0, v0, t1, v1, ... as authored
+		std::vector<float>		KeyTimes;		// every key time of every channel, sorted
+		std::vector<float>		Times;			// the merged key times, no duplicates
+		std::vector<float>		Coeffs;			// 4 cubic coefficients per segment per channel
+		int						NumSegments;
+		int						Cursor;			// the segment the last lookup landed in
+
+		int		FindSegment( float );
+
+	public:
+		MultiKeytimes( )		{ NumChannels = 0;  NumSegments = 0;  Cursor = 0; }
+
+		void		AddTimeValue( int, float, float );
+		void		Build( );
+		KeyChannel	Channel( int );
+		int			GetNumChannels( )	{ return NumChannels; }
+		int			GetNumSegments( )	{ return NumSegments; }
+		float		GetValue( float, int );
+		void		GetValues( float, float * );
+		void		Init( int );
+		bool		SameKeys( MultiKeytimes & );
+};
+
+
+void
+KeyChannel::AddTimeValue( float time, float value )
+{
+	track->AddTimeValue( channel, time, value );
+}
+
+
+// start over with a given number of channels:
+
+void
+MultiKeytimes::Init( int numChannels )
+{
+	NumChannels = numChannels;
+	Sources.assign( numChannels, Keytimes( ) );
+	NumSourceKeys.assign( numChannels, 0 );
+	SourceKeys.assign( numChannels, std::vector<float>( ) );
+	for( int c = 0; c < numChannels; c++ )
+		Sources[c].Init( );
+	KeyTimes.clear( );
+	Times.clear( );
+	Coeffs.clear( );
+	NumSegments = 0;
+	Cursor = 0;
+}
+
+
+KeyChannel
+MultiKeytimes::Channel( int channel )
+{
+	KeyChannel kc;
+	kc.track = this;
+	kc.channel = channel;
+	return kc;
+}
+
+
+void
+MultiKeytimes::AddTimeValue( int channel, float time, float value )
+{
+	if( channel < 0  ||  channel >= NumChannels )
+	{
+		fprintf( stderr, "MultiKeytimes::AddTimeValue: channel %d is out of range (0-%d)\n", channel, NumChannels-1 );
+		return;
+	}
+	Sources[channel].AddTimeValue( time, value );
+	NumSourceKeys[channel]++;
+	SourceKeys[channel].push_back( time );
+	SourceKeys[channel].push_back( value );
+	KeyTimes.insert( std::upper_bound( KeyTimes.begin( ), KeyTimes.end( ), time ), time );
+}
+
+
+// merge the channels' key times and fit each merged segment's cubics:
+// (call this once all the keys have been added)
+
+void
+MultiKeytimes::Build( )
+{
+	Times.clear( );
+	for( size_t i = 0; i < KeyTimes.size( ); i++ )
+	{
+		if( Times.empty( )  ||  KeyTimes[i] > Times.back( ) )
+			Times.push_back( KeyTimes[i] );
+	}
+
+	// a track with less than 2 distinct key times is constant:
+
+	if( Times.empty( ) )
+		Times.push_back( 0. );
+	if( Times.size( ) == 1 )
+		Times.push_back( Times[0] + 1.f );
+
+	NumSegments = (int)Times.size( ) - 1;
+	Coeffs.assign( NumSegments * 4 * NumChannels, 0. );
+	Cursor = 0;
+
+	for( int s = 0; s < NumSegments; s++ )
+	{
+		float t0 = Times[s];
+		float t1 = Times[s+1];
+		for( int c = 0; c < NumChannels; c++ )
+		{
+			if( NumSourceKeys[c] == 0 )
+				continue;
+
+			// sample the channel's own curve at 0, 1/3, 2/3, and 1 of the way along:
+
+			double f0 = Sources[c].GetValue( t0 );
+			double f1 = Sources[c].GetValue( t0 + ( t1 - t0 ) / 3.f );
+			double f2 = Sources[c].GetValue( t0 + 2.f*( t1 - t0 ) / 3.f );
+			double f3 = Sources[c].GetValue( t1 );
+
+			// forward differences give the cubic in u = 3s, which is then rewritten in s:
+
+			double d1 = f1 - f0;
+			double d2 = f2 - 2.*f1 + f0;
+			double d3 = f3 - 3.*f2 + 3.*f1 - f0;
+
+			float *coef = &Coeffs[ s*4*NumChannels + c ];
+			coef[0*NumChannels] = (float)f0;
+			coef[1*NumChannels] = (float)( 3. * ( d1 - d2/2. + d3/3. ) );
+			coef[2*NumChannels] = (float)( 9. * ( d2/2. - d3/2. ) );
+			coef[3*NumChannels] = (float)( 4.5 * d3 );
+		}
+	}
+}
+
+
+// which segment is a time in?
+// (times before the first key or after the last one are clamped to the ends)
+
+int
+MultiKeytimes::FindSegment( float time )
+{
+	if( time < Times[Cursor] )
+	{
+		if( time <= Times[0] )
+		{
+			Cursor = 0;
+			return Cursor;
+		}
+
+		// went backward -- search from scratch:
+
+		Cursor = (int)( std::upper_bound( Times.begin( ), Times.end( ), time ) - Times.begin( ) ) - 1;
+		return Cursor;
+	}
+
+	while( Cursor < NumSegments-1  &&  time >= Times[Cursor+1] )
+		Cursor++;
+	return Cursor;
+}
+
+
+// all the channels' values at a time:
+
+void
+MultiKeytimes::GetValues( float time, float *values )
+{
+	if( NumSegments == 0 )
+	{
+		fprintf( stderr, "MultiKeytimes::GetValues: Build( ) has not been called\n" );
+		for( int c = 0; c < NumChannels; c++ )
+			values[c] = 0.;
+		return;
+	}
+
+	int seg = FindSegment( time );
+	float t0 = Times[seg];
+	float t1 = Times[seg+1];
+	float s = ( time - t0 ) / ( t1 - t0 );
+	if( s < 0. )	s = 0.;
+	if( s > 1. )	s = 1.;
+
+	const float *c0 = &Coeffs[ seg*4*NumChannels ];
+	const float *c1 = c0 + NumChannels;
+	const float *c2 = c1 + NumChannels;
+	const float *c3 = c2 + NumChannels;
+	for( int c = 0; c < NumChannels; c++ )
+		values[c] = ( ( c3[c]*s + c2[c] )*s + c1[c] )*s + c0[c];
+}
+
+
+// just one channel's value at a time:
+
+float
+MultiKeytimes::GetValue( float time, int channel )
+{
+	assert( channel >= 0  &&  channel < NumChannels );
+	if( channel < 0  ||  channel >= NumChannels )
+	{
+		fprintf( stderr, "MultiKeytimes::GetValue: there is no channel %d\n", channel );
+		return 0.;
+	}
+
+	float values[16];
+	if( NumChannels > 16 )
+		return Sources[channel].GetValue( time );
+	GetValues( time, values );
+	return values[channel];
+}
+
+
+// were the two tracks authored with exactly the same keys?
+
+bool
+MultiKeytimes::SameKeys( MultiKeytimes &other )
+{
+	return NumChannels == other.NumChannels  &&  SourceKeys == other.SourceKeys;
+}
@@ -0,0 +1,228 @@
+// an obj file read into memory, instead of straight into immediate-mode calls:
+//
+//	ReadObjFile( ) turns the file into a flat list of triangles, each vertex being
+//	8 interleaved floats -- s, t, nx, ny, nz, x, y, z -- which is the GL_T2F_N3F_V3F
+//	layout that glInterleavedArrays( ) takes, so the array can be handed to opengl
+//	as-is (the asset bundle stores exactly this array)
+//
+//	faces with more than 3 vertices are split into a fan, and a vertex with no
+//	normal gets its face's normal, the same as LoadObjFile( ) does
+//
+//	OptimizeObjMesh( ) (in meshopt.cpp) can then weld the shared vertices back together
+//	and add an index list -- DrawObjMesh( ) draws either kind with one glDrawArrays( ) or
+//	glDrawElements( ), and inside glNewList( ) the arrays are copied into the display
+//	list, so they can be freed (or unmapped) once the list is compiled
+
+#include <string.h>
+#include <vector>
+
+
+const int	OBJVERTEXFLOATS = 8;		// s, t, nx, ny, nz, x, y, z
+
+struct ObjMesh
+{
+	int				numVertices;		// 3 per triangle, unless there is an index list
+	int				hasTexCoords;		// != 0 if the file had any vt's in its faces
+	const float *	vertices;			// numVertices x OBJVERTEXFLOATS
+	float *			owned;				// != NULL if vertices was new'ed here, rather than mapped
+	int				numIndices;			// 0 = just draw the vertices in order
+	const GLuint *	indices;			// 3 per triangle
+	GLuint *		ownedIndices;		// != NULL if indices was new'ed here
+};
+
+
+// turn one "v/vt/vn" corner into 0-based indices (-1 = not there):
+// (negative obj indices count back from the end of the list)
+
+char *
+ReadObjCorner( char *p, int nv, int nt, int nn, int *v, int *t, int *n )
+{
+	*v = *t = *n = -1;
+	int i = (int)strtol( p, &p, 10 );
+	*v = ( i < 0 ) ? nv + i : i - 1;
+	if( *p == '/' )
+	{
+		p++;
+		if( *p != '/' )
+		{
+			i = (int)strtol( p, &p, 10 );
+			*t = ( i < 0 ) ? nt + i : i - 1;
+		}
+		if( *p == '/' )
+		{
+			p++;
+			i = (int)strtol( p, &p, 10 );
+			*n = ( i < 0 ) ? nn + i : i - 1;
+		}
+	}
+	return p;
+}
+
+
+// read an obj file into a triangle array:
+// (returns false if the file can't be read)
+
+bool
+ReadObjFile( char *file, struct ObjMesh *mesh )
+{
+	mesh->numVertices = 0;
+	mesh->hasTexCoords = 0;
+	mesh->vertices = NULL;
+	mesh->owned = NULL;
+	mesh->numIndices = 0;
+	mesh->indices = NULL;
+	mesh->ownedIndices = NULL;
+
+	FILE *fp = fopen( file, "r" );
+	if( fp == NULL )
+	{
+		fprintf( stderr, "Cannot open .obj file '%s'\n", file );
+		return false;
+	}
+
+	std::vector<float> V, T, N;
+	std::vector<float> tris;
+	char line[1024];
+	while( fgets( line, sizeof(line), fp ) != NULL )
+	{
+		char *p = line;
+		while( isspace( *p ) )
+			p++;
+
+		if( p[0] == 'v'  &&  isspace( p[1] ) )
+		{
+			float x = 0., y = 0., z = 0.;
+			sscanf( p+2, "%f %f %f", &x, &y, &z );
+			V.push_back( x );	V.push_back( y );	V.push_back( z );
+		}
+		else if( p[0] == 'v'  &&  p[1] == 't'  &&  isspace( p[2] ) )
+		{
+			float s = 0., t = 0.;
+			sscanf( p+3, "%f %f", &s, &t );
+			T.push_back( s );	T.push_back( t );
+		}
+		else if( p[0] == 'v'  &&  p[1] == 'n'  &&  isspace( p[2] ) )
+		{
+			float x = 0., y = 0., z = 0.;
+			sscanf( p+3, "%f %f %f", &x, &y, &z );
+			N.push_back( x );	N.push_back( y );	N.push_back( z );
+		}
+		else if( p[0] == 'f'  &&  isspace( p[1] ) )
+		{
+			int nv = (int)V.size( ) / 3;
+			int nt = (int)T.size( ) / 2;
+			int nn = (int)N.size( ) / 3;
+
+			std::vector<int> vi, ti, ni;
+			p++;
+			while( true )
+			{
+				while( isspace( *p ) )
+					p++;
+				if( *p == '\0'  ||  ! ( isdigit( *p )  ||  *p == '-' ) )
+					break;
+				int v, t, n;
+				p = ReadObjCorner( p, nv, nt, nn, &v, &t, &n );
+				if( v < 0  ||  v >= nv )
+					continue;
+				vi.push_back( v );
+				ti.push_back( ( t >= 0  &&  t < nt ) ? t : -1 );
+				ni.push_back( ( n >= 0  &&  n < nn ) ? n : -1 );
+			}
+
+			for( int k = 1; k+1 < (int)vi.size( ); k++ )
+			{
+				int corner[3] = { 0, k, k+1 };
+
+				float *p0 = &V[ 3*vi[0] ];
+				float *p1 = &V[ 3*vi[k] ];
+				float *p2 = &V[ 3*vi[k+1] ];
+				float e1[3] = { p1[0]-p0[0], p1[1]-p0[1], p1[2]-p0[2] };
+				float e2[3] = { p2[0]-p0[0], p2[1]-p0[1], p2[2]-p0[2] };
+				float fn[3];
+				Cross( e1, e2, fn );
+				Unit( fn );
+
+				for( int m = 0; m < 3; m++ )
+				{
+					int j = corner[m];
+					float s = 0., t = 0.;
+					if( ti[j] >= 0 )
+					{
+						s = T[ 2*ti[j] ];
+						t = T[ 2*ti[j] + 1 ];
+						mesh->hasTexCoords = 1;
+					}
+					const float *nrm = ( ni[j] >= 0 ) ? &N[ 3*ni[j] ] : fn;
+					const float *pos = &V[ 3*vi[j] ];
+
+					tris.push_back( s );		tris.push_back( t );
+					tris.push_back( nrm[0] );	tris.push_back( nrm[1] );	tris.push_back( nrm[2] );
+					tris.push_back( pos[0] );	tris.push_back( pos[1] );	tris.push_back( pos[2] );
+				}
+			}
+		}
+	}
+	fclose( fp );
+
+	mesh->numVertices = (int)tris.size( ) / OBJVERTEXFLOATS;
+	mesh->owned = new float[ tris.size( ) + 1 ];
+	if( ! tris.empty( ) )
+		memcpy( mesh->owned, &tris[0], tris.size( ) * sizeof(float) );
+	mesh->vertices = mesh->owned;
+	return true;
+}
+
+
+void
+FreeObjMesh( struct ObjMesh *mesh )
+{
+	delete [ ] mesh->owned;
+	delete [ ] mesh->ownedIndices;
+	mesh->owned = NULL;
+	mesh->ownedIndices = NULL;
+	mesh->vertices = NULL;
+	mesh->indices = NULL;
+	mesh->numVertices = 0;
+	mesh->numIndices = 0;
+}
+
+
+// draw the triangles with vertex arrays:
+// (a mesh with no texture coordinates leaves the current texture coordinate alone,
+//  just like LoadObjFile( ) does)
+
+void
+DrawObjMesh( const struct ObjMesh *mesh )
+{
+	if( mesh->numVertices == 0 )
+		return;
+
+	GLsizei stride = OBJVERTEXFLOATS * sizeof(float);
+	glPushClientAttrib( GL_CLIENT_VERTEX_ARRAY_BIT );
+		if( mesh->hasTexCoords != 0 )
+		{
+			glInterleavedArrays( GL_T2F_N3F_V3F, 0, mesh->vertices );
+		}
+		else
+		{
+			glEnableClientState( GL_NORMAL_ARRAY );
+			glEnableClientState( GL_VERTEX_ARRAY );
+			glNormalPointer( GL_FLOAT, stride, mesh->vertices + 2 );
+			glVertexPointer( 3, GL_FLOAT, stride, mesh->vertices + 5 );
+		}
+		if( mesh->numIndices > 0 )
+			glDrawElements( GL_TRIANGLES, mesh->numIndices, GL_UNSIGNED_INT, mesh->indices );
+		else
+			glDrawArrays( GL_TRIANGLES, 0, mesh->numVertices );
+	glPopClientAttrib( );
+
+	// the current normal (and texture coordinate) are undefined after drawing from arrays,
+	// so leave them set to the last vertex's, the way glBegin/glEnd would:
+
+	int lastVertex = ( mesh->numIndices > 0 ) ? (int)mesh->indices[ mesh->numIndices - 1 ] : mesh->numVertices - 1;
+	const float *last = mesh->vertices + lastVertex * OBJVERTEXFLOATS;
+	if( mesh->hasTexCoords != 0 )
+		glTexCoord2fv( last );
+	glNormal3fv( last + 2 );
+}
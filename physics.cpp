@@ -0,0 +1,569 @@
+// the ball physics -- a simulated ball that can be played, instead of the hand-authored keys:
+//
+//	with PhysicsOn (the Ball menu, or 'b'), the ball's BallX / BallZ keys are ignored and
+//	the ball is simulated instead, at a fixed PHYSICSHZ steps a second however fast the
+//	frames are drawn -- on a thread of its own (see simthread.cpp)
+//
+//	the ball rolls on the table at the height Display( ) draws it (BALLY), with gravity
+//	pulling it down the tilted table toward the levers (5/7 of it, since a rolling ball
+//	has to spin up too), and a little rolling drag
+//
+//	everything it can hit is the obj meshes themselves -- each mesh's triangles are kept
+//	(after the same rotation and ScaleFactor its display list has) when its list is built,
+//	and TablePieces[ ] places them the same way Display( ) does -- the ball is a sphere,
+//	and a contact is its center's closest point on a triangle:
+//
+//		a contact whose normal is mostly vertical is something the ball rolls on (or
+//		under), and is ignored -- the rest push the ball back out along the table, and
+//		bounce it with the piece's restitution (and friction along the surface, as much
+//		as the hit was hard)
+//
+//		the moving pieces (the levers, the plunger, the spinning star and cross) are
+//		hit with their own velocity taken into account, so a lever or the plunger can
+//		throw the ball -- and the bumpers kick it away a bit harder than it came in
+//
+//	with FieldOn (the Collision menu), a mesh that has a distance field (distancefield.cpp)
+//	is hit through that instead -- a lookup or two per piece, instead of every triangle
+//	near the ball
+//
+//	the levers and the plunger are the player's, through the key events (tableinput.cpp):
+//
+//		'z' and '/'		hold to raise the left and right levers
+//		space			hold to pull the plunger back, let go to launch
+//
+//	a ball that drains past the levers (or somehow gets out of the table) starts over
+//	on the plunger
+//
+//	StepTable( ) only reads the collision meshes and writes the TableState it is given,
+//	so it doesn't need gl, or the main thread
+
+#include <math.h>
+
+
+const double	PHYSICSHZ = 1000.;
+const float		PHYSICSDT = (float)( 1. / PHYSICSHZ );
+const int		MAXPHYSICSSTEPS = 100;			// a frame after a long stall doesn't try to catch up past this
+
+// the table is about 12 units across -- about 60 cm, so a unit is 5 cm:
+
+const float		GRAVITY = 196.f;				// units / second^2
+const float		TABLETILT = 6.5f;				// degrees, down toward +z
+const float		ROLLINGFACTOR = 5.f / 7.f;		// a rolling solid sphere gets this much of the pull
+const float		ROLLINGDRAG = 0.1f;				// fraction of the speed lost per second
+const float		SURFACEFRICTION = 0.2f;			// coefficient of friction in a hit
+const float		MINHORIZONTAL = 0.5f;			// contacts with less of their normal along the table are ignored
+const int		FIELDCONTACTS = 3;				// distance field lookups per piece per step, at most
+const float		SPHEREINERTIA = 0.4f;			// a solid sphere's moment of inertia is this times m r^2
+
+const float		BALLRADIUS = 0.35f;
+const float		BALLY = 1.8f;
+const float		BALLSTARTX = 4.95f;				// on the plunger
+const float		BALLSTARTZ = 4.3f;
+const float		DRAINZ = 7.f;
+const float		TABLELIMIT = 12.f;				// farther than this from the center means it escaped
+
+const float		LEVERLEFTUP = -35.f;			// degrees, the same as the Levers keys
+const float		LEVERRIGHTUP = 30.f;
+const float		LEVERSPEED = 1400.f;			// degrees / second
+const float		PLUNGERREST = 6.f;
+const float		PLUNGERPULLED = 7.5f;
+const float		PLUNGERPULLSPEED = 1.5f;		// units / second
+const float		PLUNGERSPRING = 20.f;			// released, its speed is this times how far back it is
+const float		STARSPIN = -270.f;				// degrees / second
+const float		CROSSSPIN = 40.f;
+
+enum PieceMotion
+{
+	PIECEFIXED,
+	PIECESTAR,
+	PIECECROSS,
+	PIECELEVERLEFT,
+	PIECELEVERRIGHT,
+	PIECEPLUNGER
+};
+
+// one obj mesh placed on the table -- where Display( ) translates it to, and the fixed
+// rotation about y it gets after any animated one:
+
+struct TablePiece
+{
+	GLuint *	list;
+	float		x, y, z;
+	float		yaw;
+	int			motion;
+	float		restitution;
+	float		kick;					// extra speed away from the piece on a hit, units / second
+	const char *name;					// for reports
+};
+
+struct TablePiece	TablePieces[ ] =
+{
+	{ &TopPlateDL,			 0.f,	0.f,	 0.f,	   0.f,	PIECEFIXED,			.5f,	 0.f,	"walls" },
+	{ &TriangleStaticDL,	 2.6f,	BALLY,	 2.9f,	   0.f,	PIECEFIXED,			.6f,	 6.f,	"triangle" },
+	{ &CircleStaticDL,		 2.4f,	BALLY,	-0.5f,	   0.f,	PIECEFIXED,			.6f,	10.f,	"right circle" },
+	{ &CircleStaticDL,		-2.4f,	BALLY,	-0.5f,	   0.f,	PIECEFIXED,			.6f,	10.f,	"left circle" },
+	{ &CrossDL,				 0.f,	BALLY,	-3.f,	   0.f,	PIECECROSS,			.5f,	 0.f,	"cross" },
+	{ &StarDL,				-3.5f,	BALLY,	 2.7f,	   0.f,	PIECESTAR,			.5f,	 0.f,	"star" },
+	{ &LeverDL,				-2.f,	BALLY,	 5.26f,	-130.f,	PIECELEVERLEFT,		.3f,	 0.f,	"left lever" },
+	{ &LeverDL,				 0.97f,	BALLY,	 5.26f,	 130.f,	PIECELEVERRIGHT,	.3f,	 0.f,	"right lever" },
+	{ &PlungerDL,			 4.95f,	BALLY,	 0.f,	   0.f,	PIECEPLUNGER,		.2f,	 0.f,	"plunger" },
+};
+
+const int	NUMTABLEPIECES = sizeof(TablePieces) / sizeof(struct TablePiece);
+
+// an obj mesh's triangles, the way its display list draws them:
+
+struct CollisionMesh
+{
+	int							numTriangles;
+	struct CollisionTriangle *	triangles;
+	float						radius;			// of all of it in x and z, around its origin
+	struct DistanceField		field;
+};
+
+struct CollisionMesh	CollisionMeshes[NUMMESHLISTS];
+
+struct Ball
+{
+	float		x, z;
+	float		vx, vz;
+};
+
+struct TableInput
+{
+	bool		leftLever;
+	bool		rightLever;
+	bool		plunger;
+};
+
+struct TableState
+{
+	struct Ball			ball;
+	float				leverL, leverR;			// degrees, the way Display( ) rotates them
+	float				leverLVel, leverRVel;	// degrees / second
+	float				plungerZ;
+	float				plungerVel;
+	float				starRot, crossRot;
+	struct TableInput	input;
+	double				time;					// seconds simulated
+	int					drains;
+	unsigned int		touching;				// bit i: the ball is touching TablePieces[i]
+	int					hits[NUMTABLEPIECES];	// how many times the ball has started touching each
+};
+
+int					PhysicsOn = 0;			// != 0 means the ball is simulated
+struct TableState	Table;
+
+
+// the rotation and scale a mesh's display list is built with, the way glRotatef( ) and
+// glScalef( ) would leave them on the matrix stack (column-major) -- worked out here instead,
+// so the collision meshes can be built without gl (see simulate.cpp):
+
+void
+MeshMatrix( const struct MeshList *ml, float m[16] )
+{
+	float x = 0.f, y = 0.f, z = 0.f;
+	float c = 1.f, s = 0.f;
+	if( ml->angle != 0. )
+	{
+		float length = sqrtf( ml->ax*ml->ax + ml->ay*ml->ay + ml->az*ml->az );
+		x = ml->ax / length;
+		y = ml->ay / length;
+		z = ml->az / length;
+		c = cosf( ml->angle * F_PI / 180.f );
+		s = sinf( ml->angle * F_PI / 180.f );
+	}
+	float r[3][3] =
+	{
+		{ x*x*(1.f-c) + c,		x*y*(1.f-c) - z*s,	x*z*(1.f-c) + y*s },
+		{ y*x*(1.f-c) + z*s,	y*y*(1.f-c) + c,	y*z*(1.f-c) - x*s },
+		{ z*x*(1.f-c) - y*s,	z*y*(1.f-c) + x*s,	z*z*(1.f-c) + c   },
+	};
+	for( int col = 0; col < 4; col++ )
+	{
+		for( int row = 0; row < 4; row++ )
+		{
+			if( col < 3  &&  row < 3 )
+				m[4*col + row] = r[row][col] * (float)ScaleFactor;
+			else
+				m[4*col + row] = ( col == row ) ? 1.f : 0.f;
+		}
+	}
+}
+
+
+// keep an obj mesh's triangles for the ball to hit:
+// (called when its display list is built -- the same rotation and scale are applied)
+
+void
+BuildCollisionMesh( struct MeshList *ml, const struct ObjMesh *mesh )
+{
+	struct CollisionMesh *cm = &CollisionMeshes[ ml - MeshLists ];
+	delete [ ] cm->triangles;
+	FreeDistanceField( &cm->field );
+	cm->numTriangles = 0;
+	cm->triangles = NULL;
+	cm->radius = 0.f;
+
+	int numCorners = ( mesh->numIndices > 0 ) ? mesh->numIndices : mesh->numVertices;
+	if( numCorners < 3 )
+		return;
+
+	float m[16];
+	MeshMatrix( ml, m );
+
+	cm->numTriangles = numCorners / 3;
+	cm->triangles = new struct CollisionTriangle[ cm->numTriangles ];
+	for( int t = 0; t < cm->numTriangles; t++ )
+	{
+		struct CollisionTriangle *tri = &cm->triangles[t];
+		for( int k = 0; k < 3; k++ )
+		{
+			int i = 3*t + k;
+			int vertex = ( mesh->numIndices > 0 ) ? (int)mesh->indices[i] : i;
+			const float *p = &mesh->vertices[ vertex*OBJVERTEXFLOATS + 5 ];
+			for( int j = 0; j < 3; j++ )
+				tri->v[k][j] = m[j]*p[0] + m[4+j]*p[1] + m[8+j]*p[2] + m[12+j];
+
+			float r = sqrtf( tri->v[k][0]*tri->v[k][0] + tri->v[k][2]*tri->v[k][2] );
+			if( r > cm->radius )
+				cm->radius = r;
+		}
+		for( int j = 0; j < 3; j++ )
+		{
+			tri->min[j] = fminf( tri->v[0][j], fminf( tri->v[1][j], tri->v[2][j] ) );
+			tri->max[j] = fmaxf( tri->v[0][j], fmaxf( tri->v[1][j], tri->v[2][j] ) );
+		}
+	}
+
+	BuildDistanceField( ml->file, cm->triangles, cm->numTriangles, &cm->field );
+}
+
+
+// a piece's triangles (NULL if its mesh isn't one of MeshLists[ ]):
+
+const struct CollisionMesh *
+PieceMesh( const struct TablePiece *piece )
+{
+	for( int i = 0; i < NUMMESHLISTS; i++ )
+	{
+		if( MeshLists[i].list == piece->list )
+			return &CollisionMeshes[i];
+	}
+	return NULL;
+}
+
+
+// where a piece is right now -- its position in x and z, its rotation about y in degrees,
+// and how fast it is turning (radians / second) and sliding in z:
+
+void
+PiecePose( const struct TableState *s, const struct TablePiece *piece, float *x, float *z, float *yaw,
+	float *spin, float *vz )
+{
+	*x = piece->x;
+	*z = piece->z;
+	*yaw = piece->yaw;
+	*spin = 0.f;
+	*vz = 0.f;
+	const float toRadians = F_PI / 180.f;
+	switch( piece->motion )
+	{
+		case PIECESTAR:
+			*yaw += s->starRot;
+			*spin = STARSPIN * toRadians;
+			break;
+
+		case PIECECROSS:
+			*yaw += s->crossRot;
+			*spin = CROSSSPIN * toRadians;
+			break;
+
+		case PIECELEVERLEFT:
+			*yaw += s->leverL;
+			*spin = s->leverLVel * toRadians;
+			break;
+
+		case PIECELEVERRIGHT:
+			*yaw += s->leverR;
+			*spin = s->leverRVel * toRadians;
+			break;
+
+		case PIECEPLUNGER:
+			*z = s->plungerZ;
+			*vz = s->plungerVel;
+			break;
+	}
+}
+
+
+// where a piece is, and how it is moving, for the contacts with it this step:
+
+struct PieceFrame
+{
+	float		x, z;
+	float		c, s;					// cosine and sine of its yaw
+	float		spin;					// radians / second
+	float		vz;
+};
+
+
+// where a piece is, and how it is moving, this step:
+
+void
+PieceFrameAt( const struct TableState *s, const struct TablePiece *piece, struct PieceFrame *f )
+{
+	float yaw;
+	PiecePose( s, piece, &f->x, &f->z, &yaw, &f->spin, &f->vz );
+	f->c = cosf( yaw * F_PI / 180.f );
+	f->s = sinf( yaw * F_PI / 180.f );
+}
+
+
+// push a ball out of a piece along (lx, lz) in the piece's space, and bounce it:
+// (center, the ball's center in the piece's space, is moved out too -- and if the ball's
+// spin about the vertical is kept, spin is it, and the surface friction changes it)
+
+void
+PushBall( struct Ball *ball, float *spin, const struct TablePiece *piece, const struct PieceFrame *f,
+	float center[3], float lx, float lz, float depth )
+{
+	// push the ball out (in both spaces, so the next contact sees where it is now):
+
+	center[0] += depth * lx;
+	center[2] += depth * lz;
+	float nx = f->c*lx + f->s*lz;
+	float nz = -f->s*lx + f->c*lz;
+	ball->x += depth * nx;
+	ball->z += depth * nz;
+
+	// the velocity of the piece's surface where the ball touches it:
+
+	float rx = ball->x - BALLRADIUS*nx - f->x;
+	float rz = ball->z - BALLRADIUS*nz - f->z;
+	float sx = f->spin * rz;
+	float sz = -f->spin * rx + f->vz;
+
+	float vx = ball->vx - sx;
+	float vz = ball->vz - sz;
+	float vn = vx*nx + vz*nz;
+	if( vn >= 0.f )
+		return;			// already moving away
+	float tx = vx - vn*nx;
+	float tz = vz - vn*nz;
+
+	// (a spinning ball's own surface slides along the piece's too)
+	float slipx = tx, slipz = tz;
+	if( spin != NULL )
+	{
+		slipx -= *spin * BALLRADIUS * nz;
+		slipz += *spin * BALLRADIUS * nx;
+	}
+
+	// friction takes away speed along the surface in proportion to how hard the hit was:
+
+	// (at most enough to stop the sliding -- a spinning ball's spin takes some of that up)
+	float vt = sqrtf( slipx*slipx + slipz*slipz );
+	float loss = SURFACEFRICTION * ( 1.f + piece->restitution ) * -vn;
+	float most = ( spin != NULL ) ? SPHEREINERTIA / ( 1.f + SPHEREINERTIA ) : 1.f;
+	float lose = ( vt > loss ) ? fminf( loss / vt, most ) : most;
+	vn = -piece->restitution * vn + piece->kick;
+	ball->vx = sx + tx - lose*slipx + vn*nx;
+	ball->vz = sz + tz - lose*slipz + vn*nz;
+	if( spin != NULL )
+		*spin += ( nx * -lose*slipz - nz * -lose*slipx ) / ( SPHEREINERTIA * BALLRADIUS );
+}
+
+
+// push a ball along the table away from a contact whose normal (surface to center, in the
+// piece's space) is n and whose distance is dist, unless it is mostly vertical:
+// (returns false if it was)
+
+bool
+PushBallFrom( struct Ball *ball, float *spin, const struct TablePiece *piece, const struct PieceFrame *f,
+	float center[3], const float n[3], float dist )
+{
+	float length = sqrtf( n[0]*n[0] + n[1]*n[1] + n[2]*n[2] );
+	if( length == 0.f )
+		return false;
+
+	// only the part of the normal along the table counts:
+
+	float horizontal = sqrtf( n[0]*n[0] + n[2]*n[2] ) / length;
+	if( horizontal < MINHORIZONTAL )
+		return false;
+	float lx = n[0] / ( horizontal * length );
+	float lz = n[2] / ( horizontal * length );
+	PushBall( ball, spin, piece, f, center, lx, lz, ( BALLRADIUS - dist ) * horizontal );
+	return true;
+}
+
+
+// the ball's center in a piece's own space (the inverse of glRotatef( yaw, 0., 1., 0. )):
+
+inline void
+PieceSpace( const struct Ball *ball, const struct TablePiece *piece, const struct PieceFrame *f, float center[3] )
+{
+	float dx = ball->x - f->x;
+	float dz = ball->z - f->z;
+	center[0] = f->c*dx - f->s*dz;
+	center[1] = BALLY - piece->y;
+	center[2] = f->s*dx + f->c*dz;
+}
+
+
+// bounce a ball off one piece, if it is touching it:
+// (with the piece's distance field, if it has one and FieldOn, else its triangles --
+//  returns true if it was touching)
+
+bool
+CollidePiece( struct Ball *ball, float *spin, const struct TablePiece *piece, const struct PieceFrame *f,
+	const struct CollisionMesh *cm )
+{
+	float dx = ball->x - f->x;
+	float dz = ball->z - f->z;
+	float reach = cm->radius + BALLRADIUS;
+	if( dx*dx + dz*dz > reach*reach )
+		return false;
+
+	float center[3];
+	bool touched = false;
+	PieceSpace( ball, piece, f, center );
+
+	// the field only says how far the nearest surface is, so in a corner it takes a look for
+	// each side (after being pushed off the nearest, the next nearest is the other):
+
+	if( FieldOn != 0  &&  cm->field.brickIndex != NULL )
+	{
+		for( int i = 0; i < FIELDCONTACTS; i++ )
+		{
+			float gradient[3];
+			float dist = FieldDistance( &cm->field, center, gradient );
+			if( dist >= BALLRADIUS )
+				break;
+			float before[2] = { center[0], center[2] };
+			if( PushBallFrom( ball, spin, piece, f, center, gradient, dist ) )
+				touched = true;
+			if( center[0] == before[0]  &&  center[2] == before[1] )
+				break;
+		}
+		return touched;
+	}
+
+	for( int t = 0; t < cm->numTriangles; t++ )
+	{
+		const struct CollisionTriangle *tri = &cm->triangles[t];
+		if( center[0] + BALLRADIUS < tri->min[0]  ||  center[0] - BALLRADIUS > tri->max[0]
+		 || center[1] + BALLRADIUS < tri->min[1]  ||  center[1] - BALLRADIUS > tri->max[1]
+		 || center[2] + BALLRADIUS < tri->min[2]  ||  center[2] - BALLRADIUS > tri->max[2] )
+			continue;
+
+		float q[3];
+		ClosestOnTriangle( center, tri->v[0], tri->v[1], tri->v[2], q );
+		float n[3] = { center[0] - q[0], center[1] - q[1], center[2] - q[2] };
+		float dist = sqrtf( Dot( n, n ) );
+		if( dist < BALLRADIUS  &&  PushBallFrom( ball, spin, piece, f, center, n, dist ) )
+			touched = true;
+	}
+	return touched;
+}
+
+
+// put the ball back on the plunger:
+
+void
+ServeBall( struct TableState *s )
+{
+	s->ball.x = BALLSTARTX;
+	s->ball.z = BALLSTARTZ;
+	s->ball.vx = s->ball.vz = 0.f;
+}
+
+
+void
+ResetTable( struct TableState *s )
+{
+	memset( s, 0, sizeof(*s) );
+	s->plungerZ = PLUNGERREST;
+	ServeBall( s );
+}
+
+
+// swing a lever toward up or down:
+
+void
+MoveLever( float *angle, float *vel, bool up, float upAngle, float dt )
+{
+	float target = up ? upAngle : 0.f;
+	float step = LEVERSPEED * dt;
+	float d = target - *angle;
+	if( fabsf( d ) <= step )
+	{
+		*vel = d / dt;
+		*angle = target;
+	}
+	else
+	{
+		*vel = ( d > 0.f ) ? LEVERSPEED : -LEVERSPEED;
+		*angle += *vel * dt;
+	}
+}
+
+
+// one fixed step of everything:
+
+void
+StepTable( struct TableState *s, float dt )
+{
+	MoveLever( &s->leverL, &s->leverLVel, s->input.leftLever, LEVERLEFTUP, dt );
+	MoveLever( &s->leverR, &s->leverRVel, s->input.rightLever, LEVERRIGHTUP, dt );
+
+	if( s->input.plunger )
+		s->plungerVel = ( s->plungerZ < PLUNGERPULLED ) ? PLUNGERPULLSPEED : 0.f;
+	else
+		s->plungerVel = ( s->plungerZ > PLUNGERREST ) ? -PLUNGERSPRING * ( s->plungerZ - PLUNGERREST ) : 0.f;
+	s->plungerZ += s->plungerVel * dt;
+	if( s->plungerZ > PLUNGERPULLED )
+		s->plungerZ = PLUNGERPULLED;
+	if( s->plungerZ < PLUNGERREST + 0.001f  &&  ! s->input.plunger )
+		s->plungerZ = PLUNGERREST;
+
+	s->starRot = fmodf( s->starRot + STARSPIN * dt, 360.f );
+	s->crossRot = fmodf( s->crossRot + CROSSSPIN * dt, 360.f );
+
+	struct Ball *ball = &s->ball;
+	const float pull = GRAVITY * sinf( TABLETILT * F_PI / 180.f ) * ROLLINGFACTOR;
+	ball->vz += pull * dt;
+	ball->vx *= 1.f - ROLLINGDRAG * dt;
+	ball->vz *= 1.f - ROLLINGDRAG * dt;
+	ball->x += ball->vx * dt;
+	ball->z += ball->vz * dt;
+
+	for( int i = 0; i < NUMTABLEPIECES; i++ )
+	{
+		const struct CollisionMesh *cm = PieceMesh( &TablePieces[i] );
+		if( cm != NULL  &&  cm->numTriangles > 0 )
+		{
+			struct PieceFrame f;
+			PieceFrameAt( s, &TablePieces[i], &f );
+			bool touching = CollidePiece( ball, NULL, &TablePieces[i], &f, cm );
+
+			// (a hit is counted when the touching starts, not for every step of it)
+			unsigned int bit = 1u << i;
+			if( touching  &&  ( s->touching & bit ) == 0 )
+				s->hits[i]++;
+			s->touching = touching ? ( s->touching | bit ) : ( s->touching & ~bit );
+		}
+	}
+
+	// drained, or got out somehow:
+
+	bool lost = !( fabsf( ball->x ) < TABLELIMIT  &&  fabsf( ball->z ) < TABLELIMIT );
+	if( lost  ||  ( ball->z > DRAINZ  &&  ball->x < BALLSTARTX - 2.f*BALLRADIUS ) )
+	{
+		s->drains++;
+		ServeBall( s );
+	}
+	s->time += dt;
+}
+
@@ -0,0 +1,341 @@
+// quantized vertex buffers for the static obj meshes:
+//
+//	a float vertex with a position and a normal is 24 bytes -- these are 12:
+//
+//		position:	3 x 16-bit signed normalized, plus 16 bits of padding, in the mesh's
+//					own bounding box (each mesh gets an offset and scale that the vertex
+//					shader uses to turn [-1.,1.] back into obj coordinates)
+//		normal:		2 x 16-bit signed normalized, octahedral encoded (the unit sphere
+//					is folded onto an octahedron and flattened into a square)
+//
+//	the texture coordinates are left out, since none of the obj meshes are drawn
+//	with texturing turned on
+//
+//	this is one of the two vertex formats the buffer renderer (vertexbuffer.cpp) can
+//	draw the meshes with -- QuantizedOn picks it over the float vertex buffers
+//
+//	the draw queue (drawqueue.cpp) draws them between BeginQuantizedDraws( ) and
+//	EndQuantizedDraws( ), and picks each one's material out of the Materials uniform
+//	block with SetQuantizedMaterial( ) -- or, with -1, has it use gl_FrontMaterial
+//
+//	every mesh is decoded again on the cpu with the same math the shader uses and
+//	compared with the float vertices -- a mesh whose worst position error (after
+//	ScaleFactor, so in scene units) or worst normal error is over the tolerance
+//	below is not used, and keeps being drawn from its float vertices
+
+
+const float	QUANTPOSITIONTOLERANCE = 0.001f;	// scene units
+const float	QUANTNORMALTOLERANCE   = 0.1f;		// degrees
+
+const GLuint	QUANTPOSITIONLOC = 1;			// attribute locations (stay away from 0)
+const GLuint	QUANTNORMALLOC   = 2;
+const int		MATERIALBLOCKSIZE = 64;			// the materials in the Materials block (the 64 in QuantizedVertexShader)
+
+struct QuantizedVertex
+{
+	GLshort		position[4];			// x, y, z, (padding)
+	GLshort		normal[2];				// octahedral
+};
+
+struct QuantizedMesh
+{
+	bool		ok;						// != 0 if it was built and passed the accuracy check
+	GLuint		vao;
+	GLuint		vertexBuffer;
+	GLuint		indexBuffer;
+	int			numVertices;
+	int			numIndices;
+	float		offset[3];				// obj position = offset + scale * decoded position
+	float		scale[3];
+	float		lastNormal[3];			// the normal of the last vertex drawn
+	float		positionError;			// the worst errors the check found
+	float		normalError;
+};
+
+int			QuantizedOn = 1;			// != 0 means the buffer renderer draws the meshes quantized
+GLuint		QuantizedProgram;
+GLint		QuantizedOffsetLoc;
+GLint		QuantizedScaleLoc;
+GLint		QuantizedLightOnLoc;
+GLint		QuantizedFogOnLoc;
+GLint		QuantizedMaterialLoc;
+
+const char *QuantizedVertexShader =
+	"attribute vec4 aPosition;\n"
+	"attribute vec2 aNormal;\n"
+	"uniform vec3 uOffset;\n"
+	"uniform vec3 uScale;\n"
+	"uniform int uMaterial;\n"
+	"#ifdef GL_ARB_uniform_buffer_object\n"
+	"layout( std140 ) uniform Materials\n"
+	"{\n"
+	"	FixedMaterial uMaterials[64];\n"
+	"};\n"
+	"#endif\n"
+	"void main( )\n"
+	"{\n"
+	"	vec3 n = vec3( aNormal.xy, 1. - abs( aNormal.x ) - abs( aNormal.y ) );\n"
+	"	float t = max( -n.z, 0. );\n"
+	"	n.x += ( n.x >= 0. ) ? -t : t;\n"
+	"	n.y += ( n.y >= 0. ) ? -t : t;\n"
+	"	vec4 eye = gl_ModelViewMatrix * vec4( uOffset + uScale * aPosition.xyz, 1. );\n"
+	"	n = normalize( gl_NormalMatrix * normalize( n ) );\n"
+	"#ifdef GL_ARB_uniform_buffer_object\n"
+	"	if( uMaterial >= 0 )\n"
+	"		gl_FrontColor = FixedLighting( eye.xyz, n, uMaterials[uMaterial] );\n"
+	"	else\n"
+	"#endif\n"
+	"		gl_FrontColor = FixedLighting( eye.xyz, n );\n"
+	"	vFogCoord = abs( eye.z );\n"
+	"	gl_Position = gl_ProjectionMatrix * eye;\n"
+	"}\n";
+
+
+// float <-> 16-bit signed normalized, the way opengl 4.2 and later decode it:
+
+GLshort
+EncodeSnorm16( float f )
+{
+	if( f < -1. )	f = -1.;
+	if( f >  1. )	f =  1.;
+	return (GLshort)floorf( f * 32767.f + 0.5f );
+}
+
+
+float
+DecodeSnorm16( GLshort s )
+{
+	float f = (float)s / 32767.f;
+	return ( f < -1. ) ? -1.f : f;
+}
+
+
+// the octahedral mapping, both ways:
+
+void
+OctDecode( float u, float v, float n[3] )
+{
+	n[0] = u;
+	n[1] = v;
+	n[2] = 1.f - fabsf( u ) - fabsf( v );
+	float t = ( -n[2] > 0. ) ? -n[2] : 0.f;
+	n[0] += ( n[0] >= 0. ) ? -t : t;
+	n[1] += ( n[1] >= 0. ) ? -t : t;
+	Unit( n );
+}
+
+
+// (rounding each of u and v to the nearest step isn't always the closest encoding,
+//  so all 4 neighboring steps are tried and the best is kept)
+
+void
+OctEncode( const float nIn[3], GLshort out[2] )
+{
+	float n[3] = { nIn[0], nIn[1], nIn[2] };
+	float l1 = fabsf( n[0] ) + fabsf( n[1] ) + fabsf( n[2] );
+	if( l1 == 0. )
+	{
+		out[0] = out[1] = 0;
+		return;
+	}
+	float u = n[0] / l1;
+	float v = n[1] / l1;
+	if( n[2] < 0. )
+	{
+		float fu = ( 1.f - fabsf( v ) ) * ( u >= 0. ? 1.f : -1.f );
+		float fv = ( 1.f - fabsf( u ) ) * ( v >= 0. ? 1.f : -1.f );
+		u = fu;
+		v = fv;
+	}
+	Unit( n );
+
+	float best = -2.;
+	for( int i = 0; i < 4; i++ )
+	{
+		float su = ( ( i & 1 ) ? ceilf( u * 32767.f ) : floorf( u * 32767.f ) ) / 32767.f;
+		float sv = ( ( i & 2 ) ? ceilf( v * 32767.f ) : floorf( v * 32767.f ) ) / 32767.f;
+		GLshort eu = EncodeSnorm16( su );
+		GLshort ev = EncodeSnorm16( sv );
+		float d[3];
+		OctDecode( DecodeSnorm16( eu ), DecodeSnorm16( ev ), d );
+		float cosine = Dot( d, n );
+		if( cosine > best )
+		{
+			best = cosine;
+			out[0] = eu;
+			out[1] = ev;
+		}
+	}
+}
+
+
+void
+InitQuantized( )
+{
+	const char *attributes[2] = { "aPosition", "aNormal" };
+	QuantizedProgram = MakeFixedFunctionProgram( "Quantized mesh", QuantizedVertexShader, attributes, 2, QUANTPOSITIONLOC );
+	QuantizedOffsetLoc  = glGetUniformLocation( QuantizedProgram, "uOffset" );
+	QuantizedScaleLoc   = glGetUniformLocation( QuantizedProgram, "uScale" );
+	QuantizedLightOnLoc = glGetUniformLocation( QuantizedProgram, "uLightOn" );
+	QuantizedFogOnLoc   = glGetUniformLocation( QuantizedProgram, "uFogOn" );
+	QuantizedMaterialLoc = glGetUniformLocation( QuantizedProgram, "uMaterial" );
+}
+
+
+// quantize a mesh, check it against the floats, and put it in buffer objects:
+// (worldScale is what the mesh gets scaled by when it is drawn, so the position error
+//  can be checked in scene units)
+
+void
+BuildQuantizedMesh( const char *name, const struct ObjMesh *mesh, float worldScale, struct QuantizedMesh *qm )
+{
+	qm->ok = false;
+	if( mesh->numVertices == 0 )
+		return;
+	if( QuantizedProgram == 0 )
+		InitQuantized( );
+
+	// the mesh's box becomes [-1.,1.] in x, y, and z:
+
+	struct BoundingBox box;
+	InitBox( &box );
+	for( int i = 0; i < mesh->numVertices; i++ )
+	{
+		const float *p = &mesh->vertices[ i*OBJVERTEXFLOATS + 5 ];
+		ExpandBox( &box, p[0], p[1], p[2] );
+	}
+	float mins[3] = { box.xmin, box.ymin, box.zmin };
+	float maxs[3] = { box.xmax, box.ymax, box.zmax };
+	for( int k = 0; k < 3; k++ )
+	{
+		qm->offset[k] = ( mins[k] + maxs[k] ) / 2.f;
+		qm->scale[k]  = ( maxs[k] - mins[k] ) / 2.f;
+		if( qm->scale[k] == 0. )
+			qm->scale[k] = 1.;
+	}
+
+	// encode, and decode again to check:
+
+	struct QuantizedVertex *qv = new struct QuantizedVertex[ mesh->numVertices ];
+	qm->positionError = 0.;
+	qm->normalError = 0.;
+	for( int i = 0; i < mesh->numVertices; i++ )
+	{
+		const float *nrm = &mesh->vertices[ i*OBJVERTEXFLOATS + 2 ];
+		const float *pos = &mesh->vertices[ i*OBJVERTEXFLOATS + 5 ];
+		for( int k = 0; k < 3; k++ )
+		{
+			qv[i].position[k] = EncodeSnorm16( ( pos[k] - qm->offset[k] ) / qm->scale[k] );
+			float back = qm->offset[k] + qm->scale[k] * DecodeSnorm16( qv[i].position[k] );
+			float err = fabsf( back - pos[k] ) * worldScale;
+			if( err > qm->positionError )
+				qm->positionError = err;
+		}
+		qv[i].position[3] = 0;
+
+		OctEncode( nrm, qv[i].normal );
+		float n[3] = { nrm[0], nrm[1], nrm[2] };
+		if( Unit( n ) > 0. )
+		{
+			float d[3];
+			OctDecode( DecodeSnorm16( qv[i].normal[0] ), DecodeSnorm16( qv[i].normal[1] ), d );
+			float cosine = Dot( d, n );
+			if( cosine > 1. )
+				cosine = 1.;
+			float degrees = acosf( cosine ) * 180.f / F_PI;
+			if( degrees > qm->normalError )
+				qm->normalError = degrees;
+		}
+	}
+
+	int floatBytes = mesh->numVertices * 6 * sizeof(float);
+	int quantBytes = mesh->numVertices * sizeof(struct QuantizedVertex);
+	bool passed = ( qm->positionError <= QUANTPOSITIONTOLERANCE  &&  qm->normalError <= QUANTNORMALTOLERANCE );
+	if( DebugOn != 0  ||  ! passed )
+		fprintf( stderr, "Quantized '%s': %d -> %d vertex bytes, worst position error %.2g, worst normal error %.2g degrees%s\n",
+			name, floatBytes, quantBytes, qm->positionError, qm->normalError, passed ? "" : " -- TOO BIG, drawing it with floats" );
+	if( ! passed )
+	{
+		delete [ ] qv;
+		return;
+	}
+
+	// the index list -- a mesh that wasn't indexed gets 0, 1, 2, ...:
+
+	qm->numVertices = mesh->numVertices;
+	qm->numIndices = ( mesh->numIndices > 0 ) ? mesh->numIndices : mesh->numVertices;
+	GLuint *indices = new GLuint[ qm->numIndices ];
+	for( int i = 0; i < qm->numIndices; i++ )
+		indices[i] = ( mesh->numIndices > 0 ) ? mesh->indices[i] : (GLuint)i;
+	const float *last = &mesh->vertices[ indices[ qm->numIndices - 1 ] * OBJVERTEXFLOATS + 2 ];
+	qm->lastNormal[0] = last[0];
+	qm->lastNormal[1] = last[1];
+	qm->lastNormal[2] = last[2];
+
+	glGenVertexArrays( 1, &qm->vao );
+	glGenBuffers( 1, &qm->vertexBuffer );
+	glGenBuffers( 1, &qm->indexBuffer );
+
+	glBindVertexArray( qm->vao );
+	glBindBuffer( GL_ARRAY_BUFFER, qm->vertexBuffer );
+	glBufferData( GL_ARRAY_BUFFER, quantBytes, qv, GL_STATIC_DRAW );
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, qm->indexBuffer );
+	glBufferData( GL_ELEMENT_ARRAY_BUFFER, qm->numIndices * sizeof(GLuint), indices, GL_STATIC_DRAW );
+
+	glEnableVertexAttribArray( QUANTPOSITIONLOC );
+	glEnableVertexAttribArray( QUANTNORMALLOC );
+	glVertexAttribPointer( QUANTPOSITIONLOC, 4, GL_SHORT, GL_TRUE, sizeof(struct QuantizedVertex), (void *)0 );
+	glVertexAttribPointer( QUANTNORMALLOC,   2, GL_SHORT, GL_TRUE, sizeof(struct QuantizedVertex), (void *)( 4*sizeof(GLshort) ) );
+
+	glBindVertexArray( 0 );
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+
+	delete [ ] qv;
+	delete [ ] indices;
+	qm->ok = true;
+}
+
+
+// make the quantized program current, with the lights and fog as they are now:
+// (its meshes use gl_FrontMaterial until SetQuantizedMaterial( ) says otherwise)
+
+void
+BeginQuantizedDraws( )
+{
+	glUseProgram( QuantizedProgram );
+	SetFixedFunctionUniforms( QuantizedLightOnLoc, QuantizedFogOnLoc );
+	glUniform1i( QuantizedMaterialLoc, -1 );
+}
+
+
+// use one of the Materials block's materials (-1 means gl_FrontMaterial):
+
+void
+SetQuantizedMaterial( int material )
+{
+	glUniform1i( QuantizedMaterialLoc, material );
+}
+
+
+// draw a quantized mesh with the current modelview and lights
+// (between BeginQuantizedDraws( ) and EndQuantizedDraws( )):
+
+void
+DrawQuantizedMesh( const struct QuantizedMesh *qm )
+{
+	glUniform3fv( QuantizedOffsetLoc, 1, qm->offset );
+	glUniform3fv( QuantizedScaleLoc, 1, qm->scale );
+
+	glBindVertexArray( qm->vao );
+	glDrawElements( GL_TRIANGLES, qm->numIndices, GL_UNSIGNED_INT, (void *)0 );
+	CountDraw( qm->numIndices );
+}
+
+
+void
+EndQuantizedDraws( )
+{
+	glBindVertexArray( 0 );
+	glUseProgram( 0 );
+}
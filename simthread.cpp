@@ -0,0 +1,431 @@
+// the simulation thread -- the physics stepped on a thread of its own, apart from the drawing:
+//
+//	with PhysicsOn and a window, StepTable( ) and StepMultiball( ) run on SimThread at a
+//	fixed PHYSICSHZ by the steady clock, however long the frames take to draw -- a slow
+//	frame can't hold the game up, and the steps aren't bunched up behind the frames
+//
+//	after every step the thread publishes a TableSnapshot -- what is drawn of the table
+//	(a TableView: the balls, the levers, the plunger, and the star and cross), both before
+//	and after that step -- through a triple buffer: the thread always has one of the three
+//	to write into, Display( ) always has one to read from, and the third is the newest one
+//	not yet taken, swapped with an atomic exchange -- so neither ever waits on the other,
+//	and the reader only ever sees whole snapshots
+//
+//	Display( ) draws the table one step behind the clock, in between the two views of the
+//	newest snapshot -- so the motion is smooth at any frame rate, not stepped to PHYSICSHZ
+//
+//	headless (where the frames are drawn at fixed times, not by the clock) the steps are
+//	still run by RunPhysics( ) itself, as many as the scene clock has moved on by, so two
+//	runs draw the same frames
+//
+//	the menus that change what the thread is working on stop it first, with StopSimThread( ),
+//	and start it again after -- and it is stopped by atexit( ) on the way out, however that is
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+
+const double	SIMSTEPMS = 1000. / PHYSICSHZ;
+const float		SIMSNAPDISTANCE = 1.f;				// a ball that moves more than this in one step was put somewhere, not moved
+const double	SIMMINSPLITMS = 0.001;				// a key event closer than this to the last one doesn't split the step
+
+// what Display( ) draws of the table:
+
+struct TableView
+{
+	float		ballX, ballZ;
+	float		leverL, leverR;
+	float		plungerZ;
+	float		starRot, crossRot;
+	int			numBalls;				// with multiball, the others are x[1 ..] and z[1 ..]
+	float *		x;
+	float *		z;
+};
+
+struct TableSnapshot
+{
+	struct TableView	before;				// the table before the newest step,
+	struct TableView	after;				// and after it
+	double				dueMs;				// when that step was due, on SimClock
+	long long			input;				// the number of the newest key event applied (tableinput.cpp)
+	long long			steps;				// how many have been run, and everything below is a total too
+	double				stepMs;
+	double				multiballMs[NUMMULTISEGMENTS];
+	long long			contacts;
+};
+
+const int			SNAPSHOTFRESH = 4;			// in SnapshotMiddle: the writer has put a new one there
+
+struct TableSnapshot	Snapshots[3];
+std::atomic<int>		SnapshotMiddle;			// the one between the writer and the reader (| SNAPSHOTFRESH)
+int						SnapshotBack;			// the writer's
+int						SnapshotFront;			// the reader's
+
+std::thread				SimThread;
+std::atomic<bool>		SimStopping;
+bool					SimRunning = false;
+bool					SimAtExit = false;		// StopSimThreadAtExit( ) has been registered
+std::chrono::steady_clock::time_point	SimClock;	// when the thread was started
+
+struct TableView	PhysicsView;				// what Display( ) draws, from the last RunPhysics( )
+double				PhysicsLastMs = -1.;		// the scene clock when the last frame's steps were run (headless)
+double				PhysicsBacklog;				// seconds the simulation is behind the clock (headless)
+long long			PhysicsStepCount;			// the step count the last frame saw
+long long			PhysicsInput;				// the newest key event the last frame shows
+int					PhysicsSteps;				// how many steps have been run since the frame before
+double				PhysicsMs;					// and how long they took
+double				PhysicsMultiballMs[NUMMULTISEGMENTS];
+int					PhysicsContacts;
+double				PhysicsLastStepMs;			// the snapshot totals the last frame saw
+double				PhysicsLastMultiballMs[NUMMULTISEGMENTS];
+long long			PhysicsLastContacts;
+
+
+// the views' ball arrays are made once, for MAXBALLS:
+
+void
+NewTableView( struct TableView *v )
+{
+	if( v->x != NULL )
+		return;
+	v->x = new float[ MAXBALLS ];
+	v->z = new float[ MAXBALLS ];
+	v->numBalls = 0;
+}
+
+
+// what is drawn of a table:
+
+void
+ViewTable( const struct TableState *s, const struct BallSet *b, struct TableView *v )
+{
+	v->ballX = s->ball.x;
+	v->ballZ = s->ball.z;
+	v->leverL = s->leverL;
+	v->leverR = s->leverR;
+	v->plungerZ = s->plungerZ;
+	v->starRot = s->starRot;
+	v->crossRot = s->crossRot;
+	v->numBalls = MultiballCount;
+	v->x[0] = s->ball.x;
+	v->z[0] = s->ball.z;
+	if( MultiballCount > 1 )
+	{
+		memcpy( v->x + 1, b->x + 1, ( MultiballCount - 1 ) * sizeof(float) );
+		memcpy( v->z + 1, b->z + 1, ( MultiballCount - 1 ) * sizeof(float) );
+	}
+}
+
+
+// an angle in between two others, the short way around:
+
+inline float
+LerpDegrees( float a, float b, float t )
+{
+	float d = fmodf( b - a, 360.f );
+	if( d > 180.f )
+		d -= 360.f;
+	if( d < -180.f )
+		d += 360.f;
+	return a + t*d;
+}
+
+
+// a ball in between where it was and is -- unless it was picked up and put somewhere:
+
+inline void
+LerpBall( float x0, float z0, float x1, float z1, float t, float *x, float *z )
+{
+	float dx = x1 - x0;
+	float dz = z1 - z0;
+	if( dx*dx + dz*dz > SIMSNAPDISTANCE*SIMSNAPDISTANCE )
+	{
+		*x = x1;
+		*z = z1;
+		return;
+	}
+	*x = x0 + t*dx;
+	*z = z0 + t*dz;
+}
+
+
+void
+LerpView( const struct TableView *a, const struct TableView *b, float t, struct TableView *v )
+{
+	LerpBall( a->ballX, a->ballZ, b->ballX, b->ballZ, t, &v->ballX, &v->ballZ );
+	v->leverL = a->leverL + t*( b->leverL - a->leverL );
+	v->leverR = a->leverR + t*( b->leverR - a->leverR );
+	v->plungerZ = a->plungerZ + t*( b->plungerZ - a->plungerZ );
+	v->starRot = LerpDegrees( a->starRot, b->starRot, t );
+	v->crossRot = LerpDegrees( a->crossRot, b->crossRot, t );
+
+	// (the number of balls is the same before and after a step -- it only changes with the thread stopped)
+	v->numBalls = b->numBalls;
+	v->x[0] = v->ballX;
+	v->z[0] = v->ballZ;
+	for( int i = 1; i < b->numBalls; i++ )
+		LerpBall( a->x[i], a->z[i], b->x[i], b->z[i], t, &v->x[i], &v->z[i] );
+}
+
+
+// ms since the thread was started:
+
+inline double
+SimClockMs( )
+{
+	return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now( ) - SimClock ).count( );
+}
+
+
+// the writer's side of the triple buffer -- hand over the back snapshot, get the old middle one:
+
+void
+PublishSnapshot( )
+{
+	SnapshotBack = SnapshotMiddle.exchange( SnapshotBack | SNAPSHOTFRESH, std::memory_order_acq_rel ) & ~SNAPSHOTFRESH;
+}
+
+
+// the reader's side -- the newest snapshot (the same one as last time, if there isn't a newer one):
+
+const struct TableSnapshot *
+LatestSnapshot( )
+{
+	if( ( SnapshotMiddle.load( std::memory_order_acquire ) & SNAPSHOTFRESH ) != 0 )
+		SnapshotFront = SnapshotMiddle.exchange( SnapshotFront, std::memory_order_acq_rel ) & ~SNAPSHOTFRESH;
+	return &Snapshots[ SnapshotFront ];
+}
+
+
+// the table from fromMs up to toMs on SimClock -- split at each key event in between, so the
+// keys go down and up when they did:
+// (the balls other than the player's don't care about the keys, so they are moved once)
+
+void
+StepWithInput( double fromMs, double toMs )
+{
+	double atMs = fromMs;
+	const struct InputEvent *e;
+	while( ( e = PeekInput( ) ) != NULL )
+	{
+		double eventMs = std::chrono::duration<double, std::milli>( e->when - SimClock ).count( );
+		if( eventMs > toMs )
+			break;
+		if( eventMs - atMs >= SIMMINSPLITMS )
+		{
+			StepTable( &Table, (float)( ( eventMs - atMs ) / 1000. ) );
+			atMs = eventMs;
+		}
+		PopInput( &Table.input );
+	}
+	if( toMs - atMs >= SIMMINSPLITMS )
+		StepTable( &Table, (float)( ( toMs - atMs ) / 1000. ) );
+	StepMultiball( &Table, PHYSICSDT );
+}
+
+
+// the thread -- one step every SIMSTEPMS:
+
+void
+SimThreadMain( )
+{
+	double busyMs = 0.;
+	long long steps = 0;
+	double dueMs = 0.;
+	while( ! SimStopping.load( std::memory_order_relaxed ) )
+	{
+		dueMs += SIMSTEPMS;
+		double nowMs = SimClockMs( );
+		if( nowMs < dueMs )
+			std::this_thread::sleep_until( SimClock + std::chrono::microseconds( (long long)( 1000. * dueMs ) ) );
+		else if( nowMs - dueMs > MAXPHYSICSSTEPS * SIMSTEPMS )
+			dueMs = nowMs;		// after a long stall (a debugger, a suspend), don't try to catch up
+
+		struct TableSnapshot *s = &Snapshots[ SnapshotBack ];
+		ViewTable( &Table, &Balls, &s->before );
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now( );
+		StepWithInput( dueMs - SIMSTEPMS, dueMs );
+		busyMs += std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now( ) - start ).count( );
+		ViewTable( &Table, &Balls, &s->after );
+
+		s->dueMs = dueMs;
+		s->input = InputApplied;
+		s->steps = ++steps;
+		s->stepMs = busyMs;
+		memcpy( s->multiballMs, MultiballMs, sizeof(MultiballMs) );
+		s->contacts = MultiballContacts;
+		PublishSnapshot( );
+	}
+}
+
+
+// stop the thread -- returns whether it was running:
+
+bool
+StopSimThread( )
+{
+	if( ! SimRunning )
+		return false;
+	SimStopping.store( true );
+	SimThread.join( );
+	SimRunning = false;
+	return true;
+}
+
+
+// however the program exits (the Quit menu, the window being closed, an error), the thread
+// is stopped first -- the joinable SimThread's destructor would call std::terminate( ), and
+// the thread would still be writing the globals being torn down:
+
+void
+StopSimThreadAtExit( )
+{
+	StopSimThread( );
+}
+
+
+void
+StartSimThread( )
+{
+	StopSimThread( );
+	if( ! SimAtExit )
+	{
+		atexit( StopSimThreadAtExit );		// (after SimThread was made, so this runs before it is destroyed)
+		SimAtExit = true;
+	}
+	for( int k = 0; k < 3; k++ )
+	{
+		NewTableView( &Snapshots[k].before );
+		NewTableView( &Snapshots[k].after );
+		ViewTable( &Table, &Balls, &Snapshots[k].before );
+		ViewTable( &Table, &Balls, &Snapshots[k].after );
+		Snapshots[k].dueMs = 0.;
+		Snapshots[k].input = InputApplied;
+		Snapshots[k].steps = 0;
+		Snapshots[k].stepMs = 0.;
+		memset( Snapshots[k].multiballMs, 0, sizeof(Snapshots[k].multiballMs) );
+		Snapshots[k].contacts = 0;
+	}
+	SnapshotFront = 0;
+	SnapshotMiddle.store( 1 );
+	SnapshotBack = 2;
+
+	memset( MultiballMs, 0, sizeof(MultiballMs) );
+	MultiballContacts = 0;
+	PhysicsStepCount = 0;
+	PhysicsLastStepMs = 0.;
+	memset( PhysicsLastMultiballMs, 0, sizeof(PhysicsLastMultiballMs) );
+	PhysicsLastContacts = 0;
+
+	SimStopping.store( false );
+	SimClock = std::chrono::steady_clock::now( );
+	SimThread = std::thread( SimThreadMain );
+	SimRunning = true;
+}
+
+
+void
+SetPhysics( int on )
+{
+	StopSimThread( );
+	PhysicsOn = on;
+	PhysicsLastMs = -1.;
+	ResetTable( &Table );
+	ClearInput( );
+	if( on != 0  &&  HeadlessOn == 0 )
+		StartSimThread( );
+}
+
+
+// with the thread running, draw in between the newest snapshot's views:
+
+void
+ReadSnapshot( )
+{
+	const struct TableSnapshot *s = LatestSnapshot( );
+
+	// (the newest step is drawn as it is SIMSTEPMS after it was due, so the table is drawn one step behind)
+	float t = (float)( ( SimClockMs( ) - s->dueMs ) / SIMSTEPMS );
+	t = fmaxf( 0.f, fminf( t, 1.f ) );
+	LerpView( &s->before, &s->after, t, &PhysicsView );
+
+	PhysicsSteps = (int)( s->steps - PhysicsStepCount );
+	PhysicsMs = s->stepMs - PhysicsLastStepMs;
+	for( int k = 0; k < NUMMULTISEGMENTS; k++ )
+		PhysicsMultiballMs[k] = s->multiballMs[k] - PhysicsLastMultiballMs[k];
+	PhysicsContacts = (int)( s->contacts - PhysicsLastContacts );
+	PhysicsStepCount = s->steps;
+	PhysicsInput = s->input;
+	PhysicsLastStepMs = s->stepMs;
+	memcpy( PhysicsLastMultiballMs, s->multiballMs, sizeof(PhysicsLastMultiballMs) );
+	PhysicsLastContacts = s->contacts;
+}
+
+
+// with no thread, run the steps the scene clock has moved on by:
+
+void
+StepPhysics( )
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now( );
+
+	double nowMs = SceneClockMs( );
+	if( PhysicsLastMs < 0.  ||  nowMs < PhysicsLastMs )
+	{
+		PhysicsLastMs = nowMs;
+		PhysicsBacklog = 0.;
+	}
+	PhysicsBacklog += ( nowMs - PhysicsLastMs ) / 1000.;
+	PhysicsLastMs = nowMs;
+
+	while( PeekInput( ) != NULL )
+		PopInput( &Table.input );
+	PhysicsInput = InputApplied;
+	PhysicsSteps = 0;
+	while( PhysicsBacklog >= PHYSICSDT  &&  PhysicsSteps < MAXPHYSICSSTEPS )
+	{
+		StepTable( &Table, PHYSICSDT );
+		StepMultiball( &Table, PHYSICSDT );
+		PhysicsBacklog -= PHYSICSDT;
+		PhysicsSteps++;
+	}
+	if( PhysicsSteps == MAXPHYSICSSTEPS )
+		PhysicsBacklog = 0.;
+
+	NewTableView( &PhysicsView );
+	ViewTable( &Table, &Balls, &PhysicsView );
+	memcpy( PhysicsMultiballMs, MultiballMs, sizeof(MultiballMs) );
+	PhysicsContacts = MultiballContacts;
+	memset( MultiballMs, 0, sizeof(MultiballMs) );
+	MultiballContacts = 0;
+
+	PhysicsMs = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now( ) - start ).count( );
+}
+
+
+// put the physics' table where Display( ) draws from:
+
+void
+RunPhysics( struct AnimState *a )
+{
+	NewTableView( &PhysicsView );
+	if( SimRunning )
+		ReadSnapshot( );
+	else
+		StepPhysics( );
+
+	a->ballX = PhysicsView.ballX;
+	a->ballZ = PhysicsView.ballZ;
+	a->leverL = PhysicsView.leverL;
+	a->leverR = PhysicsView.leverR;
+	a->plungerZ = PhysicsView.plungerZ;
+	a->starRot = PhysicsView.starRot;
+	a->crossRot = PhysicsView.crossRot;
+
+	// (and the camera stays where the animation leaves it, instead of swooping in every cycle)
+	float v[2];
+	Camera.GetValues( (float)( MS_PER_CYCLE - 1 ) / 1000.f, v );
+	a->posZ  = v[0];
+	a->lookY = v[1];
+}
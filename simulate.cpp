@@ -0,0 +1,462 @@
+// the table simulation -- lots of games played with no window, for tuning the table:
+//
+//	"finalproj -simulate [games] [file.json] [-threads n] [-seed s]" plays that many games
+//	(SIMDEFAULTGAMES if not given) with StepTable( ) alone -- the meshes are read (out of the
+//	bundle, if there is one) only to make their collision triangles and distance fields, and
+//	glut and opengl are never turned on -- and writes what happened (simulation.json by
+//	default): how the games ended and how long they lasted, and how often each piece was hit
+//
+//	a game is one ball: the plunger is pulled back a random amount and let go (and the ball
+//	is nudged a random hair sideways first), and AutoPlay( ) flips a lever whenever the ball
+//	comes down near it -- until the ball drains, ends up back on the plunger, or
+//	SIMMAXSECONDS go by. each game's randomness comes from its number and the seed alone, so
+//	the results are the same however the games get spread over the threads
+//
+//	the games are spread by work stealing: each thread starts with an even share of the game
+//	numbers, as a (next, end) range packed into one atomic 64-bit word, and takes SIMCHUNK of
+//	them at a time off the front of it -- when its own runs out, it takes the back half of
+//	the biggest range left (a compare-and-swap, no locks). each thread adds its games into
+//	its own SimResults, which are only added together after all of them have finished
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+
+const unsigned int	SIMDEFAULTGAMES = 100000;
+const int			SIMCHUNK = 16;					// games taken off a thread's own range at a time
+const int			SIMMAXSECONDS = 60;				// a game still going after this is stopped
+const int			SIMHITBINS = 16;				// hits in a game: 0 .. SIMHITBINS-2, and SIMHITBINS-1 or more
+const float			SIMJITTER = 0.02f;				// how far the ball can be nudged sideways on the plunger
+const float			SIMSETTLESPEED = 0.5f;			// a ball back on the plunger slower than this is done
+const float			SIMSETTLESECONDS = 1.f;			// (once it has been this long since the launch)
+const float			SIMFLIPREACH = 2.2f;			// a lever is flipped when the ball is coming down within this of its pivot
+const float			SIMLEVERSPLITX = -0.5f;			// the left lever takes the balls left of here
+
+enum SimOutcomes
+{
+	SIM_DRAINED,
+	SIM_RETURNED,				// back on the plunger
+	SIM_TIMEDOUT,
+	NUMSIMOUTCOMES
+};
+
+const char *	SimOutcomeNames[NUMSIMOUTCOMES] = { "drained", "returned", "timedOut" };
+
+// one game:
+
+struct SimGame
+{
+	int			outcome;
+	bool		leftLane;				// the ball got out of the plunger lane
+	float		seconds;
+	int			hits[NUMTABLEPIECES];
+};
+
+// a thread's games added up:
+
+struct SimResults
+{
+	long long	games;
+	long long	outcomes[NUMSIMOUTCOMES];
+	long long	leftLane;
+	double		seconds;							// simulated
+	long long	lengths[SIMMAXSECONDS+1];			// one-second bins
+	long long	hits[NUMTABLEPIECES];
+	long long	hitGames[NUMTABLEPIECES][SIMHITBINS];	// how many games hit each piece that many times
+};
+
+// a thread's range of games, and its results:
+// (padded on both sides of what its own thread writes, so that another thread taking from its
+//  range shares no cache line with its results -- or with the next worker's, since new[ ]
+//  doesn't put the workers on cache line boundaries)
+
+struct SimWorker
+{
+	std::atomic<unsigned long long>	range;			// next game in the low 32 bits, the end in the high 32
+	char							pad[64];
+	struct SimResults				results;
+	int								steals;
+	double							ms;
+	char							pad2[64];
+};
+
+unsigned int		SimulateGames = 0;			// != 0 means -simulate was given
+char *				SimulateFile = NULL;
+int					SimulateThreads = 0;		// 0 means one per core
+unsigned long long	SimulateSeed = 1;
+
+
+void
+ParseSimulateArgs( int argc, char *argv[ ] )
+{
+	for( int i = 1; i < argc; i++ )
+	{
+		if( strcmp( argv[i], "-simulate" ) == 0 )
+		{
+			SimulateGames = SIMDEFAULTGAMES;
+			SimulateFile = (char *)"simulation.json";
+			if( i+1 < argc  &&  isdigit( argv[i+1][0] ) )
+				SimulateGames = (unsigned int)strtoul( argv[++i], NULL, 10 );
+			if( i+1 < argc  &&  argv[i+1][0] != '-' )
+				SimulateFile = argv[++i];
+		}
+		else if( strcmp( argv[i], "-threads" ) == 0  &&  i+1 < argc )
+			SimulateThreads = atoi( argv[++i] );
+		else if( strcmp( argv[i], "-seed" ) == 0  &&  i+1 < argc )
+			SimulateSeed = strtoull( argv[++i], NULL, 10 );
+	}
+}
+
+
+// splitmix64 -- a game's random numbers, from a state that starts as its number and the seed:
+
+inline unsigned long long
+SplitMix( unsigned long long *state )
+{
+	unsigned long long z = ( *state += 0x9E3779B97F4A7C15ull );
+	z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ull;
+	z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBull;
+	return z ^ ( z >> 31 );
+}
+
+
+inline float
+SimRandom( unsigned long long *state )
+{
+	return (float)( SplitMix( state ) >> 40 ) / 16777216.f;
+}
+
+
+// hold a lever up while the ball is coming down near it:
+
+void
+AutoPlay( struct TableState *s )
+{
+	const struct Ball *ball = &s->ball;
+	bool coming = ball->vz > 0.f;
+	for( int i = 0; i < NUMTABLEPIECES; i++ )
+	{
+		const struct TablePiece *piece = &TablePieces[i];
+		if( piece->motion != PIECELEVERLEFT  &&  piece->motion != PIECELEVERRIGHT )
+			continue;
+		float dx = ball->x - piece->x;
+		float dz = ball->z - piece->z;
+		bool near = coming  &&  dx*dx + dz*dz < SIMFLIPREACH*SIMFLIPREACH;
+		if( piece->motion == PIECELEVERLEFT )
+			s->input.leftLever = near  &&  ball->x < SIMLEVERSPLITX;
+		else
+			s->input.rightLever = near  &&  ball->x >= SIMLEVERSPLITX;
+	}
+}
+
+
+// play game number n:
+
+void
+PlayGame( unsigned int n, unsigned long long seed, struct SimGame *game )
+{
+	unsigned long long state = seed ^ ( (unsigned long long)n << 32 | n );
+	SplitMix( &state );
+
+	struct TableState s;
+	ResetTable( &s );
+	s.ball.x += SIMJITTER * ( 2.f * SimRandom( &state ) - 1.f );
+	float pull = PLUNGERREST + ( PLUNGERPULLED - PLUNGERREST ) * SimRandom( &state );
+
+	game->outcome = SIM_TIMEDOUT;
+	game->leftLane = false;
+	bool released = false;
+	double launched = 0.;
+	const int maxSteps = (int)( SIMMAXSECONDS * PHYSICSHZ );
+	for( int i = 0; i < maxSteps; i++ )
+	{
+		// pull the plunger back to where this game lets it go:
+
+		if( ! released  &&  s.plungerZ >= pull - 0.0001f )
+		{
+			released = true;
+			launched = s.time;
+		}
+		s.input.plunger = ! released;
+		AutoPlay( &s );
+
+		StepTable( &s, PHYSICSDT );
+
+		if( s.drains > 0 )
+		{
+			game->outcome = SIM_DRAINED;
+			break;
+		}
+		const struct Ball *ball = &s.ball;
+		bool inLane = ball->x > BALLSTARTX - 2.f*BALLRADIUS;
+		if( ! inLane )
+			game->leftLane = true;
+		if( released  &&  inLane  &&  ball->z > BALLSTARTZ - BALLRADIUS  &&  s.time - launched > SIMSETTLESECONDS
+		 && ball->vx*ball->vx + ball->vz*ball->vz < SIMSETTLESPEED*SIMSETTLESPEED )
+		{
+			game->outcome = SIM_RETURNED;
+			break;
+		}
+	}
+
+	game->seconds = (float)s.time;
+	for( int i = 0; i < NUMTABLEPIECES; i++ )
+		game->hits[i] = s.hits[i];
+}
+
+
+void
+AddGame( struct SimResults *r, const struct SimGame *game )
+{
+	r->games++;
+	r->outcomes[ game->outcome ]++;
+	if( game->leftLane )
+		r->leftLane++;
+	r->seconds += game->seconds;
+	int bin = (int)game->seconds;
+	r->lengths[ ( bin < SIMMAXSECONDS ) ? bin : SIMMAXSECONDS ]++;
+	for( int i = 0; i < NUMTABLEPIECES; i++ )
+	{
+		r->hits[i] += game->hits[i];
+		r->hitGames[i][ ( game->hits[i] < SIMHITBINS-1 ) ? game->hits[i] : SIMHITBINS-1 ]++;
+	}
+}
+
+
+void
+AddResults( struct SimResults *total, const struct SimResults *r )
+{
+	total->games += r->games;
+	for( int k = 0; k < NUMSIMOUTCOMES; k++ )
+		total->outcomes[k] += r->outcomes[k];
+	total->leftLane += r->leftLane;
+	total->seconds += r->seconds;
+	for( int k = 0; k <= SIMMAXSECONDS; k++ )
+		total->lengths[k] += r->lengths[k];
+	for( int i = 0; i < NUMTABLEPIECES; i++ )
+	{
+		total->hits[i] += r->hits[i];
+		for( int k = 0; k < SIMHITBINS; k++ )
+			total->hitGames[i][k] += r->hitGames[i][k];
+	}
+}
+
+
+inline unsigned long long
+GameRange( unsigned int next, unsigned int end )
+{
+	return (unsigned long long)end << 32  |  next;
+}
+
+
+// take up to SIMCHUNK games off the front of a thread's own range:
+
+bool
+TakeGames( struct SimWorker *w, unsigned int *first, unsigned int *last )
+{
+	unsigned long long r = w->range.load( );
+	while( true )
+	{
+		unsigned int next = (unsigned int)r;
+		unsigned int end = (unsigned int)( r >> 32 );
+		if( next >= end )
+			return false;
+		unsigned int take = ( end - next < (unsigned int)SIMCHUNK ) ? end - next : SIMCHUNK;
+		if( w->range.compare_exchange_weak( r, GameRange( next + take, end ) ) )
+		{
+			*first = next;
+			*last = next + take;
+			return true;
+		}
+	}
+}
+
+
+// take the back half of the biggest range another thread has left, as this one's range:
+// (returns false if there are none left anywhere)
+
+bool
+StealGames( struct SimWorker *workers, int numWorkers, int me )
+{
+	while( true )
+	{
+		int victim = -1;
+		unsigned int most = 0;
+		unsigned long long r = 0;
+		for( int k = 0; k < numWorkers; k++ )
+		{
+			if( k == me )
+				continue;
+			unsigned long long rk = workers[k].range.load( );
+			unsigned int left = (unsigned int)( rk >> 32 ) - (unsigned int)rk;
+			if( (unsigned int)rk < (unsigned int)( rk >> 32 )  &&  left > most )
+			{
+				victim = k;
+				most = left;
+				r = rk;
+			}
+		}
+		if( victim < 0 )
+			return false;
+
+		// (if it has changed since, look again)
+		unsigned int next = (unsigned int)r;
+		unsigned int end = (unsigned int)( r >> 32 );
+		unsigned int middle = next + most / 2;
+		if( workers[victim].range.compare_exchange_strong( r, GameRange( next, middle ) ) )
+		{
+			workers[me].range.store( GameRange( middle, end ) );
+			return true;
+		}
+	}
+}
+
+
+// one thread's games:
+
+void
+SimulateWorker( struct SimWorker *workers, int numWorkers, int me )
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now( );
+	struct SimWorker *w = &workers[me];
+	struct SimGame game;
+	while( true )
+	{
+		unsigned int first, last;
+		if( ! TakeGames( w, &first, &last ) )
+		{
+			if( ! StealGames( workers, numWorkers, me ) )
+				break;
+			w->steals++;
+			continue;
+		}
+		for( unsigned int n = first; n < last; n++ )
+		{
+			PlayGame( n, SimulateSeed, &game );
+			AddGame( &w->results, &game );
+		}
+	}
+	w->ms = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now( ) - start ).count( );
+}
+
+
+// make the collision meshes without gl:
+
+bool
+LoadCollisionMeshes( )
+{
+	OpenBundle( BundleFile );
+	bool ok = true;
+	for( int i = 0; i < NUMMESHLISTS; i++ )
+	{
+		struct ObjMesh mesh;
+		if( ! LoadMeshAsset( (char *)MeshLists[i].file, &mesh ) )
+		{
+			fprintf( stderr, "Cannot read '%s'\n", MeshLists[i].file );
+			ok = false;
+			continue;
+		}
+		BuildCollisionMesh( &MeshLists[i], &mesh );
+		FreeObjMesh( &mesh );
+	}
+	CloseBundle( );
+	return ok;
+}
+
+
+void
+WriteSimulation( FILE *fp, const struct SimResults *r, int numThreads, double wallSeconds, double gamesPerSecond )
+{
+	fprintf( fp, "{\n  \"games\": %lld,\n  \"threads\": %d,\n  \"seed\": %llu,\n  \"distanceFields\": %s,\n",
+		r->games, numThreads, SimulateSeed, FieldOn != 0 ? "true" : "false" );
+	fprintf( fp, "  \"wallSeconds\": %.3f,\n  \"gamesPerSecond\": %.1f,\n  \"simulatedSeconds\": %.1f,\n",
+		wallSeconds, gamesPerSecond, r->seconds );
+
+	fprintf( fp, "  \"outcomes\": {" );
+	for( int k = 0; k < NUMSIMOUTCOMES; k++ )
+		fprintf( fp, " \"%s\": %lld%s", SimOutcomeNames[k], r->outcomes[k], ( k < NUMSIMOUTCOMES-1 ) ? "," : "" );
+	fprintf( fp, " },\n  \"drainRate\": %.4f,\n  \"leftLane\": %lld,\n",
+		(double)r->outcomes[SIM_DRAINED] / (double)r->games, r->leftLane );
+
+	fprintf( fp, "  \"secondsHistogram\": [" );
+	for( int k = 0; k <= SIMMAXSECONDS; k++ )
+		fprintf( fp, " %lld%s", r->lengths[k], ( k < SIMMAXSECONDS ) ? "," : "" );
+	fprintf( fp, " ],\n  \"pieces\": [\n" );
+
+	for( int i = 0; i < NUMTABLEPIECES; i++ )
+	{
+		fprintf( fp, "    { \"name\": \"%s\", \"hits\": %lld, \"hitsPerGame\": %.4f, \"hitHistogram\": [",
+			TablePieces[i].name, r->hits[i], (double)r->hits[i] / (double)r->games );
+		for( int k = 0; k < SIMHITBINS; k++ )
+			fprintf( fp, " %lld%s", r->hitGames[i][k], ( k < SIMHITBINS-1 ) ? "," : "" );
+		fprintf( fp, " ] }%s\n", ( i < NUMTABLEPIECES-1 ) ? "," : "" );
+	}
+	fprintf( fp, "  ]\n}\n" );
+}
+
+
+// play the games on every thread, and write the results:
+
+int
+RunSimulation( )
+{
+	if( ! LoadCollisionMeshes( ) )
+		return 1;
+
+	int numThreads = ( SimulateThreads > 0 ) ? SimulateThreads : NumCores( );
+	unsigned int games = SimulateGames;
+	struct SimWorker *workers = new struct SimWorker[numThreads];
+	for( int k = 0; k < numThreads; k++ )
+	{
+		unsigned int next = (unsigned int)( (unsigned long long)games * k / numThreads );
+		unsigned int end = (unsigned int)( (unsigned long long)games * ( k+1 ) / numThreads );
+		workers[k].range.store( GameRange( next, end ) );
+		memset( &workers[k].results, 0, sizeof(workers[k].results) );
+		workers[k].steals = 0;
+		workers[k].ms = 0.;
+	}
+
+	fprintf( stderr, "Simulating %u games on %d threads (seed %llu)...\n", games, numThreads, SimulateSeed );
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now( );
+
+	// (this thread is one of the workers)
+	std::vector<std::thread> threads;
+	for( int k = 1; k < numThreads; k++ )
+		threads.push_back( std::thread( SimulateWorker, workers, numThreads, k ) );
+	SimulateWorker( workers, numThreads, 0 );
+	for( size_t k = 0; k < threads.size( ); k++ )
+		threads[k].join( );
+
+	double wallSeconds = std::chrono::duration<double>( std::chrono::high_resolution_clock::now( ) - start ).count( );
+
+	struct SimResults total;
+	memset( &total, 0, sizeof(total) );
+	for( int k = 0; k < numThreads; k++ )
+		AddResults( &total, &workers[k].results );
+	double gamesPerSecond = (double)total.games / wallSeconds;
+
+	fprintf( stderr, "  thread     games   steals      ms\n" );
+	for( int k = 0; k < numThreads; k++ )
+		fprintf( stderr, "  %6d  %8lld  %7d  %6.0f\n", k, workers[k].results.games, workers[k].steals, workers[k].ms );
+	fprintf( stderr, "%lld games in %.2f s: %.0f games / second (%.0f simulated seconds / second)\n",
+		total.games, wallSeconds, gamesPerSecond, total.seconds / wallSeconds );
+	fprintf( stderr, "  drained %lld, back on the plunger %lld, timed out %lld -- %lld got out of the lane\n",
+		total.outcomes[SIM_DRAINED], total.outcomes[SIM_RETURNED], total.outcomes[SIM_TIMEDOUT], total.leftLane );
+	for( int i = 0; i < NUMTABLEPIECES; i++ )
+		fprintf( stderr, "  %-12s  %8.3f hits / game\n", TablePieces[i].name, (double)total.hits[i] / (double)total.games );
+
+	delete [ ] workers;
+
+	FILE *fp = fopen( SimulateFile, "w" );
+	if( fp == NULL )
+	{
+		fprintf( stderr, "Cannot write '%s'\n", SimulateFile );
+		return 1;
+	}
+	WriteSimulation( fp, &total, numThreads, wallSeconds, gamesPerSecond );
+	fclose( fp );
+	fprintf( stderr, "Wrote '%s'\n", SimulateFile );
+	return 0;
+}
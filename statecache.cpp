@@ -0,0 +1,490 @@
+// the gl state cache -- dropping state changes that don't change anything:
+//
+//	Display( ) sets the same state every frame whether it changed or not: the enables,
+//	the shade model, the fog, the texture environment, every light's colors through
+//	SetPointLight( ) and SetSpotLight( ), and a SetMaterial( ) for each object even when
+//	it is the same material as the last one -- and on mesa each of those can mean
+//	revalidating a chunk of driver state at the next draw
+//
+//	so the gl calls for those are replaced (by macros, like gltrace.cpp's, so that
+//	setmaterial.cpp and setlight.cpp are covered too) by ones that keep a shadow copy of
+//	the state and only call gl when the value is different:
+//
+//		enables			the capabilities in CachedCaps[ ]
+//		materials		front and back, all but the color indexes
+//		lights			colors, spot exponent and cutoff, and attenuation -- but never
+//						GL_POSITION or GL_SPOT_DIRECTION, which gl transforms by the
+//						modelview at the time of the call, so the same values can mean
+//						a different place
+//		textures		the GL_TEXTURE_2D binding
+//		texenv			GL_TEXTURE_ENV_MODE
+//		shade model, fog
+//
+//	the shadow copy starts out (and goes back to being) unknown, so the next call of each
+//	kind goes through -- that happens after anything that changes state behind the
+//	cache's back: a glCallList( ) (a list can hold any state), a glPopAttrib( ), or the
+//	end of compiling a list (nothing is shadowed while one is compiled)
+//
+//	StateCounts has how many calls of each kind this frame made and how many of them
+//	were saved -- the hud shows the totals, and StateCacheOn (the menu) turns the cache off
+//	to compare
+//
+//	this has to be included after gltrace.cpp and before anything that calls gl
+
+#include <string.h>
+
+
+enum StateKind
+{
+	STATE_ENABLE,
+	STATE_MATERIAL,
+	STATE_LIGHT,
+	STATE_TEXTURE,
+	STATE_TEXENV,
+	STATE_SHADEMODEL,
+	STATE_FOG,
+	NUMSTATEKINDS
+};
+
+const char *	StateKindNames[NUMSTATEKINDS] =
+{
+	"enable", "material", "light", "texture", "texenv", "shademodel", "fog"
+};
+
+struct StateStats
+{
+	int		calls[NUMSTATEKINDS];
+	int		saved[NUMSTATEKINDS];
+};
+
+const GLenum	CachedCaps[ ] =
+{
+	GL_LIGHTING, GL_LIGHT0, GL_LIGHT1, GL_LIGHT2, GL_LIGHT3, GL_LIGHT4, GL_LIGHT5, GL_LIGHT6, GL_LIGHT7,
+	GL_TEXTURE_2D, GL_DEPTH_TEST, GL_FOG, GL_NORMALIZE, GL_BLEND, GL_CULL_FACE, GL_COLOR_MATERIAL
+};
+const int		NUMCACHEDCAPS = sizeof(CachedCaps) / sizeof(CachedCaps[0]);
+const int		NUMCACHEDLIGHTS = 8;
+
+// the material and light parameters that are shadowed (as 4 floats each, 1 used for the scalars):
+
+enum { MAT_AMBIENT, MAT_DIFFUSE, MAT_SPECULAR, MAT_EMISSION, MAT_SHININESS, NUMMATPARAMS };
+enum { LIGHT_AMBIENT, LIGHT_DIFFUSE, LIGHT_SPECULAR, LIGHT_SPOTEXPONENT, LIGHT_SPOTCUTOFF,
+	LIGHT_CONSTANT, LIGHT_LINEAR, LIGHT_QUADRATIC, NUMLIGHTPARAMS };
+enum { FOG_MODE, FOG_DENSITY, FOG_START, FOG_END, FOG_COLOR, NUMFOGPARAMS };
+
+struct ShadowValue
+{
+	bool		known;
+	GLfloat		v[4];
+};
+
+struct ShadowState
+{
+	signed char			caps[NUMCACHEDCAPS];			// -1 unknown, 0 disabled, 1 enabled
+	struct ShadowValue	material[2][NUMMATPARAMS];		// front, back
+	struct ShadowValue	light[NUMCACHEDLIGHTS][NUMLIGHTPARAMS];
+	struct ShadowValue	fog[NUMFOGPARAMS];
+	GLint				texture2D;						// -1 unknown
+	GLint				texEnvMode;						// -1 unknown
+	GLint				shadeModel;						// -1 unknown
+};
+
+int					StateCacheOn = 1;			// != 0 means redundant state changes are dropped
+struct StateStats	StateCounts;				// this frame's counts
+
+struct ShadowState	Shadow;
+bool				CompilingList;				// between glNewList( ) and glEndList( )
+
+
+// forget everything -- the next call of each kind goes to gl:
+
+void
+InvalidateStateCache( )
+{
+	memset( Shadow.caps, -1, sizeof(Shadow.caps) );
+	memset( Shadow.material, 0, sizeof(Shadow.material) );
+	memset( Shadow.light, 0, sizeof(Shadow.light) );
+	memset( Shadow.fog, 0, sizeof(Shadow.fog) );
+	Shadow.texture2D = -1;
+	Shadow.texEnvMode = -1;
+	Shadow.shadeModel = -1;
+}
+
+
+void
+SetStateCache( int on )
+{
+	StateCacheOn = on;
+	InvalidateStateCache( );
+}
+
+
+void
+ResetStateCounts( )
+{
+	memset( &StateCounts, 0, sizeof(StateCounts) );
+}
+
+
+// the totals over all the kinds, for the hud:
+
+void
+StateCountTotals( int *calls, int *saved )
+{
+	*calls = *saved = 0;
+	for( int k = 0; k < NUMSTATEKINDS; k++ )
+	{
+		*calls += StateCounts.calls[k];
+		*saved += StateCounts.saved[k];
+	}
+}
+
+
+// is this call worth making? -- (if it is, the caller makes it)
+// (compares n floats against a shadow value and updates it)
+
+bool
+StateChanged( int kind, struct ShadowValue *sv, const GLfloat *v, int n )
+{
+	StateCounts.calls[kind]++;
+	if( StateCacheOn == 0  ||  CompilingList )
+		return true;
+	if( sv->known  &&  memcmp( sv->v, v, n * sizeof(GLfloat) ) == 0 )
+	{
+		StateCounts.saved[kind]++;
+		return false;
+	}
+	memcpy( sv->v, v, n * sizeof(GLfloat) );
+	sv->known = true;
+	return true;
+}
+
+
+// the same, for a shadowed integer (-1 means unknown):
+
+bool
+StateChanged( int kind, GLint *shadow, GLint value )
+{
+	StateCounts.calls[kind]++;
+	if( StateCacheOn == 0  ||  CompilingList )
+		return true;
+	if( *shadow == value )
+	{
+		StateCounts.saved[kind]++;
+		return false;
+	}
+	*shadow = value;
+	return true;
+}
+
+
+int
+CachedCapIndex( GLenum cap )
+{
+	for( int i = 0; i < NUMCACHEDCAPS; i++ )
+	{
+		if( CachedCaps[i] == cap )
+			return i;
+	}
+	return -1;
+}
+
+
+void
+SetCap( GLenum cap, bool on )
+{
+	int i = CachedCapIndex( cap );
+	if( i >= 0 )
+	{
+		GLint shadow = Shadow.caps[i];
+		if( ! StateChanged( STATE_ENABLE, &shadow, on ? 1 : 0 ) )
+			return;
+		Shadow.caps[i] = (signed char)shadow;
+	}
+	else
+		StateCounts.calls[STATE_ENABLE]++;
+
+	if( on )
+		glEnable( cap );
+	else
+		glDisable( cap );
+}
+
+
+void
+CacheEnable( GLenum cap )
+{
+	SetCap( cap, true );
+}
+
+
+void
+CacheDisable( GLenum cap )
+{
+	SetCap( cap, false );
+}
+
+
+int
+MaterialParam( GLenum pname, int *n )
+{
+	*n = 4;
+	switch( pname )
+	{
+		case GL_AMBIENT:	return MAT_AMBIENT;
+		case GL_DIFFUSE:	return MAT_DIFFUSE;
+		case GL_SPECULAR:	return MAT_SPECULAR;
+		case GL_EMISSION:	return MAT_EMISSION;
+		case GL_SHININESS:	*n = 1;  return MAT_SHININESS;
+	}
+	return -1;
+}
+
+
+// one face's material parameter (face is 0 for the front, 1 for the back):
+
+bool
+MaterialChanged( int face, int param, const GLfloat *v, int n )
+{
+	return StateChanged( STATE_MATERIAL, &Shadow.material[face][param], v, n );
+}
+
+
+void
+CacheMaterialfv( GLenum face, GLenum pname, const GLfloat *params )
+{
+	if( pname == GL_AMBIENT_AND_DIFFUSE )
+	{
+		CacheMaterialfv( face, GL_AMBIENT, params );
+		CacheMaterialfv( face, GL_DIFFUSE, params );
+		return;
+	}
+
+	int n;
+	int param = MaterialParam( pname, &n );
+	if( param < 0 )
+	{
+		StateCounts.calls[STATE_MATERIAL]++;
+		glMaterialfv( face, pname, params );
+		return;
+	}
+
+	if( face == GL_FRONT_AND_BACK )
+	{
+		// (both faces have to be checked, so that both shadows are updated)
+		bool front = MaterialChanged( 0, param, params, n );
+		bool back  = MaterialChanged( 1, param, params, n );
+		if( front  &&  back )
+			glMaterialfv( GL_FRONT_AND_BACK, pname, params );
+		else if( front )
+			glMaterialfv( GL_FRONT, pname, params );
+		else if( back )
+			glMaterialfv( GL_BACK, pname, params );
+		return;
+	}
+
+	if( MaterialChanged( face == GL_BACK ? 1 : 0, param, params, n ) )
+		glMaterialfv( face, pname, params );
+}
+
+
+void
+CacheMaterialf( GLenum face, GLenum pname, GLfloat param )
+{
+	CacheMaterialfv( face, pname, &param );
+}
+
+
+int
+LightParam( GLenum pname, int *n )
+{
+	*n = 1;
+	switch( pname )
+	{
+		case GL_AMBIENT:				*n = 4;  return LIGHT_AMBIENT;
+		case GL_DIFFUSE:				*n = 4;  return LIGHT_DIFFUSE;
+		case GL_SPECULAR:				*n = 4;  return LIGHT_SPECULAR;
+		case GL_SPOT_EXPONENT:			return LIGHT_SPOTEXPONENT;
+		case GL_SPOT_CUTOFF:			return LIGHT_SPOTCUTOFF;
+		case GL_CONSTANT_ATTENUATION:	return LIGHT_CONSTANT;
+		case GL_LINEAR_ATTENUATION:		return LIGHT_LINEAR;
+		case GL_QUADRATIC_ATTENUATION:	return LIGHT_QUADRATIC;
+	}
+	return -1;		// GL_POSITION and GL_SPOT_DIRECTION always go through
+}
+
+
+void
+CacheLightfv( GLenum light, GLenum pname, const GLfloat *params )
+{
+	int n;
+	int param = LightParam( pname, &n );
+	int l = (int)light - (int)GL_LIGHT0;
+	if( param < 0  ||  l < 0  ||  l >= NUMCACHEDLIGHTS )
+	{
+		StateCounts.calls[STATE_LIGHT]++;
+		glLightfv( light, pname, params );
+		return;
+	}
+	if( StateChanged( STATE_LIGHT, &Shadow.light[l][param], params, n ) )
+		glLightfv( light, pname, params );
+}
+
+
+void
+CacheLightf( GLenum light, GLenum pname, GLfloat param )
+{
+	CacheLightfv( light, pname, &param );
+}
+
+
+void
+CacheBindTexture( GLenum target, GLuint texture )
+{
+	if( target != GL_TEXTURE_2D )
+	{
+		StateCounts.calls[STATE_TEXTURE]++;
+		glBindTexture( target, texture );
+		return;
+	}
+	if( StateChanged( STATE_TEXTURE, &Shadow.texture2D, (GLint)texture ) )
+		glBindTexture( target, texture );
+}
+
+
+void
+CacheTexEnvf( GLenum target, GLenum pname, GLfloat param )
+{
+	if( target != GL_TEXTURE_ENV  ||  pname != GL_TEXTURE_ENV_MODE )
+	{
+		StateCounts.calls[STATE_TEXENV]++;
+		glTexEnvf( target, pname, param );
+		return;
+	}
+	if( StateChanged( STATE_TEXENV, &Shadow.texEnvMode, (GLint)param ) )
+		glTexEnvf( target, pname, param );
+}
+
+
+void
+CacheShadeModel( GLenum mode )
+{
+	if( StateChanged( STATE_SHADEMODEL, &Shadow.shadeModel, (GLint)mode ) )
+		glShadeModel( mode );
+}
+
+
+int
+FogParam( GLenum pname, int *n )
+{
+	*n = 1;
+	switch( pname )
+	{
+		case GL_FOG_MODE:		return FOG_MODE;
+		case GL_FOG_DENSITY:	return FOG_DENSITY;
+		case GL_FOG_START:		return FOG_START;
+		case GL_FOG_END:		return FOG_END;
+		case GL_FOG_COLOR:		*n = 4;  return FOG_COLOR;
+	}
+	return -1;
+}
+
+
+void
+CacheFogfv( GLenum pname, const GLfloat *params )
+{
+	int n;
+	int param = FogParam( pname, &n );
+	if( param < 0  ||  StateChanged( STATE_FOG, &Shadow.fog[param], params, n ) )
+	{
+		if( param < 0 )
+			StateCounts.calls[STATE_FOG]++;
+		glFogfv( pname, params );
+	}
+}
+
+
+void
+CacheFogf( GLenum pname, GLfloat param )
+{
+	CacheFogfv( pname, &param );
+}
+
+
+void
+CacheFogi( GLenum pname, GLint param )
+{
+	GLfloat f = (GLfloat)param;
+	CacheFogfv( pname, &f );
+}
+
+
+// the calls that change state behind the cache's back:
+
+void
+CacheCallList( GLuint list )
+{
+	glCallList( list );
+	if( ! CompilingList )
+		InvalidateStateCache( );
+}
+
+
+void
+CacheNewList( GLuint list, GLenum mode )
+{
+	CompilingList = true;
+	glNewList( list, mode );
+}
+
+
+void
+CacheEndList( )
+{
+	glEndList( );
+	CompilingList = false;
+	InvalidateStateCache( );		// (a GL_COMPILE_AND_EXECUTE list has changed things)
+}
+
+
+void
+CachePopAttrib( )
+{
+	glPopAttrib( );
+	InvalidateStateCache( );
+}
+
+
+#undef glEnable
+#undef glDisable
+#undef glMaterialf
+#undef glMaterialfv
+#undef glLightf
+#undef glLightfv
+#undef glBindTexture
+#undef glTexEnvf
+#undef glShadeModel
+#undef glFogf
+#undef glFogi
+#undef glFogfv
+#undef glCallList
+#undef glNewList
+#undef glEndList
+#undef glPopAttrib
+
+#define glEnable( c )				CacheEnable( c )
+#define glDisable( c )				CacheDisable( c )
+#define glMaterialf( f, p, v )		CacheMaterialf( f, p, v )
+#define glMaterialfv( f, p, v )		CacheMaterialfv( f, p, v )
+#define glLightf( l, p, v )			CacheLightf( l, p, v )
+#define glLightfv( l, p, v )		CacheLightfv( l, p, v )
+#define glBindTexture( t, n )		CacheBindTexture( t, n )
+#define glTexEnvf( t, p, v )		CacheTexEnvf( t, p, v )
+#define glShadeModel( m )			CacheShadeModel( m )
+#define glFogf( p, v )				CacheFogf( p, v )
+#define glFogi( p, v )				CacheFogi( p, v )
+#define glFogfv( p, v )				CacheFogfv( p, v )
+#define glCallList( l )				CacheCallList( l )
+#define glNewList( l, m )			CacheNewList( l, m )
+#define glEndList( )				CacheEndList( )
+#define glPopAttrib( )				CachePopAttrib( )
@@ -0,0 +1,204 @@
+// the player's controls -- key presses timestamped as they arrive, for the simulation to apply
+// when they happened:
+//
+//	Keyboard( ) and KeyboardUp( ) don't set the levers and the plunger themselves: each press
+//	and release is stamped with the steady clock the moment its callback gets it, and pushed
+//	onto InputQueue -- a single-producer, single-consumer ring (the glut thread pushes, the
+//	simulation pops), with one atomic index for each side and no locks
+//
+//	the simulation thread takes the events that are due by the end of each step, and splits
+//	the step at each one's time (see simthread.cpp) -- so a lever starts up at the instant
+//	its key went down, not at the start of the next step, or the next frame
+//
+//	with LatencyOn (the Latency menu), how long an event takes to show is measured:
+//
+//		applied		from the key callback to the simulation applying it
+//		shown		from the key callback to the first frame drawn with it having been
+//					swapped to the screen -- glFinish( )'d after the swap, so it is
+//					finished, not just queued (the monitor's own scan-out isn't counted)
+//
+//	every LATENCYSAMPLES events the median and the worst of each go to stderr -- and with
+//	LatencyOn == LATENCYAUTO the right lever is pressed and let go every LATENCYAUTOMS by
+//	Animate( ), through the same queue, so it can be measured with no one at the keyboard
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+
+const int		INPUTQUEUESIZE = 256;				// a power of 2
+const int		LATENCYSAMPLES = 32;				// events per latency report
+const int		LATENCYAUTO = 2;					// LatencyOn value for the automatic presses
+const double	LATENCYAUTOMS = 250.;
+
+// the keys held down, as bits:
+
+const unsigned int	KEYLEFTLEVER  = 1;
+const unsigned int	KEYRIGHTLEVER = 2;
+const unsigned int	KEYPLUNGER    = 4;
+
+struct InputEvent
+{
+	std::chrono::steady_clock::time_point	when;		// when the key callback got it
+	unsigned int							key;		// one of the KEY* bits
+	bool									down;
+	long long								number;		// 1, 2, 3, ... in the order they were pushed
+};
+
+struct InputEvent		InputQueue[INPUTQUEUESIZE];
+std::atomic<long long>	InputHead;					// the next to push (the glut thread's)
+std::atomic<long long>	InputTail;					// the next to pop (the simulation's)
+long long				InputPushed;				// the numbers given out so far
+unsigned int			InputKeys;					// the KEY* bits held down, as the simulation has applied them
+long long				InputApplied;				// the number of the newest event it has applied
+
+int						LatencyOn = 0;				// != 0 means the latency is measured
+long long				LatencyShown;				// the newest event a swapped frame has shown
+std::chrono::steady_clock::time_point	LatencyApplied[INPUTQUEUESIZE];	// by event number, mod the size
+std::chrono::steady_clock::time_point	LatencyArrived[INPUTQUEUESIZE];
+std::chrono::steady_clock::time_point	LatencyLastAuto;
+bool					LatencyAutoDown;			// the automatic press is holding the right lever up
+double					LatencyAppliedMs[LATENCYSAMPLES];
+double					LatencyShownMs[LATENCYSAMPLES];
+int						LatencyCount;
+
+
+// push a key press or release (on the glut thread):
+
+void
+PushTableKey( unsigned int key, bool down )
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now( );
+	long long head = InputHead.load( std::memory_order_relaxed );
+	if( head - InputTail.load( std::memory_order_acquire ) >= INPUTQUEUESIZE )
+	{
+		fprintf( stderr, "The input queue is full -- a key event was dropped\n" );
+		return;
+	}
+	struct InputEvent *e = &InputQueue[ head & ( INPUTQUEUESIZE-1 ) ];
+	e->when = now;
+	e->key = key;
+	e->down = down;
+	e->number = ++InputPushed;
+	LatencyArrived[ e->number & ( INPUTQUEUESIZE-1 ) ] = now;
+	InputHead.store( head + 1, std::memory_order_release );
+}
+
+
+// the oldest event not yet applied (on the simulation's side) -- NULL if there are none:
+
+const struct InputEvent *
+PeekInput( )
+{
+	long long tail = InputTail.load( std::memory_order_relaxed );
+	if( tail == InputHead.load( std::memory_order_acquire ) )
+		return NULL;
+	return &InputQueue[ tail & ( INPUTQUEUESIZE-1 ) ];
+}
+
+
+// apply that event to the keys, and let its slot go:
+
+void
+PopInput( struct TableInput *input )
+{
+	long long tail = InputTail.load( std::memory_order_relaxed );
+	const struct InputEvent *e = &InputQueue[ tail & ( INPUTQUEUESIZE-1 ) ];
+	if( e->down )
+		InputKeys |= e->key;
+	else
+		InputKeys &= ~e->key;
+	input->leftLever  = ( InputKeys & KEYLEFTLEVER ) != 0;
+	input->rightLever = ( InputKeys & KEYRIGHTLEVER ) != 0;
+	input->plunger    = ( InputKeys & KEYPLUNGER ) != 0;
+	LatencyApplied[ e->number & ( INPUTQUEUESIZE-1 ) ] = std::chrono::steady_clock::now( );
+	InputApplied = e->number;
+	InputTail.store( tail + 1, std::memory_order_release );
+}
+
+
+// forget the queue and the keys (only with nothing pushing or popping):
+
+void
+ClearInput( )
+{
+	InputTail.store( InputHead.load( ) );
+	InputKeys = 0;
+	LatencyAutoDown = false;
+	InputApplied = InputPushed;
+	LatencyShown = InputPushed;
+}
+
+
+void
+SetLatency( int on )
+{
+	LatencyOn = on;
+	LatencyCount = 0;
+	LatencyShown = InputPushed;
+	LatencyLastAuto = std::chrono::steady_clock::now( );
+
+	// (let go of the automatic press, if turning it off leaves it down)
+	if( LatencyAutoDown  &&  on != LATENCYAUTO )
+	{
+		if( PhysicsOn != 0 )
+			PushTableKey( KEYRIGHTLEVER, false );
+		LatencyAutoDown = false;
+	}
+}
+
+
+// the automatic presses, with LatencyOn == LATENCYAUTO (called from Animate( )):
+
+void
+LatencyAutoPress( )
+{
+	if( LatencyOn != LATENCYAUTO  ||  PhysicsOn == 0 )
+		return;
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now( );
+	if( std::chrono::duration<double, std::milli>( now - LatencyLastAuto ).count( ) < LATENCYAUTOMS )
+		return;
+	LatencyLastAuto = now;
+	LatencyAutoDown = ! LatencyAutoDown;
+	PushTableKey( KEYRIGHTLEVER, LatencyAutoDown );
+}
+
+
+double
+MedianMs( double *ms, int n )
+{
+	std::sort( ms, ms + n );
+	return ms[ n/2 ];
+}
+
+
+// a frame showing the events up through number newest has just been swapped:
+
+void
+LatencyFrameShown( long long newest )
+{
+	if( LatencyOn == 0  ||  newest <= LatencyShown )
+		return;
+
+	glFinish( );
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now( );
+
+	// (only the last INPUTQUEUESIZE events' times are still there)
+	long long first = std::max( LatencyShown + 1, newest - INPUTQUEUESIZE + 1 );
+	for( long long n = first; n <= newest; n++ )
+	{
+		int k = (int)( n & ( INPUTQUEUESIZE-1 ) );
+		LatencyAppliedMs[LatencyCount] = std::chrono::duration<double, std::milli>( LatencyApplied[k] - LatencyArrived[k] ).count( );
+		LatencyShownMs[LatencyCount] = std::chrono::duration<double, std::milli>( now - LatencyArrived[k] ).count( );
+		if( ++LatencyCount == LATENCYSAMPLES )
+		{
+			double worstApplied = *std::max_element( LatencyAppliedMs, LatencyAppliedMs + LATENCYSAMPLES );
+			double worstShown = *std::max_element( LatencyShownMs, LatencyShownMs + LATENCYSAMPLES );
+			fprintf( stderr, "Input latency, %d events: applied %.2f ms (worst %.2f), shown %.2f ms (worst %.2f)\n",
+				LATENCYSAMPLES, MedianMs( LatencyAppliedMs, LATENCYSAMPLES ), worstApplied,
+				MedianMs( LatencyShownMs, LATENCYSAMPLES ), worstShown );
+			LatencyCount = 0;
+		}
+	}
+	LatencyShown = newest;
+}
@@ -0,0 +1,647 @@
+// the texture cache -- each texture's whole mip chain, built once and kept on disk:
+//
+//	the first time a texture is loaded, its mip levels are made on a worker thread by
+//	averaging 2x2 texels down to 1x1, and (if TextureCompressOn) each level is
+//	compressed to BC1 (DXT1: 4x4 texels in 8 bytes, 1/8 of RGB8's 4 bytes a texel in
+//	video memory) -- then all of it is written next to the source as "<file>.mips"
+//	("<file>.rgb.mips" if it isn't compressed, so flipping TextureCompressOn back and
+//	forth doesn't rebuild either one):
+//
+//		TexCacheHeader
+//		MipLevel[ numLevels ]			width, height, size, and offset of each level
+//		the level data
+//
+//	after that the texture is read straight out of the cache with no bmp decoding,
+//	filtering, or compressing -- the header remembers where the texels came from (the
+//	bmp, or its entry in the asset bundle if the bmp isn't there) with that source's
+//	modification time and size, and the format, so changing the bmp rebuilds it
+//
+//	TextureCompressOn starts on unless the program is run with "-rgb-textures", and the
+//	Texture Compression menu flips it -- which uploads the texture again, out of the
+//	other format's cache
+//
+//	with a full mip chain the far end of the bottom plate, which the camera sees at a
+//	steep angle, samples a small level instead of the whole base image -- the Texture
+//	Filter menu picks plain linear (the old way, base level only), trilinear, or
+//	anisotropic sampling
+
+#include <chrono>
+
+
+const char	TEXCACHEMAGIC[8] = { 'P', 'N', 'B', 'A', 'L', 'L', 'T', 'X' };
+const int	TEXCACHEVERSION  = 2;
+const int	MAXMIPLEVELS     = 16;
+const float	MAXANISOTROPY    = 8.f;
+
+enum TexCacheFormats
+{
+	TEXCACHE_RGB,					// 3 bytes per texel
+	TEXCACHE_BC1					// 8 bytes per 4x4 block
+};
+
+enum TexCacheSources
+{
+	TEXSOURCE_BMP,					// the bmp file itself
+	TEXSOURCE_BUNDLE				// the bmp's entry in the asset bundle
+};
+
+enum TextureFilters
+{
+	TEXFILTER_LINEAR,
+	TEXFILTER_TRILINEAR,
+	TEXFILTER_ANISOTROPIC
+};
+
+int		TextureCompressOn = 1;					// != 0 means new caches are BC1 compressed
+int		TextureFilter = TEXFILTER_ANISOTROPIC;
+long long	TextureBytes;						// what UploadMipChain( ) has given the driver, for the hud
+
+struct TexCacheHeader
+{
+	char		magic[8];
+	int			version;
+	int			format;					// a TexCacheFormats
+	int			width, height;			// the base level
+	int			numLevels;
+	int			source;					// a TexCacheSources
+	long long	sourceTime;
+	long long	sourceSize;
+};
+
+struct MipLevel
+{
+	int			width, height;
+	int			size;					// bytes
+	int			offset;					// from the start of the level data
+};
+
+struct MipChain
+{
+	int				format;
+	int				numLevels;
+	struct MipLevel	levels[MAXMIPLEVELS];
+	unsigned char *	data;
+	bool			fromCache;			// != 0 if it was read out of the .mips file
+	double			buildMs;			// how long making it took, if it wasn't
+	float			psnr;				// BC1 base level vs the source, in dB (0. if not compressed)
+};
+
+
+// the size of one level in a format:
+
+int
+MipLevelSize( int format, int width, int height )
+{
+	if( format == TEXCACHE_BC1 )
+		return ( ( width + 3 ) / 4 ) * ( ( height + 3 ) / 4 ) * 8;
+	return 3 * width * height;
+}
+
+
+// make the next level down by averaging 2x2 texels:
+// (an odd row or column at the edge is averaged with itself)
+
+void
+DownsampleRGB( const unsigned char *src, int width, int height, unsigned char *dst, int newWidth, int newHeight )
+{
+	for( int y = 0; y < newHeight; y++ )
+	{
+		int y0 = 2*y;
+		int y1 = ( 2*y + 1 < height ) ? 2*y + 1 : height - 1;
+		for( int x = 0; x < newWidth; x++ )
+		{
+			int x0 = 2*x;
+			int x1 = ( 2*x + 1 < width ) ? 2*x + 1 : width - 1;
+			for( int c = 0; c < 3; c++ )
+			{
+				int sum = src[ 3*( y0*width + x0 ) + c ] + src[ 3*( y0*width + x1 ) + c ]
+						+ src[ 3*( y1*width + x0 ) + c ] + src[ 3*( y1*width + x1 ) + c ];
+				dst[ 3*( y*newWidth + x ) + c ] = (unsigned char)( ( sum + 2 ) / 4 );
+			}
+		}
+	}
+}
+
+
+// 5:6:5 <-> 8:8:8:
+
+unsigned short
+PackRGB565( const float rgb[3] )
+{
+	int r = (int)( rgb[0] * 31.f / 255.f + 0.5f );
+	int g = (int)( rgb[1] * 63.f / 255.f + 0.5f );
+	int b = (int)( rgb[2] * 31.f / 255.f + 0.5f );
+	r = r < 0 ? 0 : ( r > 31 ? 31 : r );
+	g = g < 0 ? 0 : ( g > 63 ? 63 : g );
+	b = b < 0 ? 0 : ( b > 31 ? 31 : b );
+	return (unsigned short)( ( r << 11 ) | ( g << 5 ) | b );
+}
+
+
+void
+UnpackRGB565( unsigned short c, int rgb[3] )
+{
+	int r = ( c >> 11 ) & 31;
+	int g = ( c >> 5 ) & 63;
+	int b = c & 31;
+	rgb[0] = ( r << 3 ) | ( r >> 2 );
+	rgb[1] = ( g << 2 ) | ( g >> 4 );
+	rgb[2] = ( b << 3 ) | ( b >> 2 );
+}
+
+
+// the 4 colors a BC1 block can use:
+
+void
+BC1Palette( unsigned short c0, unsigned short c1, int palette[4][3] )
+{
+	UnpackRGB565( c0, palette[0] );
+	UnpackRGB565( c1, palette[1] );
+	for( int k = 0; k < 3; k++ )
+	{
+		if( c0 > c1 )
+		{
+			palette[2][k] = ( 2*palette[0][k] + palette[1][k] ) / 3;
+			palette[3][k] = ( palette[0][k] + 2*palette[1][k] ) / 3;
+		}
+		else
+		{
+			palette[2][k] = ( palette[0][k] + palette[1][k] ) / 2;
+			palette[3][k] = 0;
+		}
+	}
+}
+
+
+// compress one 4x4 block of RGB texels:
+//
+//	the two end colors are the ends of the block's colors projected on the line through
+//	their mean along their main axis (from a few steps of power iteration on the color
+//	covariance) -- then each texel gets whichever of the 4 palette colors is closest
+
+void
+EncodeBC1Block( const unsigned char texels[16][3], unsigned char out[8] )
+{
+	float mean[3] = { 0., 0., 0. };
+	for( int i = 0; i < 16; i++ )
+		for( int k = 0; k < 3; k++ )
+			mean[k] += texels[i][k] / 16.f;
+
+	float cov[6] = { 0., 0., 0., 0., 0., 0. };		// xx, xy, xz, yy, yz, zz
+	for( int i = 0; i < 16; i++ )
+	{
+		float d[3] = { texels[i][0] - mean[0], texels[i][1] - mean[1], texels[i][2] - mean[2] };
+		cov[0] += d[0]*d[0];	cov[1] += d[0]*d[1];	cov[2] += d[0]*d[2];
+		cov[3] += d[1]*d[1];	cov[4] += d[1]*d[2];	cov[5] += d[2]*d[2];
+	}
+	float axis[3] = { 1., 1., 1. };
+	for( int iter = 0; iter < 8; iter++ )
+	{
+		float a[3];
+		a[0] = cov[0]*axis[0] + cov[1]*axis[1] + cov[2]*axis[2];
+		a[1] = cov[1]*axis[0] + cov[3]*axis[1] + cov[4]*axis[2];
+		a[2] = cov[2]*axis[0] + cov[4]*axis[1] + cov[5]*axis[2];
+		float len = sqrtf( a[0]*a[0] + a[1]*a[1] + a[2]*a[2] );
+		if( len == 0. )
+			break;
+		axis[0] = a[0] / len;	axis[1] = a[1] / len;	axis[2] = a[2] / len;
+	}
+
+	float tmin = 1.e30f, tmax = -1.e30f;
+	for( int i = 0; i < 16; i++ )
+	{
+		float t = ( texels[i][0] - mean[0] )*axis[0] + ( texels[i][1] - mean[1] )*axis[1] + ( texels[i][2] - mean[2] )*axis[2];
+		if( t < tmin )	tmin = t;
+		if( t > tmax )	tmax = t;
+	}
+	float end0[3], end1[3];
+	for( int k = 0; k < 3; k++ )
+	{
+		end0[k] = mean[k] + tmax * axis[k];
+		end1[k] = mean[k] + tmin * axis[k];
+	}
+
+	// c0 > c1 picks the 4-color mode -- a block whose ends round to the same color just uses c0:
+
+	unsigned short c0 = PackRGB565( end0 );
+	unsigned short c1 = PackRGB565( end1 );
+	if( c0 < c1 )
+	{
+		unsigned short t = c0;
+		c0 = c1;
+		c1 = t;
+	}
+
+	int palette[4][3];
+	BC1Palette( c0, c1, palette );
+	int numColors = ( c0 > c1 ) ? 4 : 1;
+	unsigned int bits = 0;
+	for( int i = 0; i < 16; i++ )
+	{
+		int best = 0;
+		int bestDist = 1 << 30;
+		for( int p = 0; p < numColors; p++ )
+		{
+			int dr = texels[i][0] - palette[p][0];
+			int dg = texels[i][1] - palette[p][1];
+			int db = texels[i][2] - palette[p][2];
+			int dist = dr*dr + dg*dg + db*db;
+			if( dist < bestDist )
+			{
+				bestDist = dist;
+				best = p;
+			}
+		}
+		bits |= (unsigned int)best << ( 2*i );
+	}
+
+	out[0] = (unsigned char)( c0 & 0xff );	out[1] = (unsigned char)( c0 >> 8 );
+	out[2] = (unsigned char)( c1 & 0xff );	out[3] = (unsigned char)( c1 >> 8 );
+	out[4] = (unsigned char)( bits );		out[5] = (unsigned char)( bits >> 8 );
+	out[6] = (unsigned char)( bits >> 16 );	out[7] = (unsigned char)( bits >> 24 );
+}
+
+
+// compress a whole level, block by block:
+// (texels past the right or top edge repeat the edge texel)
+
+void
+EncodeBC1( const unsigned char *rgb, int width, int height, unsigned char *out )
+{
+	for( int by = 0; by < height; by += 4 )
+	{
+		for( int bx = 0; bx < width; bx += 4 )
+		{
+			unsigned char texels[16][3];
+			for( int y = 0; y < 4; y++ )
+			{
+				int sy = ( by + y < height ) ? by + y : height - 1;
+				for( int x = 0; x < 4; x++ )
+				{
+					int sx = ( bx + x < width ) ? bx + x : width - 1;
+					memcpy( texels[4*y + x], &rgb[ 3*( sy*width + sx ) ], 3 );
+				}
+			}
+			EncodeBC1Block( texels, out );
+			out += 8;
+		}
+	}
+}
+
+
+// and back, for a driver that can't take BC1 and for measuring the error:
+
+void
+DecodeBC1( const unsigned char *in, int width, int height, unsigned char *rgb )
+{
+	for( int by = 0; by < height; by += 4 )
+	{
+		for( int bx = 0; bx < width; bx += 4 )
+		{
+			unsigned short c0 = (unsigned short)( in[0] | ( in[1] << 8 ) );
+			unsigned short c1 = (unsigned short)( in[2] | ( in[3] << 8 ) );
+			unsigned int bits = in[4] | ( in[5] << 8 ) | ( in[6] << 16 ) | ( (unsigned int)in[7] << 24 );
+			int palette[4][3];
+			BC1Palette( c0, c1, palette );
+			for( int y = 0; y < 4  &&  by + y < height; y++ )
+			{
+				for( int x = 0; x < 4  &&  bx + x < width; x++ )
+				{
+					int p = ( bits >> ( 2*( 4*y + x ) ) ) & 3;
+					unsigned char *dst = &rgb[ 3*( ( by + y )*width + bx + x ) ];
+					dst[0] = (unsigned char)palette[p][0];
+					dst[1] = (unsigned char)palette[p][1];
+					dst[2] = (unsigned char)palette[p][2];
+				}
+			}
+			in += 8;
+		}
+	}
+}
+
+
+void
+FreeMipChain( struct MipChain *mips )
+{
+	delete [ ] mips->data;
+	mips->data = NULL;
+	mips->numLevels = 0;
+}
+
+
+// make the mip chain from the base level's RGB texels:
+
+void
+BuildMipChain( const unsigned char *pixels, int width, int height, int format, struct MipChain *mips )
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now( );
+
+	mips->format = format;
+	mips->numLevels = 0;
+	mips->psnr = 0.;
+	int total = 0;
+	for( int w = width, h = height; mips->numLevels < MAXMIPLEVELS; w = ( w > 1 ? w/2 : 1 ), h = ( h > 1 ? h/2 : 1 ) )
+	{
+		struct MipLevel *level = &mips->levels[ mips->numLevels++ ];
+		level->width = w;
+		level->height = h;
+		level->size = MipLevelSize( format, w, h );
+		level->offset = total;
+		total += level->size;
+		if( w == 1  &&  h == 1 )
+			break;
+	}
+	mips->data = new unsigned char[ total ];
+
+	// each level is made from the RGB of the one above it, not from its compressed form:
+
+	unsigned char *rgb = new unsigned char[ 3 * width * height ];
+	memcpy( rgb, pixels, 3 * width * height );
+	for( int i = 0; i < mips->numLevels; i++ )
+	{
+		struct MipLevel *level = &mips->levels[i];
+		if( i > 0 )
+		{
+			struct MipLevel *above = &mips->levels[i-1];
+			unsigned char *next = new unsigned char[ 3 * level->width * level->height ];
+			DownsampleRGB( rgb, above->width, above->height, next, level->width, level->height );
+			delete [ ] rgb;
+			rgb = next;
+		}
+
+		if( format == TEXCACHE_RGB )
+		{
+			memcpy( mips->data + level->offset, rgb, level->size );
+			continue;
+		}
+		EncodeBC1( rgb, level->width, level->height, mips->data + level->offset );
+		if( i == 0 )
+		{
+			unsigned char *back = new unsigned char[ 3 * width * height ];
+			DecodeBC1( mips->data, width, height, back );
+			double sum = 0.;
+			for( int k = 0; k < 3 * width * height; k++ )
+				sum += (double)( back[k] - pixels[k] ) * (double)( back[k] - pixels[k] );
+			double mse = sum / (double)( 3 * width * height );
+			mips->psnr = ( mse > 0. ) ? (float)( 10. * log10( 255.*255. / mse ) ) : 99.f;
+			delete [ ] back;
+		}
+	}
+	delete [ ] rgb;
+
+	mips->buildMs = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now( ) - start ).count( );
+}
+
+
+// "-rgb-textures" turns TextureCompressOn off:
+
+void
+ParseTextureArgs( int argc, char *argv[ ] )
+{
+	for( int i = 1; i < argc; i++ )
+	{
+		if( strcmp( argv[i], "-rgb-textures" ) == 0 )
+			TextureCompressOn = 0;
+	}
+}
+
+
+// where a texture's texels come from, and that source's modification time and size:
+// (the bmp if it is there, else the bundle's copy of it -- returns false if neither is)
+
+bool
+TexCacheSource( const char *file, int *source, long long *sourceTime, long long *sourceSize )
+{
+	if( SourceStamp( file, sourceTime, sourceSize ) )
+	{
+		*source = TEXSOURCE_BMP;
+		return true;
+	}
+
+	const struct BundleEntry *e = FindBundleEntry( file, BUNDLE_TEXTURE );
+	if( e == NULL )
+		return false;
+	*source = TEXSOURCE_BUNDLE;
+	*sourceTime = e->sourceTime;
+	*sourceSize = e->sourceSize;
+	return true;
+}
+
+
+// the cache file that goes with a texture file and a format:
+
+std::string
+TexCacheFile( const char *file, int format )
+{
+	return std::string( file ) + ( format == TEXCACHE_BC1 ? ".mips" : ".rgb.mips" );
+}
+
+
+// read a texture's cache, if it is there and up to date:
+
+bool
+ReadTexCache( const char *file, int format, struct MipChain *mips )
+{
+	int source;
+	long long sourceTime, sourceSize;
+	if( ! TexCacheSource( file, &source, &sourceTime, &sourceSize ) )
+		return false;
+
+	FILE *fp = fopen( TexCacheFile( file, format ).c_str( ), "rb" );
+	if( fp == NULL )
+		return false;
+
+	struct TexCacheHeader header;
+	bool ok = ( fread( &header, sizeof(header), 1, fp ) == 1 )
+		&&  memcmp( header.magic, TEXCACHEMAGIC, sizeof(header.magic) ) == 0
+		&&  header.version == TEXCACHEVERSION
+		&&  header.format == format
+		&&  header.source == source
+		&&  header.sourceTime == sourceTime  &&  header.sourceSize == sourceSize
+		&&  header.numLevels > 0  &&  header.numLevels <= MAXMIPLEVELS
+		&&  fread( mips->levels, sizeof(struct MipLevel), header.numLevels, fp ) == (size_t)header.numLevels;
+
+	int total = 0;
+	for( int i = 0; ok  &&  i < header.numLevels; i++ )
+	{
+		struct MipLevel *level = &mips->levels[i];
+		ok = ( level->width > 0  &&  level->height > 0  &&  level->offset == total
+			&&  level->size == MipLevelSize( format, level->width, level->height ) );
+		total += level->size;
+	}
+
+	if( ok )
+	{
+		mips->data = new unsigned char[ total ];
+		ok = ( fread( mips->data, 1, total, fp ) == (size_t)total );
+		if( ! ok )
+			FreeMipChain( mips );
+	}
+	fclose( fp );
+	if( ! ok )
+		return false;
+
+	mips->format = format;
+	mips->numLevels = header.numLevels;
+	mips->fromCache = true;
+	mips->buildMs = 0.;
+	mips->psnr = 0.;
+	return true;
+}
+
+
+// write a texture's cache:
+// (it is written to a temporary file and renamed, so a half-written cache is never read)
+
+void
+WriteTexCache( const char *file, const struct MipChain *mips )
+{
+	struct TexCacheHeader header;
+	memset( &header, 0, sizeof(header) );
+	memcpy( header.magic, TEXCACHEMAGIC, sizeof(header.magic) );
+	header.version = TEXCACHEVERSION;
+	header.format = mips->format;
+	header.width = mips->levels[0].width;
+	header.height = mips->levels[0].height;
+	header.numLevels = mips->numLevels;
+	if( ! TexCacheSource( file, &header.source, &header.sourceTime, &header.sourceSize ) )
+		return;
+
+	std::string cacheFile = TexCacheFile( file, mips->format );
+	std::string tempFile = cacheFile + ".tmp";
+	FILE *fp = fopen( tempFile.c_str( ), "wb" );
+	if( fp == NULL )
+	{
+		fprintf( stderr, "Cannot write texture cache '%s'\n", cacheFile.c_str( ) );
+		return;
+	}
+	const struct MipLevel *last = &mips->levels[ mips->numLevels - 1 ];
+	fwrite( &header, sizeof(header), 1, fp );
+	fwrite( mips->levels, sizeof(struct MipLevel), mips->numLevels, fp );
+	fwrite( mips->data, 1, last->offset + last->size, fp );
+	bool ok = ( ferror( fp ) == 0 );
+	fclose( fp );
+	if( ! ok  ||  rename( tempFile.c_str( ), cacheFile.c_str( ) ) != 0 )
+	{
+		fprintf( stderr, "Error writing texture cache '%s'\n", cacheFile.c_str( ) );
+		remove( tempFile.c_str( ) );
+	}
+}
+
+
+// get a texture's mip chain -- out of its cache, or made from the texture and cached:
+// (this runs on an asset worker)
+
+bool
+LoadMipChain( char *file, struct MipChain *mips )
+{
+	int format = ( TextureCompressOn != 0 ) ? TEXCACHE_BC1 : TEXCACHE_RGB;
+	if( ReadTexCache( file, format, mips ) )
+		return true;
+
+	int width, height;
+	unsigned char *owned;
+	const unsigned char *pixels = LoadTextureAsset( file, &width, &height, &owned );
+	if( pixels == NULL )
+		return false;
+	BuildMipChain( pixels, width, height, format, mips );
+	mips->fromCache = false;
+	delete [ ] owned;
+
+	WriteTexCache( file, mips );
+	return true;
+}
+
+
+// set a texture's sampling from TextureFilter:
+// (the texture must be bound)
+
+void
+ApplyTextureFilter( )
+{
+	GLenum minFilter = ( TextureFilter == TEXFILTER_LINEAR ) ? GL_LINEAR : GL_LINEAR_MIPMAP_LINEAR;
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter );
+
+	if( GLEW_EXT_texture_filter_anisotropic )
+	{
+		GLfloat most = 1.;
+		glGetFloatv( GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &most );
+		GLfloat anisotropy = ( TextureFilter == TEXFILTER_ANISOTROPIC ) ? MAXANISOTROPY : 1.f;
+		glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, anisotropy < most ? anisotropy : most );
+	}
+}
+
+
+// load a mip chain into a texture object:
+// (returns how many bytes it gave the driver -- which are also added to TextureBytes)
+
+long long
+UploadMipChain( GLuint tex, const struct MipChain *mips )
+{
+	long long before = TextureBytes;
+
+	glBindTexture( GL_TEXTURE_2D, tex );
+	glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0 );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mips->numLevels - 1 );
+	ApplyTextureFilter( );
+
+	bool compressed = ( mips->format == TEXCACHE_BC1 );
+	if( compressed  &&  ! GLEW_EXT_texture_compression_s3tc )
+	{
+		fprintf( stderr, "No BC1 support -- uncompressing the texture\n" );
+		compressed = false;
+	}
+
+	for( int i = 0; i < mips->numLevels; i++ )
+	{
+		const struct MipLevel *level = &mips->levels[i];
+		const unsigned char *data = mips->data + level->offset;
+		if( compressed )
+		{
+			glCompressedTexImage2D( GL_TEXTURE_2D, i, GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+				level->width, level->height, 0, level->size, data );
+			TextureBytes += level->size;
+			continue;
+		}
+
+		// (drivers keep RGB textures as RGBA)
+
+		TextureBytes += 4 * level->width * level->height;
+		if( mips->format == TEXCACHE_BC1 )
+		{
+			unsigned char *rgb = new unsigned char[ 3 * level->width * level->height ];
+			DecodeBC1( data, level->width, level->height, rgb );
+			glTexImage2D( GL_TEXTURE_2D, i, 3, level->width, level->height, 0, GL_RGB, GL_UNSIGNED_BYTE, rgb );
+			delete [ ] rgb;
+		}
+		else
+		{
+			glTexImage2D( GL_TEXTURE_2D, i, 3, level->width, level->height, 0, GL_RGB, GL_UNSIGNED_BYTE, data );
+		}
+	}
+	return TextureBytes - before;
+}
+
+
+// remake a texture that is already uploaded, after TextureCompressOn has changed:
+// (*bytes is what the last upload gave the driver, and becomes what this one did)
+
+void
+ReloadMipChain( char *file, GLuint tex, long long *bytes )
+{
+	struct MipChain mips;
+	if( ! LoadMipChain( file, &mips ) )
+	{
+		fprintf( stderr, "Cannot reload texture '%s'\n", file );
+		return;
+	}
+	TextureBytes -= *bytes;
+	*bytes = UploadMipChain( tex, &mips );
+	fprintf( stderr, "Reloaded '%s': %s, %s\n", file, mips.format == TEXCACHE_BC1 ? "BC1" : "RGB",
+		mips.fromCache ? "from its cache" : "rebuilt and cached" );
+	FreeMipChain( &mips );
+}
@@ -0,0 +1,106 @@
+// a small pool of worker threads that run jobs from a shared queue:
+//
+//	Submit( ) hands a job to whichever worker is free next -- the jobs must not
+//	make any opengl calls, since only the thread that created the window has a
+//	current context (results go back to that thread some other way, e.g. the
+//	asset loader's finished queue)
+//
+//	Stop( ) lets the workers finish everything already submitted, then joins them
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <vector>
+
+
+class ThreadPool
+{
+	private:
+		std::vector<std::thread>			Workers;
+		std::deque< std::function<void( )> >	Jobs;
+		std::mutex							Lock;
+		std::condition_variable				JobReady;
+		bool								Stopping;
+
+		void	Work( );
+
+	public:
+		ThreadPool( )		{ Stopping = false; }
+		~ThreadPool( )		{ Stop( ); }
+
+		int		GetNumThreads( )	{ return (int)Workers.size( ); }
+		void	Start( int );
+		void	Stop( );
+		void	Submit( std::function<void( )> );
+};
+
+
+// how many workers to use by default -- one per core:
+
+int
+NumCores( )
+{
+	int n = (int)std::thread::hardware_concurrency( );
+	return ( n > 0 ) ? n : 1;
+}
+
+
+void
+ThreadPool::Start( int numThreads )
+{
+	Stop( );
+	Stopping = false;
+	if( numThreads < 1 )
+		numThreads = 1;
+	for( int i = 0; i < numThreads; i++ )
+		Workers.push_back( std::thread( &ThreadPool::Work, this ) );
+}
+
+
+void
+ThreadPool::Stop( )
+{
+	{
+		std::lock_guard<std::mutex> guard( Lock );
+		Stopping = true;
+	}
+	JobReady.notify_all( );
+	for( size_t i = 0; i < Workers.size( ); i++ )
+		Workers[i].join( );
+	Workers.clear( );
+}
+
+
+void
+ThreadPool::Submit( std::function<void( )> job )
+{
+	{
+		std::lock_guard<std::mutex> guard( Lock );
+		Jobs.push_back( job );
+	}
+	JobReady.notify_one( );
+}
+
+
+// each worker's loop: take the oldest job, run it, repeat:
+
+void
+ThreadPool::Work( )
+{
+	while( true )
+	{
+		std::function<void( )> job;
+		{
+			std::unique_lock<std::mutex> guard( Lock );
+			while( Jobs.empty( )  &&  ! Stopping )
+				JobReady.wait( guard );
+			if( Jobs.empty( ) )
+				return;			// stopping, and nothing left to do
+			job = Jobs.front( );
+			Jobs.pop_front( );
+		}
+		job( );
+	}
+}
@@ -0,0 +1,173 @@
+// the buffer-object renderer -- the same scene as the display lists, drawn out of vertex array objects:
+//
+//	a display list hands the driver a recording of glBegin/glEnd calls and lets it decide
+//	how to store the geometry, which some drivers (mesa among them) do poorly -- here
+//	each piece of the scene gets its vertices and indices in buffer objects that we lay
+//	out ourselves, and a vertex array object that remembers the array setup, so drawing
+//	one is a bind and a glDrawElements( )
+//
+//	the vertices use the obj mesh layout (GL_T2F_N3F_V3F) and are drawn by the
+//	fixed-function pipeline, so the lights, materials, and fog are all the same as
+//	before -- a piece that had no normals (or texture coordinates) in its display list
+//	leaves that array off and keeps using the current normal (or texture coordinate),
+//	just like the display list did
+//
+//	BuffersOn picks the renderer, so the two can be switched back and forth while the
+//	scene is running ('r', or the Renderer menu) and compared frame for frame
+
+
+int		BuffersOn = 1;			// != 0 means draw from the vertex buffers, else from the display lists
+
+struct VertexBuffer
+{
+	bool		ok;						// != 0 if it has been built
+	GLuint		vao;
+	GLuint		vertexBuffer;
+	GLuint		indexBuffer;
+	GLenum		mode;					// GL_TRIANGLES, ...
+	int			numIndices;
+	bool		hasNormals;
+	bool		hasTexCoords;
+	float		lastTexCoord[2];		// the last vertex drawn's, to leave as the current values
+	float		lastNormal[3];
+};
+
+
+// put OBJVERTEXFLOATS-float vertices and an index list into a vertex buffer:
+// (indices == NULL means draw the vertices in order)
+
+void
+BuildVertexBuffer( struct VertexBuffer *vb, GLenum mode, const float *vertices, int numVertices,
+	const GLuint *indices, int numIndices, bool hasNormals, bool hasTexCoords )
+{
+	vb->ok = false;
+	if( numVertices == 0 )
+		return;
+
+	vb->mode = mode;
+	vb->hasNormals = hasNormals;
+	vb->hasTexCoords = hasTexCoords;
+	vb->numIndices = ( indices != NULL ) ? numIndices : numVertices;
+
+	GLuint *ordered = NULL;
+	if( indices == NULL )
+	{
+		ordered = new GLuint[ numVertices ];
+		for( int i = 0; i < numVertices; i++ )
+			ordered[i] = (GLuint)i;
+		indices = ordered;
+	}
+	const float *last = &vertices[ indices[ vb->numIndices - 1 ] * OBJVERTEXFLOATS ];
+	vb->lastTexCoord[0] = last[0];
+	vb->lastTexCoord[1] = last[1];
+	vb->lastNormal[0] = last[2];
+	vb->lastNormal[1] = last[3];
+	vb->lastNormal[2] = last[4];
+
+	glGenVertexArrays( 1, &vb->vao );
+	glGenBuffers( 1, &vb->vertexBuffer );
+	glGenBuffers( 1, &vb->indexBuffer );
+
+	glBindVertexArray( vb->vao );
+	glBindBuffer( GL_ARRAY_BUFFER, vb->vertexBuffer );
+	glBufferData( GL_ARRAY_BUFFER, numVertices * OBJVERTEXFLOATS * sizeof(float), vertices, GL_STATIC_DRAW );
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, vb->indexBuffer );
+	glBufferData( GL_ELEMENT_ARRAY_BUFFER, vb->numIndices * sizeof(GLuint), indices, GL_STATIC_DRAW );
+
+	const GLsizei stride = OBJVERTEXFLOATS * sizeof(float);
+	glEnableClientState( GL_VERTEX_ARRAY );
+	glVertexPointer( 3, GL_FLOAT, stride, (void *)( 5*sizeof(float) ) );
+	if( hasNormals )
+	{
+		glEnableClientState( GL_NORMAL_ARRAY );
+		glNormalPointer( GL_FLOAT, stride, (void *)( 2*sizeof(float) ) );
+	}
+	if( hasTexCoords )
+	{
+		glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+		glTexCoordPointer( 2, GL_FLOAT, stride, (void *)0 );
+	}
+
+	// (the vao keeps the element buffer binding, so it is only unbound after the vao is)
+
+	glBindVertexArray( 0 );
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+
+	delete [ ] ordered;
+	vb->ok = true;
+}
+
+
+// an obj mesh's vertex buffer:
+
+void
+BuildMeshBuffer( const struct ObjMesh *mesh, struct VertexBuffer *vb )
+{
+	BuildVertexBuffer( vb, GL_TRIANGLES, mesh->vertices, mesh->numVertices,
+		( mesh->numIndices > 0 ) ? mesh->indices : NULL, mesh->numIndices, true, mesh->hasTexCoords != 0 );
+}
+
+
+// a sphere's vertex buffer, with the same latitude-longitude tessellation OsuSphere( ) draws:
+
+void
+BuildSphereBuffer( float radius, int slices, int stacks, struct VertexBuffer *vb )
+{
+	int numVertices = ( slices + 1 ) * ( stacks + 1 );
+	float *vertices = new float[ numVertices * OBJVERTEXFLOATS ];
+	float *v = vertices;
+	for( int j = 0; j <= stacks; j++ )
+	{
+		float lat = -F_PI_2 + F_PI * (float)j / (float)stacks;
+		for( int i = 0; i <= slices; i++ )
+		{
+			float lng = -F_PI + F_2_PI * (float)i / (float)slices;
+			float n[3] = { cosf( lat ) * cosf( lng ), sinf( lat ), -cosf( lat ) * sinf( lng ) };
+			*v++ = (float)i / (float)slices;
+			*v++ = (float)j / (float)stacks;
+			*v++ = n[0];	*v++ = n[1];	*v++ = n[2];
+			*v++ = radius * n[0];	*v++ = radius * n[1];	*v++ = radius * n[2];
+		}
+	}
+
+	// each band between two latitudes is a row of quads, split the way the triangle strips split them:
+
+	int numIndices = 6 * slices * stacks;
+	GLuint *indices = new GLuint[ numIndices ];
+	GLuint *q = indices;
+	for( int j = 0; j < stacks; j++ )
+	{
+		for( int i = 0; i < slices; i++ )
+		{
+			GLuint lo0 = (GLuint)( j*( slices+1 ) + i );
+			GLuint hi0 = lo0 + (GLuint)( slices+1 );
+			*q++ = hi0;		*q++ = lo0;		*q++ = hi0 + 1;
+			*q++ = lo0;		*q++ = lo0 + 1;	*q++ = hi0 + 1;
+		}
+	}
+
+	BuildVertexBuffer( vb, GL_TRIANGLES, vertices, numVertices, indices, numIndices, true, true );
+	delete [ ] vertices;
+	delete [ ] indices;
+}
+
+
+// draw a vertex buffer with the current modelview, material, lights, and texture:
+
+void
+DrawVertexBuffer( const struct VertexBuffer *vb )
+{
+	glBindVertexArray( vb->vao );
+	glDrawElements( vb->mode, vb->numIndices, GL_UNSIGNED_INT, (void *)0 );
+	glBindVertexArray( 0 );
+	CountDraw( vb->numIndices );
+
+	// an array draw leaves the current normal and texture coordinate undefined --
+	// leave them where the display list would have:
+
+	if( vb->hasTexCoords )
+		glTexCoord2fv( vb->lastTexCoord );
+	if( vb->hasNormals )
+		glNormal3fv( vb->lastNormal );
+}